@@ -14,8 +14,11 @@
 #  pragma warning(disable : 4275 4251 4231 4660)
 #endif
 #include <boost/locale/info.hpp>
+#include <boost/locale/utf.hpp>
 #include <boost/cstdint.hpp>
 #include <stdexcept>
+#include <memory>
+#include <iterator>
 
 
 
@@ -230,6 +233,68 @@ namespace boost {
                 return boost::locale::conv::between(text.c_str(),text.c_str()+text.size(),to_encoding,from_encoding,how);
             }
           
+            ///
+            /// Check that a text in range [begin,end) is valid UTF-8: it has no overlong forms, surrogates,
+            /// code points above 0x10FFFF or truncated sequences
+            ///
+            BOOST_LOCALE_DECL bool validate_utf8(char const *begin,char const *end);
+
+            ///
+            /// Check that a \a text is valid UTF-8
+            ///
+            inline bool validate_utf8(std::string const &text)
+            {
+                return validate_utf8(text.c_str(),text.c_str()+text.size());
+            }
+
+            ///
+            /// Check that all bytes of a text in range [begin,end) are US-ASCII, i.e. below 0x80
+            ///
+            BOOST_LOCALE_DECL bool is_ascii(char const *begin,char const *end);
+
+            ///
+            /// Check that all bytes of a \a text are US-ASCII
+            ///
+            inline bool is_ascii(std::string const &text)
+            {
+                return is_ascii(text.c_str(),text.c_str()+text.size());
+            }
+
+            ///
+            /// \brief A converter of text to one encoding from another that is opened once and may be used
+            /// for many conversions.
+            ///
+            /// It gives the same results as between() without looking up the encodings on each call.
+            /// The object can not be copied and should be used by one thread at a time.
+            ///
+            class BOOST_LOCALE_DECL converter {
+            public:
+                ///
+                /// Open a conversion to \a to_encoding from \a from_encoding according to policy \a how,
+                /// throws invalid_charset_error if the conversion is not supported
+                ///
+                converter(std::string const &to_encoding,std::string const &from_encoding,method_type how=default_method);
+                ~converter();
+
+                ///
+                /// Convert a text in range [begin,end)
+                ///
+                std::string convert(char const *begin,char const *end);
+
+                ///
+                /// Convert a \a text
+                ///
+                std::string convert(std::string const &text)
+                {
+                    return convert(text.c_str(),text.c_str()+text.size());
+                }
+            private:
+                converter(converter const &);
+                void operator=(converter const &);
+                struct data;
+                std::auto_ptr<data> d;
+            };
+          
             /// \cond INTERNAL
 
             template<>
@@ -261,41 +326,18 @@ namespace boost {
             #endif
 
             namespace details {
-
                 template<typename CharOut,typename CharIn>
-                struct utf_to_utf_traits {
-                    static std::basic_string<CharOut>
-                    convert(CharIn const *begin,CharIn const *end,method_type how)
-                    {
-                        // Make more efficient in fututre - UTF-16/UTF-32 should be quite
-                        // simple and fast
-                        return to_utf<CharOut>(from_utf(begin,end,"UTF-8",how),"UTF-8",how);
-                    }
-                };
-                template<typename CharOut>
-                struct utf_to_utf_traits<CharOut,char> {
-                    static std::basic_string<CharOut>
-                    convert(char const *begin,char const *end,method_type how)
-                    {
-                        return to_utf<CharOut>(begin,end,"UTF-8",how);
-                    }
-                };
-                template<typename CharIn>
-                struct utf_to_utf_traits<char,CharIn> {
-                    static std::string
-                    convert(CharIn const *begin,CharIn const *end,method_type how)
-                    {
-                        return from_utf(begin,end,"UTF-8",how);
-                    }
-                };
-                template<>
-                struct utf_to_utf_traits<char,char> { // just test valid
-                    static std::string
-                    convert(char const *begin,char const *end,method_type how)
-                    {
-                        return from_utf(begin,end,"UTF-8",how);
-                    }
-                };
+                bool copy_valid_utf8(std::basic_string<CharOut> &/*out*/,CharIn const * /*begin*/,CharIn const * /*end*/)
+                {
+                    return false;
+                }
+                inline bool copy_valid_utf8(std::string &out,char const *begin,char const *end)
+                {
+                    if(!validate_utf8(begin,end))
+                        return false;
+                    out.assign(begin,end);
+                    return true;
+                }
             }
 
             /// \endcond
@@ -307,7 +349,33 @@ namespace boost {
             std::basic_string<CharOut>
             utf_to_utf(CharIn const *begin,CharIn const *end,method_type how = default_method)
             {
-                return details::utf_to_utf_traits<CharOut,CharIn>::convert(begin,end,how);
+                std::basic_string<CharOut> result;
+                // valid UTF-8 to UTF-8 is copied as is
+                if(details::copy_valid_utf8(result,begin,end))
+                    return result;
+                result.reserve(end-begin);
+                typedef std::back_insert_iterator<std::basic_string<CharOut> > inserter_type;
+                inserter_type inserter(result);
+                while(begin!=end) {
+                    CharIn const *ascii_end = utf::details::skip_ascii(begin,end);
+                    if(ascii_end!=begin) {
+                        result.append(begin,ascii_end);
+                        begin = ascii_end;
+                        if(begin==end)
+                            break;
+                    }
+                    CharIn const *start = begin;
+                    utf::code_point c = utf::utf_traits<CharIn>::decode(begin,end);
+                    if(c==utf::illegal || c==utf::incomplete) {
+                        if(how==stop)
+                            throw conversion_error();
+                        begin = start + 1;
+                    }
+                    else {
+                        utf::utf_traits<CharOut>::encode(c,inserter);
+                    }
+                }
+                return result;
             }
 
             ///
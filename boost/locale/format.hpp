@@ -15,8 +15,12 @@
 #endif
 #include <boost/locale/message.hpp>
 #include <boost/locale/formatting.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include <sstream>
+#include <vector>
+#include <iterator>
+#include <algorithm>
 
 
 namespace boost {
@@ -33,20 +37,96 @@ namespace boost {
         /// \cond INTERNAL
         namespace details {
 
+            ///
+            /// Access to the text of formatted values that are strings of \a CharType, so it can be
+            /// copied to the output without a stream
+            ///
+            template<typename CharType,typename Type>
+            struct formattible_text {
+                typedef bool (*getter_type)(void const *ptr,CharType const *&begin,CharType const *&end);
+                static getter_type getter()
+                {
+                    return 0;
+                }
+                static bool get(void const * /*ptr*/,CharType const *& /*begin*/,CharType const *& /*end*/)
+                {
+                    return false;
+                }
+            };
+
+            template<typename CharType>
+            struct formattible_text<CharType,std::basic_string<CharType> > {
+                typedef bool (*getter_type)(void const *ptr,CharType const *&begin,CharType const *&end);
+                static getter_type getter()
+                {
+                    return &get;
+                }
+                static bool get(void const *ptr,CharType const *&begin,CharType const *&end)
+                {
+                    std::basic_string<CharType> const &s = *static_cast<std::basic_string<CharType> const *>(ptr);
+                    begin = s.data();
+                    end = begin + s.size();
+                    return true;
+                }
+            };
+
+            template<typename CharType>
+            struct formattible_text<CharType,CharType const *> {
+                typedef bool (*getter_type)(void const *ptr,CharType const *&begin,CharType const *&end);
+                static getter_type getter()
+                {
+                    return &get;
+                }
+                static bool get(void const *ptr,CharType const *&begin,CharType const *&end)
+                {
+                    begin = *static_cast<CharType const * const *>(ptr);
+                    if(!begin)
+                        return false;
+                    end = begin;
+                    while(*end)
+                        end++;
+                    return true;
+                }
+            };
+
+            template<typename CharType>
+            struct formattible_text<CharType,CharType *> : public formattible_text<CharType,CharType const *> {
+            };
+
+            template<typename CharType,size_t N>
+            struct formattible_text<CharType,CharType[N]> {
+                typedef bool (*getter_type)(void const *ptr,CharType const *&begin,CharType const *&end);
+                static getter_type getter()
+                {
+                    return &get;
+                }
+                static bool get(void const *ptr,CharType const *&begin,CharType const *&end)
+                {
+                    begin = static_cast<CharType const *>(ptr);
+                    end = begin;
+                    while(end < begin + N && *end)
+                        end++;
+                    return true;
+                }
+            };
+
             template<typename CharType>
             struct formattible {
                 typedef std::basic_ostream<CharType> stream_type;
                 typedef void (*writer_type)(stream_type &output,void const *ptr);
+                typedef bool (*text_getter_type)(void const *ptr,CharType const *&begin,CharType const *&end);
 
                 formattible() :
                     pointer_(0),
-                    writer_(&formattible::void_write)
+                    writer_(&formattible::void_write),
+                    text_getter_(&formattible::void_text)
                 {
                 }
                 
                 formattible(formattible const &other) :
                     pointer_(other.pointer_),
-                    writer_(other.writer_)
+                    writer_(other.writer_),
+                    text_getter_(other.text_getter_)
                 {
                 }
 
@@ -55,6 +135,7 @@ namespace boost {
                     if(this != &other) {
                         pointer_=other.pointer_;
                         writer_=other.writer_;
+                        text_getter_=other.text_getter_;
                     }
                     return *this;
                 }
@@ -64,6 +145,15 @@ namespace boost {
                 {
                     pointer_ = static_cast<void const *>(&value);
                     writer_ = &write<Type>;
+                    text_getter_ = formattible_text<CharType,Type>::getter();
+                }
+
+                ///
+                /// Get the text of the value if it is a string of CharType, otherwise return false
+                ///
+                bool text(CharType const *&begin,CharType const *&end) const
+                {
+                    return text_getter_ != 0 && text_getter_(pointer_,begin,end);
                 }
 
                 template<typename Type>
@@ -86,6 +176,12 @@ namespace boost {
                     output<<empty_string;
                 }
 
+                static bool void_text(void const * /*ptr*/,CharType const *&begin,CharType const *&end)
+                {
+                    begin = end = 0;
+                    return true;
+                }
+
                 template<typename Type>
                 static void write(stream_type &output,void const *ptr)
                 {
@@ -94,34 +190,517 @@ namespace boost {
                 
                 void const *pointer_;
                 writer_type writer_;
+                text_getter_type text_getter_;
             }; // formattible
     
             class BOOST_LOCALE_DECL format_parser  {
             public:
+                ///
+                /// The keys of the flags of a placeholder
+                ///
+                typedef enum {
+                    unknown_key,
+                    position_key,
+                    number_key,
+                    currency_key,
+                    percent_key,
+                    date_key,
+                    time_key,
+                    datetime_key,
+                    ftime_key,
+                    spellout_key,
+                    ordinal_key,
+                    left_key,
+                    right_key,
+                    gmt_key,
+                    local_key,
+                    timezone_key,
+                    width_key,
+                    precision_key,
+                    locale_key
+                } flag_key;
+
                 format_parser(std::ios_base &ios,void *,void (*imbuer)(void *,std::locale const &));
                 ~format_parser();
                 
                 unsigned get_position();
                 
                 void set_one_flag(std::string const &key,std::string const &value);
+                void set_flag(int key,std::string const &value);
 
                 template<typename CharType>
                 void set_flag_with_str(std::string const &key,std::basic_string<CharType> const &value)
                 {
-                    if(key=="ftime" || key=="strftime") {
+                    set_flag_with_str(key_code(key),value);
+                }
+
+                template<typename CharType>
+                void set_flag_with_str(int key,std::basic_string<CharType> const &value)
+                {
+                    if(key==ftime_key) {
+                        save_info();
                         as::strftime(ios_);
                         ios_info::get(ios_).date_time_pattern(value);
                     }
                 }
+
+                ///
+                /// Get the flag_key of \a key, position_key if it is a parameter index
+                ///
+                static int key_code(std::string const &key);
+
                 void restore();
             private:
                 void imbue(std::locale const &);
                 format_parser(format_parser const &);
                 void operator=(format_parser const &);
 
+                //
+                // The state of the stream is saved before a flag changes it for the first time,
+                // and only the saved parts are restored
+                //
+                typedef enum {
+                    saved_display_flags = 1 << 0,
+                    saved_stream_flags  = 1 << 1,
+                    saved_precision     = 1 << 2,
+                    saved_time_zone     = 1 << 3,
+                    saved_locale        = 1 << 4
+                } saved_state_type;
+
+                void save(unsigned what);
+                void save_info();
+
                 std::ios_base &ios_;
-                struct data;
-                std::auto_ptr<data> d;
+                void *cookie_;
+                void (*imbuer_)(void *,std::locale const &);
+                unsigned position_;
+                unsigned saved_;
+                uint64_t display_flags_;
+                std::ios_base::fmtflags stream_flags_;
+                std::streamsize precision_;
+                std::string time_zone_;
+                std::locale locale_;
+                std::auto_ptr<ios_info> info_; // saved only by ftime, the only way to save the pattern
+            };
+
+            ///
+            /// \brief Format string parsed to literal text and placeholders with decoded flags
+            ///
+            /// It holds offsets into the format string it was created from, so it can be used only with
+            /// that string.
+            ///
+            struct compiled_format {
+                struct flag {
+                    int key;            ///< format_parser::flag_key
+                    std::string value;  ///< The value if it is not quoted
+                    size_t begin;       ///< The quoted value is [begin,end) of the format string, with doubled quotes
+                    size_t end;
+                    bool quoted;
+                };
+                struct item {
+                    size_t begin;       ///< Literal text [begin,end) of the format string or flags [begin,end) of a placeholder
+                    size_t end;
+                    unsigned position;  ///< The index of the parameter of a placeholder
+                    bool placeholder;
+                };
+                std::vector<item> items;
+                std::vector<flag> flags;
+            };
+
+            ///
+            /// Get the compiled form of the format string [\a begin, \a end). Each thread keeps the format strings
+            /// it used recently compiled, so they are not parsed again.
+            ///
+            template<typename CharType>
+            shared_ptr<compiled_format const> compile_format(CharType const *begin,CharType const *end);
+
+            template<>
+            BOOST_LOCALE_DECL shared_ptr<compiled_format const> compile_format(char const *begin,char const *end);
+
+            template<>
+            BOOST_LOCALE_DECL shared_ptr<compiled_format const> compile_format(wchar_t const *begin,wchar_t const *end);
+
+            #ifdef BOOST_HAS_CHAR16_T
+            template<>
+            BOOST_LOCALE_DECL shared_ptr<compiled_format const> compile_format(char16_t const *begin,char16_t const *end);
+            #endif
+
+            #ifdef BOOST_HAS_CHAR32_T
+            template<>
+            BOOST_LOCALE_DECL shared_ptr<compiled_format const> compile_format(char32_t const *begin,char32_t const *end);
+            #endif
+
+            ///
+            /// \brief Output stream that collects the text of the formatted parameters in a string
+            ///
+            template<typename CharType>
+            class format_stream {
+            public:
+                typedef std::basic_ostream<CharType> stream_type;
+                typedef std::basic_string<CharType> string_type;
+
+                format_stream() :
+                    stream_(&buffer_),
+                    busy_(false)
+                {
+                }
+
+                stream_type &stream()
+                {
+                    return stream_;
+                }
+
+                string_type &text()
+                {
+                    return buffer_.text;
+                }
+
+                ///
+                /// Bring the stream to the state of a newly created stream with locale \a loc
+                ///
+                void reset(std::locale const &loc)
+                {
+                    if(stream_.getloc() != loc)
+                        stream_.imbue(loc);
+                    stream_.clear();
+                    stream_.flags(std::ios_base::skipws | std::ios_base::dec);
+                    stream_.precision(6);
+                    stream_.width(0);
+                    stream_.fill(stream_.widen(' '));
+                    ios_info::get(stream_) = ios_info();
+                    buffer_.text.clear();
+                }
+
+                ///
+                /// Mark the stream as used, returns false if it is already used
+                ///
+                bool acquire()
+                {
+                    if(busy_)
+                        return false;
+                    busy_ = true;
+                    return true;
+                }
+
+                void release()
+                {
+                    busy_ = false;
+                }
+
+            private:
+                format_stream(format_stream const &);
+                void operator=(format_stream const &);
+
+                class buffer_type : public std::basic_streambuf<CharType> {
+                public:
+                    typedef std::basic_streambuf<CharType> base_type;
+                    typedef typename base_type::int_type int_type;
+                    typedef typename base_type::traits_type traits_type;
+
+                    string_type text;
+                protected:
+                    virtual int_type overflow(int_type c)
+                    {
+                        if(!traits_type::eq_int_type(c,traits_type::eof()))
+                            text += traits_type::to_char_type(c);
+                        return traits_type::not_eof(c);
+                    }
+                    virtual std::streamsize xsputn(CharType const *s,std::streamsize n)
+                    {
+                        text.append(s,static_cast<size_t>(n));
+                        return n;
+                    }
+                };
+
+                buffer_type buffer_;
+                stream_type stream_;
+                bool busy_;
+            };
+
+            ///
+            /// Get the format_stream of the calling thread marked as used, or 0 if the thread already uses it
+            ///
+            template<typename CharType>
+            format_stream<CharType> *acquire_format_stream();
+
+            template<>
+            BOOST_LOCALE_DECL format_stream<char> *acquire_format_stream();
+
+            template<>
+            BOOST_LOCALE_DECL format_stream<wchar_t> *acquire_format_stream();
+
+            #ifdef BOOST_HAS_CHAR16_T
+            template<>
+            BOOST_LOCALE_DECL format_stream<char16_t> *acquire_format_stream();
+            #endif
+
+            #ifdef BOOST_HAS_CHAR32_T
+            template<>
+            BOOST_LOCALE_DECL format_stream<char32_t> *acquire_format_stream();
+            #endif
+
+            ///
+            /// Restores the state of the stream changed by the flags of a placeholder, also when writing
+            /// the parameter throws
+            ///
+            class format_guard {
+            public:
+                format_guard(format_parser &fmt) : 
+                    fmt_(&fmt),
+                    restored_(false)
+                {
+                }
+                void restore()
+                {
+                    if(restored_)
+                        return;
+                    fmt_->restore();
+                    restored_ = true;
+                }
+                ~format_guard()
+                {
+                    try {
+                        restore();
+                    }
+                    catch(...) {
+                    }
+                }
+            private:
+                format_parser *fmt_;
+                bool restored_;
+            };
+
+            //
+            // Holds the format_stream used by one write to an output iterator, the one of the thread
+            // or a new one if the format is written while the thread formats a parameter
+            //
+            template<typename CharType>
+            class format_stream_holder {
+            public:
+                format_stream_holder() :
+                    stream_(0)
+                {
+                }
+                ~format_stream_holder()
+                {
+                    if(stream_)
+                        stream_->release();
+                }
+                format_stream<CharType> &get(std::locale const &loc)
+                {
+                    if(!stream_) {
+                        stream_ = acquire_format_stream<CharType>();
+                        if(!stream_) {
+                            own_.reset(new format_stream<CharType>());
+                            stream_ = own_.get();
+                        }
+                        stream_->reset(loc);
+                    }
+                    return *stream_;
+                }
+            private:
+                format_stream<CharType> *stream_;
+                std::auto_ptr<format_stream<CharType> > own_;
+            };
+
+            template<typename CharType>
+            void imbue_format_stream(void *ptr,std::locale const &l)
+            {
+                reinterpret_cast<std::basic_ostream<CharType> *>(ptr)->imbue(l);
+            }
+
+            template<typename CharType>
+            std::basic_string<CharType> unquote_format_value(CharType const *begin,CharType const *end)
+            {
+                CharType quote='\'';
+                std::basic_string<CharType> value;
+                value.reserve(end - begin);
+                while(begin < end) {
+                    value+=*begin;
+                    if(*begin==quote)
+                        begin++;
+                    begin++;
+                }
+                return value;
+            }
+
+            template<typename CharType>
+            void set_format_flags(format_parser &fmt,compiled_format const &compiled,compiled_format::item const &it,CharType const *format)
+            {
+                for(size_t j=it.begin;j<it.end;j++) {
+                    compiled_format::flag const &f = compiled.flags[j];
+                    if(f.quoted)
+                        fmt.set_flag_with_str(f.key,unquote_format_value(format + f.begin,format + f.end));
+                    else
+                        fmt.set_flag(f.key,f.value);
+                }
+            }
+
+            inline bool has_width_flag(compiled_format const &compiled,compiled_format::item const &it)
+            {
+                for(size_t j=it.begin;j<it.end;j++) {
+                    if(compiled.flags[j].key == format_parser::width_key)
+                        return true;
+                }
+                return false;
+            }
+
+            ///
+            /// Write the format string [\a format, \a format_end) with parameters \a args to the stream \a out.
+            /// \a args provides <tt>bool text(unsigned id,CharType const *&begin,CharType const *&end) const</tt> and
+            /// <tt>void write(std::basic_ostream<CharType> &out,unsigned id) const</tt>
+            ///
+            template<typename CharType,typename Arguments>
+            void format_output(std::basic_ostream<CharType> &out,CharType const *format,CharType const *format_end,Arguments const &args)
+            {
+                shared_ptr<compiled_format const> compiled = compile_format(format,format_end);
+
+                for(size_t i=0;i<compiled->items.size();i++) {
+                    compiled_format::item const &it = compiled->items[i];
+                    if(!it.placeholder) {
+                        CharType const *text = format + it.begin;
+                        std::streamsize len = it.end - it.begin;
+                        // the width of the stream applies to the first character as with formatted output
+                        if(out.width() != 0) {
+                            out << *text++;
+                            len--;
+                        }
+                        out.write(text,len);
+                        continue;
+                    }
+
+                    format_parser fmt(out,static_cast<void *>(&out),&imbue_format_stream<CharType>);
+
+                    format_guard guard(fmt);
+
+                    set_format_flags(fmt,*compiled,it,format);
+                    args.write(out,it.position);
+                    guard.restore();
+                }
+            }
+
+            ///
+            /// Write the format string [\a format, \a format_end) with parameters \a args to the output iterator \a out
+            /// as if it was written to a new stream with locale \a loc
+            ///
+            template<typename CharType,typename OutputIterator,typename Arguments>
+            OutputIterator format_output(OutputIterator out,std::locale const &loc,CharType const *format,CharType const *format_end,Arguments const &args)
+            {
+                shared_ptr<compiled_format const> compiled = compile_format(format,format_end);
+                format_stream_holder<CharType> holder;
+
+                for(size_t i=0;i<compiled->items.size();i++) {
+                    compiled_format::item const &it = compiled->items[i];
+                    if(!it.placeholder) {
+                        out = std::copy(format + it.begin,format + it.end,out);
+                        continue;
+                    }
+
+                    CharType const *begin,*end;
+                    if(args.text(it.position,begin,end) && !has_width_flag(*compiled,it)) {
+                        // no other flag changes the output of a string
+                        out = std::copy(begin,end,out);
+                        continue;
+                    }
+
+                    format_stream<CharType> &fs = holder.get(loc);
+                    std::basic_ostream<CharType> &s = fs.stream();
+                    {
+                        format_parser fmt(s,static_cast<void *>(&s),&imbue_format_stream<CharType>);
+
+                        format_guard guard(fmt);
+
+                        set_format_flags(fmt,*compiled,it,format);
+                        args.write(s,it.position);
+                        guard.restore();
+                    }
+                    out = std::copy(fs.text().begin(),fs.text().end(),out);
+                    fs.text().clear();
+                }
+                return out;
+            }
+
+            ///
+            /// Translate \a message using locale \a loc and the default messages domain and write it as a format string
+            /// with parameters \a args to the output iterator \a out
+            ///
+            template<typename CharType,typename OutputIterator,typename Arguments>
+            OutputIterator format_message(OutputIterator out,std::locale const &loc,basic_message<CharType> const &message,Arguments const &args)
+            {
+                std::basic_string<CharType> buffer;
+                std::pair<CharType const *,CharType const *> fmt = message.view(loc,0,buffer);
+                return format_output(out,loc,fmt.first,fmt.second,args);
+            }
+
+            ///
+            /// Type of the unused parameters of format_arguments
+            ///
+            struct no_format_argument {};
+
+            template<typename CharType>
+            struct formattible_text<CharType,no_format_argument> {
+                static bool get(void const * /*ptr*/,CharType const *&begin,CharType const *&end)
+                {
+                    begin = end = 0;
+                    return true;
+                }
+            };
+
+            ///
+            /// \brief Up to four parameters of format_to, kept with their types
+            ///
+            template<typename CharType,typename T1,typename T2 = no_format_argument,typename T3 = no_format_argument,typename T4 = no_format_argument>
+            class format_arguments {
+            public:
+                typedef std::basic_ostream<CharType> stream_type;
+
+                format_arguments(T1 const *a1,T2 const *a2 = 0,T3 const *a3 = 0,T4 const *a4 = 0) :
+                    a1_(a1),
+                    a2_(a2),
+                    a3_(a3),
+                    a4_(a4)
+                {
+                }
+
+                bool text(unsigned id,CharType const *&begin,CharType const *&end) const
+                {
+                    switch(id) {
+                    case 0: return formattible_text<CharType,T1>::get(a1_,begin,end);
+                    case 1: return formattible_text<CharType,T2>::get(a2_,begin,end);
+                    case 2: return formattible_text<CharType,T3>::get(a3_,begin,end);
+                    case 3: return formattible_text<CharType,T4>::get(a4_,begin,end);
+                    default: return formattible_text<CharType,no_format_argument>::get(0,begin,end);
+                    }
+                }
+
+                void write(stream_type &out,unsigned id) const
+                {
+                    switch(id) {
+                    case 0: put(out,a1_); break;
+                    case 1: put(out,a2_); break;
+                    case 2: put(out,a3_); break;
+                    case 3: put(out,a4_); break;
+                    default: put(out,static_cast<no_format_argument const *>(0));
+                    }
+                }
+
+            private:
+                template<typename Type>
+                static void put(stream_type &out,Type const *value)
+                {
+                    out << *value;
+                }
+
+                static void put(stream_type &out,no_format_argument const * /*value*/)
+                {
+                    CharType empty_string[1]={0};
+                    out<<empty_string;
+                }
+
+                T1 const *a1_;
+                T2 const *a2_;
+                T3 const *a3_;
+                T4 const *a4_;
             };
 
         }
@@ -249,10 +828,9 @@ namespace boost {
             ///
             string_type str(std::locale const &loc = std::locale()) const
             {
-                std::basic_ostringstream<CharType> buffer;
-                buffer.imbue(loc);
-                write(buffer);
-                return buffer.str();
+                string_type result;
+                write(std::back_inserter(result),loc);
+                return result;
             }
 
             ///
@@ -260,152 +838,69 @@ namespace boost {
             ///
             void write(stream_type &out) const
             {
-                string_type format;
-                if(translate_)
-                    format = message_.str(out.getloc(),ios_info::get(out).domain_id());
+                if(translate_) {
+                    string_type buffer;
+                    std::pair<char_type const *,char_type const *> fmt =
+                        message_.view(out.getloc(),ios_info::get(out).domain_id(),buffer);
+                    details::format_output(out,fmt.first,fmt.second,parameters(*this));
+                }
                 else
-                    format = format_;
-               
-                format_output(out,format);
+                    details::format_output(out,format_.data(),format_.data() + format_.size(),parameters(*this));
+            }
 
+            ///
+            /// Write a formatted string to the output iterator \a out using locale \a loc and the default
+            /// messages domain, returns the iterator past the last written character.
+            ///
+            /// The result is the same as of writing to a new stream with locale \a loc. The literal text and the
+            /// parameters that are strings of char_type are copied to \a out directly, other parameters are
+            /// formatted by a stream that each thread creates once and reuses.
+            ///
+            template<typename OutputIterator>
+            OutputIterator write(OutputIterator out,std::locale const &loc) const
+            {
+                if(translate_) {
+                    string_type buffer;
+                    std::pair<char_type const *,char_type const *> fmt = message_.view(loc,0,buffer);
+                    return details::format_output(out,loc,fmt.first,fmt.second,parameters(*this));
+                }
+                else
+                    return details::format_output(out,loc,format_.data(),format_.data() + format_.size(),parameters(*this));
             }
                         
             
         private:
 
-            class format_guard {
+            //
+            // The parameters of format_output
+            //
+            class parameters {
             public:
-                format_guard(details::format_parser &fmt) : 
-                    fmt_(&fmt),
-                    restored_(false)
+                parameters(basic_format const &self) :
+                    self_(self)
                 {
                 }
-                void restore()
+                bool text(unsigned id,CharType const *&begin,CharType const *&end) const
                 {
-                    if(restored_)
-                        return;
-                    fmt_->restore();
-                    restored_ = true;
+                    formattible_type const *param = self_.get(id);
+                    if(!param) {
+                        begin = end = 0;
+                        return true;
+                    }
+                    return param->text(begin,end);
                 }
-                ~format_guard()
+                void write(stream_type &out,unsigned id) const
                 {
-                    try {
-                        restore();
-                    }
-                    catch(...) {
-                    }
+                    formattible_type const *param = self_.get(id);
+                    if(param)
+                        out << *param;
+                    else
+                        out << formattible_type();
                 }
             private:
-                details::format_parser *fmt_;
-                bool restored_;
+                basic_format const &self_;
             };
-            
-            void format_output(stream_type &out,string_type const &sformat) const
-            {
-                char_type obrk='{';
-                char_type cbrk='}';
-                char_type eq='=';
-                char_type comma=',';
-                char_type quote='\'';
-
-                size_t pos = 0;
-                size_t size=sformat.size();
-                CharType const *format=sformat.c_str();
-                while(format[pos]!=0) {
-                    if(format[pos] != obrk) {
-                        if(format[pos]==cbrk && format[pos+1]==cbrk) {
-                            out << cbrk;
-                            pos+=2;
-                        }
-                        else {
-                            out<<format[pos];
-                            pos++;
-                        }
-                        continue;
-                    }
-
-                    if(pos+1 < size && format[pos+1]==obrk) {
-                        out << obrk;
-                        pos+=2;
-                        continue;
-                    }
-                    pos++;
-                  
-                    details::format_parser fmt(out,static_cast<void *>(&out),&basic_format::imbue_locale);
-
-                    format_guard guard(fmt);
-
-                    while(pos < size) { 
-                        std::string key;
-                        std::string svalue;
-                        string_type value;
-                        bool use_svalue = true;
-                        for(;format[pos];pos++) {
-                            char_type c=format[pos];
-                            if(c==comma || c==eq || c==cbrk)
-                                break;
-                            else {
-                                key+=static_cast<char>(c);
-                            }
-                        }
 
-                        if(format[pos]==eq) {
-                            pos++;
-                            if(format[pos]==quote) {
-                                pos++;
-                                use_svalue = false;
-                                while(format[pos]) {
-                                    if(format[pos]==quote) {
-                                        if(format[pos+1]==quote) {
-                                            value+=quote;
-                                            pos+=2;
-                                        }
-                                        else {
-                                            pos++;
-                                            break;
-                                        }
-                                    }
-                                    else {
-                                        value+=format[pos];
-                                        pos++;
-                                    }
-                                }
-                            }
-                            else {
-                                char_type c;
-                                while((c=format[pos])!=0 && c!=comma && c!=cbrk) {
-                                    svalue+=static_cast<char>(c);
-                                    pos++;
-                                }
-                            }
-                        }
-
-                        if(use_svalue) {
-                            fmt.set_one_flag(key,svalue);
-                        }
-                        else 
-                            fmt.set_flag_with_str(key,value);
-                        
-                        if(format[pos]==comma) {
-                            pos++;
-                            continue;
-                        }
-                        else if(format[pos]==cbrk)  {
-                            unsigned position = fmt.get_position();
-                            out << get(position);
-                            guard.restore();
-                            pos++;
-                            break;
-                        }
-                        else {                        
-                            guard.restore();
-                            break;
-                        }
-                    }
-                }
-            }
-
-      
             //
             // Non-copyable 
             //
@@ -421,19 +916,14 @@ namespace boost {
                 parameters_count_++;
             }
 
-            formattible_type get(unsigned id) const
+            formattible_type const *get(unsigned id) const
             {
                 if(id >= parameters_count_)
-                    return formattible_type();
+                    return 0;
                 else if(id >= base_params_)
-                    return ext_params_[id - base_params_];
+                    return &ext_params_[id - base_params_];
                 else
-                    return parameters_[id];
-            }
-
-            static void imbue_locale(void *ptr,std::locale const &l)
-            {
-                reinterpret_cast<stream_type *>(ptr)->imbue(l);
+                    return &parameters_[id];
             }
 
 
@@ -462,6 +952,102 @@ namespace boost {
             return out;
         }
 
+        ///
+        /// Format the string \a fmt with parameters \a a1 ... and write the result to the output iterator \a out using
+        /// locale \a loc, returns the iterator past the last written character.
+        ///
+        /// The result is the same as of basic_format::write(OutputIterator,std::locale const &) but the parameters
+        /// are kept with their types, so writing them requires no indirect calls. It is available for up to
+        /// four parameters. For example:
+        ///
+        /// \code
+        ///   std::string text;
+        ///   format_to(std::back_inserter(text),loc,"{1} has {2,num} messages",name,count);
+        /// \endcode
+        ///
+        template<typename OutputIterator,typename CharType,typename T1>
+        OutputIterator format_to(OutputIterator out,std::locale const &loc,std::basic_string<CharType> const &fmt,T1 const &a1)
+        {
+            return details::format_output(out,loc,fmt.data(),fmt.data() + fmt.size(),details::format_arguments<CharType,T1>(&a1));
+        }
+
+        template<typename OutputIterator,typename CharType,typename T1,typename T2>
+        OutputIterator format_to(OutputIterator out,std::locale const &loc,std::basic_string<CharType> const &fmt,T1 const &a1,T2 const &a2)
+        {
+            return details::format_output(out,loc,fmt.data(),fmt.data() + fmt.size(),details::format_arguments<CharType,T1,T2>(&a1,&a2));
+        }
+
+        template<typename OutputIterator,typename CharType,typename T1,typename T2,typename T3>
+        OutputIterator format_to(OutputIterator out,std::locale const &loc,std::basic_string<CharType> const &fmt,T1 const &a1,T2 const &a2,T3 const &a3)
+        {
+            return details::format_output(out,loc,fmt.data(),fmt.data() + fmt.size(),details::format_arguments<CharType,T1,T2,T3>(&a1,&a2,&a3));
+        }
+
+        template<typename OutputIterator,typename CharType,typename T1,typename T2,typename T3,typename T4>
+        OutputIterator format_to(OutputIterator out,std::locale const &loc,std::basic_string<CharType> const &fmt,T1 const &a1,T2 const &a2,T3 const &a3,T4 const &a4)
+        {
+            return details::format_output(out,loc,fmt.data(),fmt.data() + fmt.size(),details::format_arguments<CharType,T1,T2,T3,T4>(&a1,&a2,&a3,&a4));
+        }
+
+        ///
+        /// Same as format_to for a format string, for the null terminated format string \a fmt, so a literal
+        /// is not copied to a temporary string
+        ///
+        template<typename OutputIterator,typename CharType,typename T1>
+        OutputIterator format_to(OutputIterator out,std::locale const &loc,CharType const *fmt,T1 const &a1)
+        {
+            return details::format_output(out,loc,fmt,fmt + std::char_traits<CharType>::length(fmt),details::format_arguments<CharType,T1>(&a1));
+        }
+
+        template<typename OutputIterator,typename CharType,typename T1,typename T2>
+        OutputIterator format_to(OutputIterator out,std::locale const &loc,CharType const *fmt,T1 const &a1,T2 const &a2)
+        {
+            return details::format_output(out,loc,fmt,fmt + std::char_traits<CharType>::length(fmt),details::format_arguments<CharType,T1,T2>(&a1,&a2));
+        }
+
+        template<typename OutputIterator,typename CharType,typename T1,typename T2,typename T3>
+        OutputIterator format_to(OutputIterator out,std::locale const &loc,CharType const *fmt,T1 const &a1,T2 const &a2,T3 const &a3)
+        {
+            return details::format_output(out,loc,fmt,fmt + std::char_traits<CharType>::length(fmt),details::format_arguments<CharType,T1,T2,T3>(&a1,&a2,&a3));
+        }
+
+        template<typename OutputIterator,typename CharType,typename T1,typename T2,typename T3,typename T4>
+        OutputIterator format_to(OutputIterator out,std::locale const &loc,CharType const *fmt,T1 const &a1,T2 const &a2,T3 const &a3,T4 const &a4)
+        {
+            return details::format_output(out,loc,fmt,fmt + std::char_traits<CharType>::length(fmt),details::format_arguments<CharType,T1,T2,T3,T4>(&a1,&a2,&a3,&a4));
+        }
+
+        ///
+        /// Translate the message \a fmt using locale \a loc and the default messages domain, then format it with
+        /// parameters \a a1 ... as format_to does for a format string.
+        ///
+        /// The translation is used in place as basic_message::view() returns it, it is copied only if the message
+        /// has to be converted to the locale's encoding.
+        ///
+        template<typename OutputIterator,typename CharType,typename T1>
+        OutputIterator format_to(OutputIterator out,std::locale const &loc,basic_message<CharType> const &fmt,T1 const &a1)
+        {
+            return details::format_message(out,loc,fmt,details::format_arguments<CharType,T1>(&a1));
+        }
+
+        template<typename OutputIterator,typename CharType,typename T1,typename T2>
+        OutputIterator format_to(OutputIterator out,std::locale const &loc,basic_message<CharType> const &fmt,T1 const &a1,T2 const &a2)
+        {
+            return details::format_message(out,loc,fmt,details::format_arguments<CharType,T1,T2>(&a1,&a2));
+        }
+
+        template<typename OutputIterator,typename CharType,typename T1,typename T2,typename T3>
+        OutputIterator format_to(OutputIterator out,std::locale const &loc,basic_message<CharType> const &fmt,T1 const &a1,T2 const &a2,T3 const &a3)
+        {
+            return details::format_message(out,loc,fmt,details::format_arguments<CharType,T1,T2,T3>(&a1,&a2,&a3));
+        }
+
+        template<typename OutputIterator,typename CharType,typename T1,typename T2,typename T3,typename T4>
+        OutputIterator format_to(OutputIterator out,std::locale const &loc,basic_message<CharType> const &fmt,T1 const &a1,T2 const &a2,T3 const &a3,T4 const &a4)
+        {
+            return details::format_message(out,loc,fmt,details::format_arguments<CharType,T1,T2,T3,T4>(&a1,&a2,&a3,&a4));
+        }
+
 
         ///
         /// Definition of char based format
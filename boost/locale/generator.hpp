@@ -135,6 +135,16 @@ namespace boost {
             ///
             void clear_domains();
 
+            ///
+            /// Get the integer id of the messages domain \a domain, given as "name" or "name/encoding", in the
+            /// locales created by this generator. Returns -1 if the domain was not added.
+            ///
+            /// The id can be passed to basic_message::str(std::locale const &,int), as::domain(int) or
+            /// message_format::get directly, so the domain name is not looked up for each translation.
+            /// It is valid for all the locales generated while the list of domains remains the same.
+            ///
+            int messages_domain_id(std::string const &domain) const;
+
             ///
             /// Add a search path where dictionaries are looked in.
             ///
@@ -157,7 +167,8 @@ namespace boost {
             void clear_paths();
 
             ///
-            /// Remove all cached locales
+            /// Remove all cached locales and forget the contents of the directories message catalogs were
+            /// searched in, see gnu_gettext::clear_catalog_search_cache
             ///
             void clear_cache();
 
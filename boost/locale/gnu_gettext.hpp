@@ -10,7 +10,13 @@
 
 #include <boost/locale/message.hpp>
 #include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
 #include <stdexcept>
+#include <memory>
+#ifdef BOOST_MSVC
+#  pragma warning(push)
+#  pragma warning(disable : 4275 4251 4231 4660)
+#endif
 
 namespace boost {
 namespace locale {
@@ -23,6 +29,24 @@ namespace locale {
 ///
 namespace gnu_gettext {
 
+    ///
+    /// \brief This structure describes a read-only memory region that holds a complete message catalog
+    ///
+    /// The memory [\a begin, \a end) is used directly without copying, so it must remain valid for
+    /// as long as \a holder is alive. For example \a holder may own a memory mapping of a resource
+    /// archive or it may be empty when the catalog is a part of static data.
+    ///
+    struct catalog_region {
+        catalog_region() : 
+            begin(0),
+            end(0)
+        {
+        }
+        char const *begin;                  ///< The first byte of the catalog
+        char const *end;                    ///< One past the last byte of the catalog
+        boost::shared_ptr<void> holder;     ///< The object that keeps the memory alive
+    };
+
     ///
     /// \brief This structure holds all information required for creating gnu-gettext message catalogs,
     ///
@@ -34,7 +58,14 @@ namespace gnu_gettext {
     struct messages_info {
         messages_info() :
             language("C"),
-            locale_category("LC_MESSAGES")
+            locale_category("LC_MESSAGES"),
+            use_mmap(true),
+            lazy_conversion(true),
+            compiled_catalogs(true),
+            collect_statistics(false),
+            load_threads(0),
+            reload_callback_catalogs(false),
+            reload_grace_period(60)
         {
         }
 
@@ -124,6 +155,87 @@ namespace gnu_gettext {
         /// 
         callback_type callback;
 
+        ///
+        /// The callback for custom file systems that are able to provide catalogs without copying them,
+        /// for example from a memory mapped resource archive. It should return the region holding the
+        /// file named \a file_name encoded in \a encoding character set.
+        ///
+        /// - If the file does not exist, it should return a region with \a begin equal to 0.
+        /// - If a error occurs during file read it should throw a error.
+        ///
+        /// If it is set it is used instead of \ref callback.
+        ///
+        typedef function<
+                    catalog_region(
+                        std::string const &file_name,
+                        std::string const &encoding
+                    )
+                > mapped_callback_type;
+
+        ///
+        /// The callback for handling custom file systems with zero copy catalogs, if it is empty,
+        /// \ref callback or the real OS file-system is being used.
+        ///
+        mapped_callback_type mapped_callback;
+
+        ///
+        /// When the real OS file-system is used, map catalog files to memory instead of reading
+        /// them to a private buffer, so they are served directly from the page cache and shared
+        /// between processes. Default is true.
+        ///
+        /// \note A mapped file must not be truncated or overwritten in place while it is in use, this crashes the
+        /// readers (SIGBUS on POSIX systems) and is refused on Windows. A new version should be written to a
+        /// separate file that is renamed over the old one. Set it to false if catalog files are updated in place.
+        ///
+        bool use_mmap;
+
+        ///
+        /// When the catalog needs conversion to the target encoding or character type, keep the
+        /// original catalog and convert each translation when it is requested for the first time,
+        /// instead of converting the entire catalog when it is loaded. Default is true.
+        ///
+        /// \note Translations that can't be converted are treated as missing, rather than
+        /// failing the creation of the facet.
+        ///
+        bool lazy_conversion;
+
+        ///
+        /// Look for a compiled catalog \c domain.mcat created by the \c compile_catalog tool before looking
+        /// for \c domain.mo in each directory. Compiled catalogs hold translations ready for every character
+        /// type and are used without any conversion or indexing when they are loaded. Default is true.
+        ///
+        /// \note Narrow character catalogs are used only for UTF-8 locales, otherwise the \c .mo file is used.
+        ///
+        bool compiled_catalogs;
+
+        ///
+        /// Count the lookups that found a translation and those that did not in each domain, the numbers
+        /// are reported by message_format::statistics. Default is false.
+        ///
+        /// \note It has no effect if the library was built with \c BOOST_LOCALE_NO_CATALOG_STATISTICS defined.
+        ///
+        bool collect_statistics;
+
+        ///
+        /// The number of threads that load the catalogs of different domains concurrently, the calling thread
+        /// is one of them. Default is 0 - all catalogs are loaded by the calling thread.
+        ///
+        unsigned load_threads;
+
+        ///
+        /// Catalogs provided by \ref callback or \ref mapped_callback have no version to check, so
+        /// message_format::reload() considers them unchanged. Set it to true to load them again
+        /// on each reload, the catalogs whose bytes did not change are kept. Default is false.
+        ///
+        bool reload_callback_catalogs;
+
+        ///
+        /// The number of seconds the catalogs replaced by message_format::reload() are kept, so the translations
+        /// taken from them remain valid. They are released by a reload that happens at least this long after
+        /// they were replaced. Default is 60.
+        ///
+        unsigned reload_grace_period;
+
     };
 
     ///
@@ -134,6 +246,44 @@ namespace gnu_gettext {
     template<typename CharType>
     message_format<CharType> *create_messages_facet(messages_info const &info);
 
+    ///
+    /// Forget the contents of the directories catalogs were searched in.
+    ///
+    /// When catalogs are loaded from the real file system, each directory in the search paths is listed once
+    /// per process and the catalogs that are not in the list are not searched for. This function should be called
+    /// when catalog files are added, so the facets created afterwards find them. generator::clear_cache calls it as well.
+    ///
+    BOOST_LOCALE_DECL void clear_catalog_search_cache();
+
+    ///
+    /// \brief Reloads the message catalogs of a locale when their files change
+    ///
+    /// The watcher calls message_format::reload() for every message_format facet of the locale each
+    /// \a interval_ms milliseconds in a background thread, until it is destroyed. Errors of loading the
+    /// changed catalogs are ignored and the catalogs in use are kept.
+    ///
+    /// The translations taken from the replaced catalogs remain valid for messages_info::reload_grace_period
+    /// seconds, see message_format::reload().
+    ///
+    /// \note Catalog files should be replaced only by renaming a new file over the old one. When
+    /// messages_info::use_mmap is set, the files in use are mapped to memory and writing them in place
+    /// crashes the readers before the watcher notices the change.
+    ///
+    /// \note Catalogs that are loaded using messages_info::callback or messages_info::mapped_callback have no
+    /// version to check, so they are loaded again only if messages_info::reload_callback_catalogs is set.
+    ///
+    class BOOST_LOCALE_DECL catalog_watcher {
+    public:
+        catalog_watcher(std::locale const &loc,unsigned interval_ms = 1000);
+        ~catalog_watcher();
+    private:
+        catalog_watcher(catalog_watcher const &);
+        void operator=(catalog_watcher const &);
+
+        struct data;
+        std::auto_ptr<data> d;
+    };
+
     /// \cond INTERNAL
     
     template<>
@@ -161,6 +311,10 @@ namespace gnu_gettext {
 } // locale
 } // boost
 
+#ifdef BOOST_MSVC
+#pragma warning(pop)
+#endif
+
 #endif
 
 // vim: tabstop=4 expandtab shiftwidth=4 softtabstop=4
@@ -18,7 +18,13 @@
 #include <vector>
 #include <set>
 #include <memory>
+#include <algorithm>
+#include <utility>
+#include <boost/cstdint.hpp>
+#include <boost/type_traits/integral_constant.hpp>
 #include <boost/locale/formatting.hpp>
+#include <boost/locale/utf.hpp>
+#include <string.h>
 
 
 namespace boost {
@@ -39,6 +45,167 @@ namespace boost {
         };
        
         /// \endcond
+
+        ///
+        /// \brief Precomputed hash of a message key as used by GNU gettext catalogs
+        ///
+        /// It is the PJW hash of the code units of the message id, or of the context,
+        /// the EOT character (4) and the id when the context is not empty. It is usually
+        /// created at compile time by \ref BOOST_LOCALE_TRANSLATE and similar macros.
+        ///
+        struct message_key_hash {
+            ///
+            /// Create the hash object from its \a value
+            ///
+            explicit message_key_hash(boost::uint32_t v = 0) : value(v) {}
+            boost::uint32_t value; ///< The hash value
+        };
+
+        /// \cond INTERNAL
+
+        #if !defined(BOOST_NO_CXX11_CONSTEXPR) && !defined(BOOST_NO_CONSTEXPR)
+        #define BOOST_LOCALE_CONSTEXPR constexpr
+        #define BOOST_LOCALE_HAS_CONSTEXPR_HASH
+        #else
+        #define BOOST_LOCALE_CONSTEXPR
+        #endif
+
+        namespace details {
+            // written as single expressions so they can be evaluated at compile time
+
+            BOOST_LOCALE_CONSTEXPR inline boost::uint32_t pjw_hash_fold(boost::uint32_t value)
+            {
+                return (value & 0xF0000000U) ? (value ^ ((value & 0xF0000000U) >> 24)) ^ (value & 0xF0000000U) : value;
+            }
+            BOOST_LOCALE_CONSTEXPR inline boost::uint32_t pjw_hash_unit(char c)
+            {
+                return static_cast<unsigned char>(c);
+            }
+            template<typename CharType>
+            BOOST_LOCALE_CONSTEXPR inline boost::uint32_t pjw_hash_unit(CharType c)
+            {
+                return static_cast<boost::uint32_t>(c);
+            }
+            template<typename CharType>
+            BOOST_LOCALE_CONSTEXPR inline boost::uint32_t pjw_hash_step(CharType c,boost::uint32_t value)
+            {
+                return pjw_hash_fold((value << 4) + pjw_hash_unit(c));
+            }
+            #if defined(__cpp_constexpr) && __cpp_constexpr >= 201304
+            template<typename CharType>
+            constexpr inline boost::uint32_t pjw_hash(CharType const *str,boost::uint32_t value = 0)
+            {
+                while(*str)
+                    value = pjw_hash_step(*str++,value);
+                return value;
+            }
+            #else
+            //
+            // C++11 constexpr functions can only recurse, so the string is hashed 8 units per call
+            // to keep the depth of recursion within the compiler limits for long literals
+            //
+            template<typename CharType>
+            BOOST_LOCALE_CONSTEXPR inline bool pjw_hash_has_8(CharType const *str)
+            {
+                return str[0] && str[1] && str[2] && str[3] && str[4] && str[5] && str[6] && str[7];
+            }
+            template<typename CharType>
+            BOOST_LOCALE_CONSTEXPR inline boost::uint32_t pjw_hash_8(CharType const *str,boost::uint32_t value)
+            {
+                return  pjw_hash_step(str[7],pjw_hash_step(str[6],pjw_hash_step(str[5],pjw_hash_step(str[4],
+                        pjw_hash_step(str[3],pjw_hash_step(str[2],pjw_hash_step(str[1],pjw_hash_step(str[0],value))))))));
+            }
+            template<typename CharType>
+            BOOST_LOCALE_CONSTEXPR inline boost::uint32_t pjw_hash(CharType const *str,boost::uint32_t value = 0)
+            {
+                return  pjw_hash_has_8(str) ? pjw_hash(str + 8,pjw_hash_8(str,value))
+                        : *str ? pjw_hash(str + 1,pjw_hash_step(*str,value)) : value;
+            }
+            #endif
+            template<typename CharType>
+            BOOST_LOCALE_CONSTEXPR inline boost::uint32_t message_key_hash_value(CharType const *id)
+            {
+                return pjw_hash(id);
+            }
+            template<typename CharType>
+            BOOST_LOCALE_CONSTEXPR inline boost::uint32_t message_key_hash_value(CharType const *context,CharType const *id)
+            {
+                return *context ? pjw_hash(id,pjw_hash_fold((pjw_hash(context) << 4) + 4)) : pjw_hash(id);
+            }
+        } // details
+
+        /// \endcond
+
+        ///
+        /// \brief Number of lookups of messages in a single domain, see message_format::statistics
+        ///
+        struct message_lookup_statistics {
+            boost::uint64_t hits;       ///< Lookups that found the translation of the message
+            boost::uint64_t misses;     ///< Lookups of the messages that are not translated
+        };
+
+        ///
+        /// \brief Memory use and activity of the catalog of a single domain, see message_format::statistics
+        ///
+        struct message_catalog_statistics {
+            ///
+            /// The way the catalog is used for lookups
+            ///
+            enum storage_type {
+                no_catalog,             ///< The catalog of the domain was not found
+                mo_file,                ///< The mo file is used as is
+                converted_on_demand,    ///< The mo file is used and each translation is converted when it is requested first
+                converted,              ///< The whole catalog was converted when it was loaded
+                compiled                ///< The compiled catalog is used as is
+            };
+
+            storage_type storage;           ///< The way the catalog is used
+            size_t entries;                 ///< The number of messages in the catalog
+            size_t file_bytes;              ///< The size of the catalog file that is mapped or read to memory
+            size_t index_bytes;             ///< The memory allocated for the indexes and the filters of the catalog
+            size_t converted_bytes;         ///< The memory allocated for converted keys and translations
+            boost::uint64_t conversions;    ///< The number of translations converted on demand
+            boost::uint64_t conversion_time;///< Time spent converting the catalog and its translations, in microseconds
+            boost::uint64_t failed_key_conversions; ///< Lookups of keys that can't be converted to the encoding of the catalog, they are misses
+            message_lookup_statistics lookups; ///< Lookups done by this facet, zero unless they are collected
+        };
+
+        ///
+        /// \brief A single message looked up by message_format::get_batch or \ref translate_batch
+        ///
+        /// It is an aggregate, so tables of requests can be initialized statically, for example
+        /// <tt>{ 0, "Open", 0, 0, false, 0 }</tt>.
+        ///
+        template<typename CharType>
+        struct basic_message_request {
+            CharType const *context;    ///< The context of the message, NULL or empty if none
+            CharType const *id;         ///< The message id, the singular form for plural messages
+            CharType const *plural;     ///< The plural form, NULL for messages without plural forms
+            int n;                      ///< The number the plural form is selected for
+            bool has_hash;              ///< True if \a hash holds the hash of the key computed in advance
+            boost::uint32_t hash;       ///< The value of message_key_hash of the context and id
+        };
+
+        ///
+        /// Convenience typedef for char
+        ///
+        typedef basic_message_request<char> message_request;
+        ///
+        /// Convenience typedef for wchar_t
+        ///
+        typedef basic_message_request<wchar_t> wmessage_request;
+        #ifdef BOOST_HAS_CHAR16_T
+        ///
+        /// Convenience typedef for char16_t
+        ///
+        typedef basic_message_request<char16_t> u16message_request;
+        #endif
+        #ifdef BOOST_HAS_CHAR32_T
+        ///
+        /// Convenience typedef for char32_t
+        ///
+        typedef basic_message_request<char32_t> u32message_request;
+        #endif
        
         ///
         /// \brief This facet provides message formatting abilities
@@ -91,6 +258,72 @@ namespace boost {
             ///
             virtual char_type const *get(int domain_id,char_type const *context,char_type const *single_id,int n) const = 0;
 
+            ///
+            /// Same as get(domain_id,context,id) but uses the \a hash of the key computed in advance,
+            /// so it does not need to be calculated for each lookup. The \a hash must match
+            /// \a context and \a id otherwise the message is not found.
+            ///
+            virtual char_type const *get(int domain_id,char_type const *context,char_type const *id,message_key_hash /*hash*/) const
+            {
+                return get(domain_id,context,id);
+            }
+            ///
+            /// Same as get(domain_id,context,single_id,n) but uses the \a hash of the key computed in advance,
+            /// so it does not need to be calculated for each lookup. The \a hash must match
+            /// \a context and \a single_id otherwise the message is not found.
+            ///
+            virtual char_type const *get(int domain_id,char_type const *context,char_type const *single_id,int n,message_key_hash /*hash*/) const
+            {
+                return get(domain_id,context,single_id,n);
+            }
+
+            ///
+            /// Look up \a count messages given by \a requests in a domain defined by \a domain_id. The translation
+            /// of each request, or NULL if it is not found, is stored in the corresponding element of
+            /// \a translations. A request with non-NULL \a plural member is looked up as get(domain_id,context,id,n)
+            /// does, otherwise as get(domain_id,context,id).
+            ///
+            /// It gives the same results as calling \a get for each request, but allows the implementation to resolve
+            /// the domain once and to overlap memory accesses of different lookups.
+            ///
+            virtual void get_batch( int domain_id,
+                                    basic_message_request<char_type> const *requests,
+                                    size_t count,
+                                    char_type const **translations) const
+            {
+                for(size_t i=0;i<count;i++) {
+                    basic_message_request<char_type> const &r = requests[i];
+                    if(r.has_hash) {
+                        if(r.plural)
+                            translations[i] = get(domain_id,r.context,r.id,r.n,message_key_hash(r.hash));
+                        else
+                            translations[i] = get(domain_id,r.context,r.id,message_key_hash(r.hash));
+                    }
+                    else if(r.plural) {
+                        translations[i] = get(domain_id,r.context,r.id,r.n);
+                    }
+                    else {
+                        translations[i] = get(domain_id,r.context,r.id);
+                    }
+                }
+            }
+
+            ///
+            /// Look up a single \a request in a domain defined by \a domain_id as get_batch does and return
+            /// the range of the null terminated translation, so its length does not have to be computed by the
+            /// caller. A pair of NULL pointers is returned if the message is not found.
+            ///
+            /// Default implementation calls get_batch and finds the end of the translation.
+            ///
+            virtual std::pair<char_type const *,char_type const *> get_range(int domain_id,basic_message_request<char_type> const &request) const
+            {
+                char_type const *translation = 0;
+                get_batch(domain_id,&request,1,&translation);
+                if(!translation)
+                    return std::pair<char_type const *,char_type const *>((char_type const *)0,(char_type const *)0);
+                return std::pair<char_type const *,char_type const *>(translation,translation + std::char_traits<char_type>::length(translation));
+            }
+
             ///
             /// Convert a string that defines \a domain to the integer id used by \a get functions
             ///
@@ -106,6 +339,64 @@ namespace boost {
             ///
             virtual char_type const *convert(char_type const *msg,string_type &buffer) const = 0;
 
+            ///
+            /// Returns the version of the catalogs used by this facet. It changes whenever the translations
+            /// returned by the facet change, so the pointers returned by \a get functions that were cached
+            /// by the user, for example by \ref basic_cached_message, must be fetched again.
+            ///
+            /// Default implementation returns 0 - the translations never change.
+            ///
+            virtual unsigned generation() const
+            {
+                return 0;
+            }
+
+            ///
+            /// Load again the catalogs whose files were changed, added or removed since they were loaded, without
+            /// creating a new facet. Returns true if any catalog was replaced, in which case generation() changes.
+            ///
+            /// The new catalogs are loaded and swapped in while other threads keep translating with the old ones,
+            /// the readers are never blocked. The replaced catalogs are kept for a grace period, so the translations
+            /// returned before a reload remain valid until a later reload that happens at least
+            /// gnu_gettext::messages_info::reload_grace_period seconds after it. To bound the memory, a limited number
+            /// of replaced catalogs is kept: when all of them are still in their grace period, the changes are
+            /// not loaded and false is returned, a later call loads them.
+            ///
+            /// If loading fails the exception is thrown and the current catalogs remain in use.
+            ///
+            /// \note Catalog files should be replaced only by renaming a new file over the old one: the files in use
+            /// may be mapped to memory, see gnu_gettext::messages_info::use_mmap, and writing them in place crashes
+            /// the readers.
+            ///
+            /// Default implementation does nothing and returns false.
+            ///
+            virtual bool reload() const
+            {
+                return false;
+            }
+
+            ///
+            /// Get the number of lookups in the domain defined by \a domain_id performed by this facet
+            /// and store it in \a stats. Returns false if the facet does not collect the statistics - the default.
+            ///
+            virtual bool statistics(int /*domain_id*/,message_lookup_statistics &/*stats*/) const
+            {
+                return false;
+            }
+
+            ///
+            /// Get the memory used by the catalog of the domain defined by \a domain_id and the work done with it
+            /// and store it in \a stats. The catalogs may be shared with other facets, except for \a stats.lookups
+            /// the numbers cover all of them.
+            ///
+            /// Returns false if the facet does not provide the statistics - the default, or if the library was built
+            /// with \c BOOST_LOCALE_NO_CATALOG_STATISTICS defined.
+            ///
+            virtual bool statistics(int /*domain_id*/,message_catalog_statistics &/*stats*/) const
+            {
+                return false;
+            }
+
 #if defined (__SUNPRO_CC) && defined (_RWSTD_VER)
             std::locale::id& __get_id (void) const { return id; }
 #endif
@@ -132,6 +423,26 @@ namespace boost {
                 }
                 return true;
             }
+            inline bool is_us_ascii_string(char const *begin,char const *end)
+            {
+                #ifdef BOOST_LOCALE_UTF_SSE2
+                __m128i const zero = _mm_setzero_si128();
+                __m128i const del = _mm_set1_epi8(0x7F);
+                while(end - begin >= 16) {
+                    __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(begin));
+                    // bytes in 1-0x7E are greater than zero as signed and differ from DEL
+                    __m128i good = _mm_andnot_si128(_mm_cmpeq_epi8(v,del),_mm_cmpgt_epi8(v,zero));
+                    if(_mm_movemask_epi8(good) != 0xFFFF)
+                        return false;
+                    begin += 16;
+                }
+                #endif
+                while(begin!=end) {
+                    if(!is_us_ascii_char(*begin++))
+                        return false;
+                }
+                return true;
+            }
 
             template<typename CharType>
             struct string_cast_traits {
@@ -182,7 +493,9 @@ namespace boost {
                 n_(0),
                 c_id_(0),
                 c_context_(0),
-                c_plural_(0)
+                c_plural_(0),
+                has_hash_(false),
+                hash_(0)
             {
             }
 
@@ -194,7 +507,9 @@ namespace boost {
                 n_(0),
                 c_id_(id),
                 c_context_(0),
-                c_plural_(0)
+                c_plural_(0),
+                has_hash_(false),
+                hash_(0)
             {
             }
 
@@ -208,7 +523,9 @@ namespace boost {
                 n_(n),
                 c_id_(single),
                 c_context_(0),
-                c_plural_(plural)
+                c_plural_(plural),
+                has_hash_(false),
+                hash_(0)
             {
             }
 
@@ -221,7 +538,9 @@ namespace boost {
                 n_(0),
                 c_id_(id),
                 c_context_(context),
-                c_plural_(0)
+                c_plural_(0),
+                has_hash_(false),
+                hash_(0)
             {
             }
 
@@ -235,10 +554,28 @@ namespace boost {
                 n_(n),
                 c_id_(single),
                 c_context_(context),
-                c_plural_(plural)
+                c_plural_(plural),
+                has_hash_(false),
+                hash_(0)
             {
             }
 
+            ///
+            /// Create a message from 0 terminated strings, optional \a context (may be NULL), \a single id,
+            /// optional \a plural form (may be NULL) and number \a n, using \a hash of the key that was computed
+            /// in advance. The strings should exist until the message is destroyed.
+            ///
+            /// Generally it is created using \ref BOOST_LOCALE_TRANSLATE family of macros
+            ///
+            basic_message(char_type const *context,char_type const *single,char_type const *plural,int n,message_key_hash hash) :
+                n_(n),
+                c_id_(single),
+                c_context_(context && *context ? context : 0),
+                c_plural_(plural),
+                has_hash_(true),
+                hash_(hash.value)
+            {
+            }
 
             ///
             /// Create a simple message from a string.
@@ -248,6 +585,8 @@ namespace boost {
                 c_id_(0),
                 c_context_(0),
                 c_plural_(0),
+                has_hash_(false),
+                hash_(0),
                 id_(id)
             {
             }
@@ -262,6 +601,8 @@ namespace boost {
                 c_id_(0),
                 c_context_(0),
                 c_plural_(0),
+                has_hash_(false),
+                hash_(0),
                 id_(single),
                 plural_(plural)
             {
@@ -275,6 +616,8 @@ namespace boost {
                 c_id_(0),
                 c_context_(0),
                 c_plural_(0),
+                has_hash_(false),
+                hash_(0),
                 id_(id),
                 context_(context)
             {
@@ -290,6 +633,8 @@ namespace boost {
                 c_id_(0),
                 c_context_(0),
                 c_plural_(0),
+                has_hash_(false),
+                hash_(0),
                 id_(single),
                 context_(context),
                 plural_(plural)
@@ -304,6 +649,8 @@ namespace boost {
                 c_id_(other.c_id_),
                 c_context_(other.c_context_),
                 c_plural_(other.c_plural_),
+                has_hash_(other.has_hash_),
+                hash_(other.hash_),
                 id_(other.id_),
                 context_(other.context_),
                 plural_(other.plural_)
@@ -332,6 +679,8 @@ namespace boost {
                 std::swap(c_id_,other.c_id_);
                 std::swap(c_context_,other.c_context_);
                 std::swap(c_plural_,other.c_plural_);
+                std::swap(has_hash_,other.has_hash_);
+                std::swap(hash_,other.hash_);
 
                 id_.swap(other.id_);
                 context_.swap(other.context_);
@@ -415,6 +764,62 @@ namespace boost {
                 out << write(loc,id,buffer);
             }
 
+            ///
+            /// Translate message using locale \a loc and message domain index \a domain_id without copying it.
+            ///
+            /// Returns the range of the null terminated translated string. When the translation is taken from the catalog
+            /// as is, the range points into the catalog and remains valid as long as a copy of \a loc exists, and
+            /// for the grace period after its catalogs are reloaded, see message_format::reload(). If the message
+            /// is not translated the range points to the original string of this message, or, if it has to be converted
+            /// to the locale's encoding, the result is stored in \a buffer and the range points to its content.
+            ///
+            std::pair<char_type const *,char_type const *> view(std::locale const &loc,int domain_id,string_type &buffer) const
+            {
+                facet_type const *facet = 0;
+                if(std::has_facet<facet_type>(loc))
+                    facet = &std::use_facet<facet_type>(loc);
+                return write_range(facet,domain_id,buffer);
+            }
+
+            ///
+            /// Same as view(loc,domain_id,buffer) using the default domain
+            ///
+            std::pair<char_type const *,char_type const *> view(std::locale const &loc,string_type &buffer) const
+            {
+                return view(loc,0,buffer);
+            }
+
+            ///
+            /// Translate message using locale \a loc and message domain index \a domain_id and copy it to the
+            /// output iterator \a out, for example std::back_inserter of an existing buffer.
+            ///
+            /// No temporary string is created unless the message has to be converted.
+            ///
+            /// Returns the iterator past the last written character
+            ///
+            template<typename OutputIterator>
+            OutputIterator write_to(OutputIterator out,std::locale const &loc = std::locale(),int domain_id = 0) const
+            {
+                string_type buffer;
+                std::pair<char_type const *,char_type const *> range = view(loc,domain_id,buffer);
+                return std::copy(range.first,range.second,out);
+            }
+
+            ///
+            /// Translate message using locale \a loc and message domain \a domain and copy it to the
+            /// output iterator \a out
+            ///
+            /// Returns the iterator past the last written character
+            ///
+            template<typename OutputIterator>
+            OutputIterator write_to(OutputIterator out,std::locale const &loc,std::string const &domain) const
+            {
+                int id=0;
+                if(std::has_facet<facet_type>(loc))
+                    id=std::use_facet<facet_type>(loc).domain(domain);
+                return write_to(out,loc,id);
+            }
+
         private:
             char_type const *plural() const
             {
@@ -439,6 +844,17 @@ namespace boost {
             }
             
             char_type const *write(std::locale const &loc,int domain_id,string_type &buffer) const
+            {
+                facet_type const *facet = 0;
+                if(std::has_facet<facet_type>(loc))
+                    facet = &std::use_facet<facet_type>(loc);
+                return write(facet,domain_id,buffer);
+            }
+
+            template<typename C>
+            friend class basic_cached_message;
+
+            char_type const *write(facet_type const *facet,int domain_id,string_type &buffer) const
             {
                 char_type const *translated = 0;
                 static const char_type empty_string[1] = {0};
@@ -450,12 +866,14 @@ namespace boost {
                 if(*id == 0)
                     return empty_string;
                 
-                facet_type const *facet = 0;
-                if(std::has_facet<facet_type>(loc))
-                    facet = &std::use_facet<facet_type>(loc);
-
                 if(facet) { 
-                    if(!plural) {
+                    if(has_hash_) {
+                        if(!plural)
+                            translated = facet->get(domain_id,context,id,message_key_hash(hash_));
+                        else
+                            translated = facet->get(domain_id,context,id,n_,message_key_hash(hash_));
+                    }
+                    else if(!plural) {
                         translated = facet->get(domain_id,context,id);
                     }
                     else {
@@ -463,17 +881,47 @@ namespace boost {
                     }
                 }
 
-                if(!translated) {
-                    char_type const *msg = plural ? ( n_ == 1 ? id : plural) : id;
+                if(!translated)
+                    translated = untranslated(facet,buffer);
+                return translated;
+            }
 
-                    if(facet) {
-                        translated = facet->convert(msg,buffer);
-                    }
-                    else {
-                        translated = details::string_cast_traits<char_type>::cast(msg,buffer);
-                    }
+            std::pair<char_type const *,char_type const *> write_range(facet_type const *facet,int domain_id,string_type &buffer) const
+            {
+                typedef std::pair<char_type const *,char_type const *> range_type;
+
+                char_type const *id = this->id();
+                if(*id == 0)
+                    return range_type(id,id);
+
+                if(facet) {
+                    basic_message_request<char_type> request;
+                    request.context = context();
+                    request.id = id;
+                    request.plural = plural();
+                    request.n = n_;
+                    request.has_hash = has_hash_;
+                    request.hash = hash_;
+                    range_type translated = facet->get_range(domain_id,request);
+                    if(translated.first)
+                        return translated;
                 }
-                return translated;
+
+                char_type const *msg = untranslated(facet,buffer);
+                if(msg == buffer.c_str())
+                    return range_type(msg,msg + buffer.size());
+                return range_type(msg,msg + std::char_traits<char_type>::length(msg));
+            }
+
+            char_type const *untranslated(facet_type const *facet,string_type &buffer) const
+            {
+                char_type const *id = this->id();
+                char_type const *plural = this->plural();
+                char_type const *msg = plural ? ( n_ == 1 ? id : plural) : id;
+
+                if(facet)
+                    return facet->convert(msg,buffer);
+                return details::string_cast_traits<char_type>::cast(msg,buffer);
             }
 
             /// members
@@ -482,12 +930,177 @@ namespace boost {
             char_type const *c_id_;
             char_type const *c_context_;
             char_type const *c_plural_;
+            bool has_hash_;
+            boost::uint32_t hash_;
             string_type id_;
             string_type context_;
             string_type plural_;
         };
 
 
+        ///
+        /// \brief This class represents a message whose translation is looked up once and remembered
+        ///
+        /// It is designed for messages that are translated repeatedly by the same thread, for example in
+        /// tight loops. The translation is fetched from the catalog the first time it is requested and then
+        /// reused for as long as the same locale, domain and catalogs version (see message_format::generation())
+        /// are used, making each subsequent translation a simple comparison and a pointer load.
+        ///
+        /// \note The object is confined to a single thread: even its const member functions update the remembered
+        /// translation, so it must not be used by several threads at once, and in particular it must not be a
+        /// global or a function local static object that is shared between threads. Each thread should use its
+        /// own copy, for example a local variable or a member of a per-thread object.
+        ///
+        template<typename CharType>
+        class basic_cached_message {
+        public:
+            typedef CharType char_type; ///< The character this message object is used with
+            typedef std::basic_string<char_type> string_type;   ///< The string type this object can be used with
+            typedef message_format<char_type> facet_type;   ///< The type of the facet the messages are fetched with
+
+            ///
+            /// Create a cached message for \a msg using the domain of the stream it is written to
+            /// or the default domain
+            ///
+            explicit basic_cached_message(basic_message<char_type> const &msg) :
+                message_(msg),
+                has_domain_(false)
+            {
+                reset();
+            }
+
+            ///
+            /// Create a cached message for \a msg that is always looked up in the domain \a domain
+            ///
+            basic_cached_message(basic_message<char_type> const &msg,std::string const &domain) :
+                message_(msg),
+                domain_(domain),
+                has_domain_(true)
+            {
+                reset();
+            }
+
+            ///
+            /// Copy an object, the cached translation is not copied
+            ///
+            basic_cached_message(basic_cached_message const &other) :
+                message_(other.message_),
+                domain_(other.domain_),
+                has_domain_(other.has_domain_)
+            {
+                reset();
+            }
+
+            ///
+            /// Assign other message object to this one, the cached translation is dropped
+            ///
+            basic_cached_message const &operator=(basic_cached_message const &other)
+            {
+                if(this != &other) {
+                    message_ = other.message_;
+                    domain_ = other.domain_;
+                    has_domain_ = other.has_domain_;
+                    reset();
+                }
+                return *this;
+            }
+
+            ///
+            /// Drop the cached translation, so it would be looked up again on next use
+            ///
+            void reset()
+            {
+                valid_ = false;
+                translation_ = 0;
+                facet_ = 0;
+                generation_ = 0;
+                requested_domain_id_ = 0;
+                buffer_.clear();
+            }
+
+            ///
+            /// Get the translated null terminated string for locale \a loc, the pointer remains valid until the next
+            /// call to any member function of this object, and not longer than the grace period after the catalogs
+            /// of \a loc are reloaded, see message_format::reload()
+            ///
+            char_type const *c_str(std::locale const &loc) const
+            {
+                return get(loc,has_domain_ ? -1 : 0);
+            }
+
+            ///
+            /// Translate message to a string in the locale \a loc
+            ///
+            string_type str(std::locale const &loc) const
+            {
+                return c_str(loc);
+            }
+
+            ///
+            /// Translate message to a string in the default global locale
+            ///
+            string_type str() const
+            {
+                std::locale loc;
+                return c_str(loc);
+            }
+
+            ///
+            /// Message class can be explicitly converted to string class
+            ///
+            operator string_type () const
+            {
+                return str();
+            }
+
+            ///
+            /// Translate message and write to stream \a out, using imbued locale and domain set to the 
+            /// stream unless the domain was given explicitly
+            ///
+            void write(std::basic_ostream<char_type> &out) const
+            {
+                out << get(out.getloc(),has_domain_ ? -1 : ios_info::get(out).domain_id());
+            }
+
+        private:
+
+            // domain_id == -1 means the explicit domain
+            char_type const *get(std::locale const &loc,int domain_id) const
+            {
+                if(valid_ && domain_id == requested_domain_id_ && loc == locale_ 
+                   && (!facet_ || facet_->generation() == generation_))
+                {
+                    return translation_;
+                }
+                facet_type const *facet = 0;
+                if(std::has_facet<facet_type>(loc))
+                    facet = &std::use_facet<facet_type>(loc);
+                int id = domain_id;
+                if(domain_id == -1)
+                    id = facet ? facet->domain(domain_) : 0;
+                // keep the locale, so the facet and its catalogs are not destroyed
+                locale_ = loc;
+                facet_ = facet;
+                generation_ = facet ? facet->generation() : 0;
+                requested_domain_id_ = domain_id;
+                translation_ = message_.write(facet,id,buffer_);
+                valid_ = true;
+                return translation_;
+            }
+
+            basic_message<char_type> message_;
+            std::string domain_;
+            bool has_domain_;
+
+            mutable bool valid_;
+            mutable std::locale locale_;
+            mutable facet_type const *facet_;
+            mutable unsigned generation_;
+            mutable int requested_domain_id_;
+            mutable char_type const *translation_;
+            mutable string_type buffer_;
+        };
+
         ///
         /// Convenience typedef for char
         ///
@@ -509,6 +1122,27 @@ namespace boost {
         typedef basic_message<char32_t> u32message;
         #endif
 
+        ///
+        /// Convenience typedef for char
+        ///
+        typedef basic_cached_message<char> cached_message;
+        ///
+        /// Convenience typedef for wchar_t
+        ///
+        typedef basic_cached_message<wchar_t> wcached_message;
+        #ifdef BOOST_HAS_CHAR16_T
+        ///
+        /// Convenience typedef for char16_t
+        ///
+        typedef basic_cached_message<char16_t> u16cached_message;
+        #endif
+        #ifdef BOOST_HAS_CHAR32_T
+        ///
+        /// Convenience typedef for char32_t
+        ///
+        typedef basic_cached_message<char32_t> u32cached_message;
+        #endif
+
         ///
         /// Translate message \a msg and write it to stream
         ///
@@ -519,6 +1153,16 @@ namespace boost {
             return out;
         }
 
+        ///
+        /// Translate cached message \a msg and write it to stream
+        ///
+        template<typename CharType>
+        std::basic_ostream<CharType> &operator<<(std::basic_ostream<CharType> &out,basic_cached_message<CharType> const &msg)
+        {
+            msg.write(out);
+            return out;
+        }
+
         ///
         /// \anchor boost_locale_translate_family \name Indirect message translation function family
         /// @{
@@ -604,6 +1248,101 @@ namespace boost {
             return basic_message<CharType>(single,plural,n);
         }
 
+        ///
+        /// \brief Translate a message, \a msg is not copied, using \a hash of the key computed in advance
+        ///
+        template<typename CharType>
+        inline basic_message<CharType> translate(CharType const *msg,message_key_hash hash)
+        {
+            return basic_message<CharType>(0,msg,0,0,hash);
+        }
+        ///
+        /// \brief Translate a message in context, \a msg and \a context are not copied, using \a hash of the key computed in advance
+        ///
+        template<typename CharType>
+        inline basic_message<CharType> translate(   CharType const *context,
+                                                    CharType const *msg,
+                                                    message_key_hash hash)
+        {
+            return basic_message<CharType>(context,msg,0,0,hash);
+        }
+        ///
+        /// \brief Translate a plural message form, \a single and \a plural are not copied, using \a hash of the key computed in advance
+        ///
+        template<typename CharType>
+        inline basic_message<CharType> translate(   CharType const *single,
+                                                    CharType const *plural,
+                                                    int n,
+                                                    message_key_hash hash)
+        {
+            return basic_message<CharType>(0,single,plural,n,hash);
+        }
+        ///
+        /// \brief Translate a plural message from in constext, \a context, \a single and \a plural are not copied,
+        /// using \a hash of the key computed in advance
+        ///
+        template<typename CharType>
+        inline basic_message<CharType> translate(   CharType const *context,
+                                                    CharType const *single,
+                                                    CharType const *plural,
+                                                    int n,
+                                                    message_key_hash hash)
+        {
+            return basic_message<CharType>(context,single,plural,n,hash);
+        }
+
+        /// @}
+
+        ///
+        /// \anchor boost_locale_translate_macros \name Message translation with hashes computed at compile time
+        ///
+        /// These macros behave like \ref boost_locale_translate_family "translate" for string literals, but the hash
+        /// of the message key is computed at compile time (when the compiler supports constexpr,
+        /// otherwise when the message is created), so catalog lookup does not need to hash the key.
+        ///
+        /// @{
+
+        #ifdef BOOST_LOCALE_HAS_CONSTEXPR_HASH
+        ///
+        /// Hash of the message \a id, \a id must be a string literal
+        ///
+        #define BOOST_LOCALE_MESSAGE_HASH(id) \
+            ::boost::locale::message_key_hash(::boost::integral_constant< ::boost::uint32_t, \
+                ::boost::locale::details::message_key_hash_value(id)>::value)
+        ///
+        /// Hash of the message \a id in \a context, both must be string literals
+        ///
+        #define BOOST_LOCALE_CONTEXT_MESSAGE_HASH(context,id) \
+            ::boost::locale::message_key_hash(::boost::integral_constant< ::boost::uint32_t, \
+                ::boost::locale::details::message_key_hash_value(context,id)>::value)
+        #else
+        #define BOOST_LOCALE_MESSAGE_HASH(id) \
+            ::boost::locale::message_key_hash(::boost::locale::details::message_key_hash_value(id))
+        #define BOOST_LOCALE_CONTEXT_MESSAGE_HASH(context,id) \
+            ::boost::locale::message_key_hash(::boost::locale::details::message_key_hash_value(context,id))
+        #endif
+
+        ///
+        /// Translate string literal \a id
+        ///
+        #define BOOST_LOCALE_TRANSLATE(id) \
+            ::boost::locale::translate(id,BOOST_LOCALE_MESSAGE_HASH(id))
+        ///
+        /// Translate string literal \a id in string literal \a context
+        ///
+        #define BOOST_LOCALE_PTRANSLATE(context,id) \
+            ::boost::locale::translate(context,id,BOOST_LOCALE_CONTEXT_MESSAGE_HASH(context,id))
+        ///
+        /// Translate plural form of string literals \a single and \a plural for number \a n
+        ///
+        #define BOOST_LOCALE_NTRANSLATE(single,plural,n) \
+            ::boost::locale::translate(single,plural,n,BOOST_LOCALE_MESSAGE_HASH(single))
+        ///
+        /// Translate plural form of string literals \a single and \a plural in string literal \a context for number \a n
+        ///
+        #define BOOST_LOCALE_NPTRANSLATE(context,single,plural,n) \
+            ::boost::locale::translate(context,single,plural,n,BOOST_LOCALE_CONTEXT_MESSAGE_HASH(context,single))
+
         /// @}
 
         /// 
@@ -700,6 +1439,83 @@ namespace boost {
             return basic_message<CharType>(context,s,p,n).str(loc,domain);
         }
 
+        ///
+        /// \brief Translate \a count messages given by \a requests according to locale \a loc in the domain with id \a domain_id
+        ///
+        /// The id is the one returned by message_format::domain or generator::messages_domain_id.
+        ///
+        /// A pointer to each translation is stored in the corresponding element of \a translations. If the translation
+        /// is not found the original string is stored instead: \a id, or \a plural if \a plural is not NULL and
+        /// \a n is not 1. Translations point into the catalogs of \a loc and remain valid as long as a copy of
+        /// \a loc exists, and for the grace period after its catalogs are reloaded, see message_format::reload().
+        ///
+        /// Unlike translating each message separately, the facet and the domain are resolved once for the
+        /// whole batch and no strings are copied.
+        ///
+        /// \note Original strings are returned as is, so they should be US-ASCII for the results to be in the locale's encoding.
+        ///
+        /// Returns the number of messages that were translated
+        ///
+        template<typename CharType>
+        size_t translate_batch( std::locale const &loc,
+                                int domain_id,
+                                basic_message_request<CharType> const *requests,
+                                size_t count,
+                                CharType const **translations)
+        {
+            typedef message_format<CharType> facet_type;
+            size_t found = 0;
+            if(std::has_facet<facet_type>(loc)) {
+                std::use_facet<facet_type>(loc).get_batch(domain_id,requests,count,translations);
+            }
+            else {
+                for(size_t i=0;i<count;i++)
+                    translations[i] = 0;
+            }
+            for(size_t i=0;i<count;i++) {
+                if(translations[i]) {
+                    found++;
+                    continue;
+                }
+                basic_message_request<CharType> const &r = requests[i];
+                translations[i] = r.plural && r.n != 1 ? r.plural : r.id;
+            }
+            return found;
+        }
+
+        ///
+        /// \brief Translate \a count messages given by \a requests according to locale \a loc in domain \a domain
+        ///
+        /// See translate_batch(std::locale const &,int,basic_message_request<CharType> const *,size_t,CharType const **)
+        ///
+        template<typename CharType>
+        size_t translate_batch( std::locale const &loc,
+                                std::string const &domain,
+                                basic_message_request<CharType> const *requests,
+                                size_t count,
+                                CharType const **translations)
+        {
+            typedef message_format<CharType> facet_type;
+            int domain_id = 0;
+            if(!domain.empty() && std::has_facet<facet_type>(loc))
+                domain_id = std::use_facet<facet_type>(loc).domain(domain);
+            return translate_batch(loc,domain_id,requests,count,translations);
+        }
+
+        ///
+        /// \brief Translate \a count messages given by \a requests according to locale \a loc in the default domain
+        ///
+        /// See translate_batch(std::locale const &,int,basic_message_request<CharType> const *,size_t,CharType const **)
+        ///
+        template<typename CharType>
+        size_t translate_batch( std::locale const &loc,
+                                basic_message_request<CharType> const *requests,
+                                size_t count,
+                                CharType const **translations)
+        {
+            return translate_batch(loc,0,requests,count,translations);
+        }
+
         ///
         /// \cond INTERNAL
         ///
@@ -767,6 +1583,15 @@ namespace boost {
                     ios_info::get(out).domain_id(id);
                     return out;
                 }
+                struct set_domain_id {
+                    int domain_id;
+                };
+                template<typename CharType>
+                std::basic_ostream<CharType> &operator<<(std::basic_ostream<CharType> &out, set_domain_id const &dom)
+                {
+                    ios_info::get(out).domain_id(dom.domain_id);
+                    return out;
+                }
             } // details
             /// \endcond
 
@@ -791,6 +1616,23 @@ namespace boost {
                 details::set_domain tmp = { id };
                 return tmp;
             }
+
+            ///
+            /// Manipulator for switching message domain in ostream to the domain with integer \a id, as returned
+            /// by message_format::domain or generator::messages_domain_id. Unlike domain(std::string const &) it does
+            /// not look the domain up.
+            ///
+            inline 
+            #ifdef BOOST_LOCALE_DOXYGEN
+            unspecified_type
+            #else
+            details::set_domain_id 
+            #endif
+            domain(int id)
+            {
+                details::set_domain_id tmp = { id };
+                return tmp;
+            }
             /// @}
         } // as
     } // locale 
@@ -0,0 +1,329 @@
+//
+//  Copyright (c) 2009-2011 Artyom Beilis (Tonkikh)
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef BOOST_LOCALE_UTF_HPP_INCLUDED
+#define BOOST_LOCALE_UTF_HPP_INCLUDED
+
+#include <boost/cstdint.hpp>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define BOOST_LOCALE_UTF_SSE2
+#  include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#  define BOOST_LOCALE_UTF_AVX2
+#  include <immintrin.h>
+#endif
+
+namespace boost {
+namespace locale {
+///
+/// \brief Namespace that holds basic operations on UTF encoded sequences
+///
+/// All functions defined in this namespace do not require linking with Boost.Locale library
+///
+namespace utf {
+    /// \cond INTERNAL
+    #ifdef __GNUC__
+    #   define BOOST_LOCALE_LIKELY(x)   __builtin_expect((x),1)
+    #   define BOOST_LOCALE_UNLIKELY(x) __builtin_expect((x),0)
+    #else
+    #   define BOOST_LOCALE_LIKELY(x)   (x)
+    #   define BOOST_LOCALE_UNLIKELY(x) (x)
+    #endif
+    /// \endcond
+
+    ///
+    /// \brief The integral type that can hold a Unicode code point
+    ///
+    typedef uint32_t code_point;
+
+    ///
+    /// \brief Special constant that defines illegal code point
+    ///
+    static const code_point illegal = 0xFFFFFFFFu;
+
+    ///
+    /// \brief Special constant that defines incomplete code point
+    ///
+    static const code_point incomplete = 0xFFFFFFFEu;
+
+    ///
+    /// \brief the function checks if \a v is a valid code point
+    ///
+    inline bool is_valid_codepoint(code_point v)
+    {
+        if(v>0x10FFFF)
+            return false;
+        if(0xD800 <=v && v<= 0xDFFF) // surrogates
+            return false;
+        return true;
+    }
+
+    #ifdef BOOST_LOCALE_DOXYGEN
+    ///
+    /// \brief UTF Traits class - functions to convert UTF sequences to and from Unicode code points
+    ///
+    template<typename CharType,int size=sizeof(CharType)>
+    struct utf_traits {
+        ///
+        /// The type of the character
+        ///
+        typedef CharType char_type;
+        ///
+        /// The maximal width of a code point in code units
+        ///
+        static const int max_width;
+        ///
+        /// The width of the code point \a value in code units, \a value should be valid
+        ///
+        static int width(code_point value);
+        ///
+        /// Read one code point from the range [p,e), \a p should not be equal to \a e.
+        ///
+        /// If the sequence is valid its code point is returned and \a p points past it. Otherwise
+        /// \a illegal is returned, or \a incomplete when the range ends inside a valid prefix,
+        /// and the position of \a p is unspecified.
+        ///
+        template<typename Iterator>
+        static code_point decode(Iterator &p,Iterator e);
+        ///
+        /// Write the valid code point \a value to \a out and return the iterator past it
+        ///
+        template<typename Iterator>
+        static Iterator encode(code_point value,Iterator out);
+    };
+
+    #else
+
+    template<typename CharType,int size=sizeof(CharType)>
+    struct utf_traits;
+
+    template<typename CharType>
+    struct utf_traits<CharType,1> {
+
+        typedef CharType char_type;
+
+        static const int max_width = 4;
+
+        static int width(code_point value)
+        {
+            if(value <=0x7F) {
+                return 1;
+            }
+            else if(value <=0x7FF) {
+                return 2;
+            }
+            else if(BOOST_LOCALE_LIKELY(value <=0xFFFF)) {
+                return 3;
+            }
+            else {
+                return 4;
+            }
+        }
+
+        template<typename Iterator>
+        static code_point decode(Iterator &p,Iterator e)
+        {
+            unsigned char lead = *p++;
+
+            if(lead < 0x80)
+                return lead;
+
+            int trail_size;
+            code_point c;
+            if(BOOST_LOCALE_UNLIKELY(lead < 0xC2)) // continuation or overlong 2 bytes
+                return illegal;
+            else if(lead < 0xE0) {
+                trail_size = 1;
+                c = lead & 0x1F;
+            }
+            else if(lead < 0xF0) {
+                trail_size = 2;
+                c = lead & 0x0F;
+            }
+            else if(lead <= 0xF4) {
+                trail_size = 3;
+                c = lead & 0x07;
+            }
+            else
+                return illegal;
+
+            for(int i=0;i<trail_size;i++) {
+                if(BOOST_LOCALE_UNLIKELY(p==e))
+                    return incomplete;
+                unsigned char tmp = *p;
+                if((tmp & 0xC0) != 0x80)
+                    return illegal;
+                ++p;
+                c = (c << 6) | (tmp & 0x3F);
+            }
+
+            // exclude surrogates, values above 0x10FFFF and overlong sequences
+            if(BOOST_LOCALE_UNLIKELY(!is_valid_codepoint(c)))
+                return illegal;
+            if(BOOST_LOCALE_UNLIKELY(width(c)!=trail_size + 1))
+                return illegal;
+
+            return c;
+        }
+
+        template<typename Iterator>
+        static Iterator encode(code_point value,Iterator out)
+        {
+            if(value <= 0x7F) {
+                *out++ = static_cast<char_type>(value);
+            }
+            else if(value <= 0x7FF) {
+                *out++ = static_cast<char_type>((value >> 6) | 0xC0);
+                *out++ = static_cast<char_type>((value & 0x3F) | 0x80);
+            }
+            else if(BOOST_LOCALE_LIKELY(value <= 0xFFFF)) {
+                *out++ = static_cast<char_type>((value >> 12) | 0xE0);
+                *out++ = static_cast<char_type>(((value >> 6) & 0x3F) | 0x80);
+                *out++ = static_cast<char_type>((value & 0x3F) | 0x80);
+            }
+            else {
+                *out++ = static_cast<char_type>((value >> 18) | 0xF0);
+                *out++ = static_cast<char_type>(((value >> 12) & 0x3F) | 0x80);
+                *out++ = static_cast<char_type>(((value >> 6) & 0x3F) | 0x80);
+                *out++ = static_cast<char_type>((value & 0x3F) | 0x80);
+            }
+            return out;
+        }
+    }; // utf8
+
+    template<typename CharType>
+    struct utf_traits<CharType,2> {
+        typedef CharType char_type;
+
+        static const int max_width = 2;
+
+        static int width(code_point value)
+        {
+            return value >= 0x10000 ? 2 : 1;
+        }
+
+        template<typename Iterator>
+        static code_point decode(Iterator &p,Iterator e)
+        {
+            code_point w1 = static_cast<uint16_t>(*p++);
+            if(BOOST_LOCALE_LIKELY(w1 < 0xD800 || 0xDFFF < w1))
+                return w1;
+            if(w1 > 0xDBFF) // trail surrogate first
+                return illegal;
+            if(p==e)
+                return incomplete;
+            code_point w2 = static_cast<uint16_t>(*p);
+            if(w2 < 0xDC00 || 0xDFFF < w2)
+                return illegal;
+            ++p;
+            return (((w1 & 0x3FF) << 10) | (w2 & 0x3FF)) + 0x10000;
+        }
+
+        template<typename Iterator>
+        static Iterator encode(code_point value,Iterator out)
+        {
+            if(BOOST_LOCALE_LIKELY(value <= 0xFFFF)) {
+                *out++ = static_cast<char_type>(value);
+            }
+            else {
+                value -= 0x10000;
+                *out++ = static_cast<char_type>(0xD800 | (value >> 10));
+                *out++ = static_cast<char_type>(0xDC00 | (value & 0x3FF));
+            }
+            return out;
+        }
+    }; // utf16
+
+    template<typename CharType>
+    struct utf_traits<CharType,4> {
+        typedef CharType char_type;
+
+        static const int max_width = 1;
+
+        static int width(code_point /*value*/)
+        {
+            return 1;
+        }
+
+        template<typename Iterator>
+        static code_point decode(Iterator &p,Iterator /*e*/)
+        {
+            code_point c = static_cast<code_point>(*p++);
+            if(BOOST_LOCALE_UNLIKELY(!is_valid_codepoint(c)))
+                return illegal;
+            return c;
+        }
+
+        template<typename Iterator>
+        static Iterator encode(code_point value,Iterator out)
+        {
+            *out++ = static_cast<char_type>(value);
+            return out;
+        }
+    }; // utf32
+
+    #endif
+
+    /// \cond INTERNAL
+    namespace details {
+
+        ///
+        /// Return the first code unit in [begin,end) that is not ASCII, only narrow text is scanned,
+        /// other code units are decoded one by one.
+        ///
+        template<typename CharType>
+        CharType const *skip_ascii(CharType const *begin,CharType const * /*end*/)
+        {
+            return begin;
+        }
+
+        inline char const *skip_ascii(char const *begin,char const *end)
+        {
+            #ifdef BOOST_LOCALE_UTF_AVX2
+            while(end - begin >= 32) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(begin));
+                if(_mm256_movemask_epi8(v) != 0)
+                    break;
+                begin += 32;
+            }
+            #endif
+            #ifdef BOOST_LOCALE_UTF_SSE2
+            while(end - begin >= 16) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(begin));
+                if(_mm_movemask_epi8(v) != 0)
+                    break;
+                begin += 16;
+            }
+            #else
+            while(end - begin >= 8) {
+                uint32_t w[2];
+                memcpy(w,begin,8);
+                if(((w[0] | w[1]) & 0x80808080u) != 0)
+                    break;
+                begin += 8;
+            }
+            #endif
+            while(begin!=end && static_cast<unsigned char>(*begin) < 0x80)
+                ++begin;
+            return begin;
+        }
+
+    } // details
+    /// \endcond
+
+} // utf
+} // locale
+} // boost
+
+
+#endif
+
+// vim: tabstop=4 expandtab shiftwidth=4 softtabstop=4
+
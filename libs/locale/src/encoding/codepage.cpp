@@ -23,91 +23,317 @@
 #endif
 
 #include <boost/locale/encoding.hpp>
+#include "conv.hpp"
+#include "simple_codepage.hpp"
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/tss.hpp>
 
 #include <string>
 #include <cstring>
 #include <memory>
+#include <list>
+#include <iterator>
 
 namespace boost {
     namespace locale {
         namespace conv {
             namespace impl {
+
                 
-                std::string convert_between(char const *begin,
-                                            char const *end,
-                                            char const *to_charset,
-                                            char const *from_charset,
-                                            method_type how)
+                converter_between *create_between(char const *to_charset,char const *from_charset,method_type how)
                 {
                     std::auto_ptr<converter_between> cvt;
                     #ifdef BOOST_LOCALE_WITH_ICONV
                     cvt.reset(new iconv_between());
                     if(cvt->open(to_charset,from_charset,how))
-                        return cvt->convert(begin,end);
+                        return cvt.release();
                     #endif
                     #ifdef BOOST_LOCALE_WITH_ICU
                     cvt.reset(new uconv_between());
                     if(cvt->open(to_charset,from_charset,how))
-                        return cvt->convert(begin,end);
+                        return cvt.release();
                     #endif
                     #ifdef BOOST_LOCALE_WITH_WCONV
                     cvt.reset(new wconv_between());
                     if(cvt->open(to_charset,from_charset,how))
-                        return cvt->convert(begin,end);
+                        return cvt.release();
                     #endif
-                    throw invalid_charset_error(std::string(to_charset) + " or " + from_charset);
+                    return 0;
                 }
 
                 template<typename CharType>
-                std::basic_string<CharType> convert_to(
-                                        char const *begin,
-                                        char const *end,
-                                        char const *charset,
-                                        method_type how)
+                converter_to_utf<CharType> *create_to(char const *charset,method_type how)
                 {
                     std::auto_ptr<converter_to_utf<CharType> > cvt;
                     #ifdef BOOST_LOCALE_WITH_ICONV
                     cvt.reset(new iconv_to_utf<CharType>());
                     if(cvt->open(charset,how))
-                        return cvt->convert(begin,end);
+                        return cvt.release();
                     #endif
                     #ifdef BOOST_LOCALE_WITH_ICU
                     cvt.reset(new uconv_to_utf<CharType>());
                     if(cvt->open(charset,how))
-                        return cvt->convert(begin,end);
+                        return cvt.release();
                     #endif
                     #ifdef BOOST_LOCALE_WITH_WCONV
                     cvt.reset(new wconv_to_utf<CharType>());
                     if(cvt->open(charset,how))
-                        return cvt->convert(begin,end);
+                        return cvt.release();
                     #endif
-                    throw invalid_charset_error(charset);
+                    return 0;
                 }
 
                 template<typename CharType>
-                std::string convert_from(
-                                        CharType const *begin,
-                                        CharType const *end,
-                                        char const *charset,
-                                        method_type how)
+                converter_from_utf<CharType> *create_from(char const *charset,method_type how)
                 {
                     std::auto_ptr<converter_from_utf<CharType> > cvt;
                     #ifdef BOOST_LOCALE_WITH_ICONV
                     cvt.reset(new iconv_from_utf<CharType>());
                     if(cvt->open(charset,how))
-                        return cvt->convert(begin,end);
+                        return cvt.release();
                     #endif
                     #ifdef BOOST_LOCALE_WITH_ICU
                     cvt.reset(new uconv_from_utf<CharType>());
                     if(cvt->open(charset,how))
-                        return cvt->convert(begin,end);
+                        return cvt.release();
                     #endif
                     #ifdef BOOST_LOCALE_WITH_WCONV
                     cvt.reset(new wconv_from_utf<CharType>());
                     if(cvt->open(charset,how))
-                        return cvt->convert(begin,end);
+                        return cvt.release();
                     #endif
-                    throw invalid_charset_error(charset);
+                    return 0;
+                }
+
+                namespace {
+
+                    //
+                    // Opened converters of a single thread, the most recently used first.
+                    // The key holds the kind of the converter, the character size, the method
+                    // and the normalized names of the encodings, so the type of a converter
+                    // is known from its key.
+                    //
+                    class converters_cache {
+                    public:
+                        static const size_t max_size = 8;
+
+                        void *get(std::string const &key)
+                        {
+                            for(entries_type::iterator p=entries_.begin();p!=entries_.end();++p) {
+                                if(p->first == key) {
+                                    if(p!=entries_.begin())
+                                        entries_.splice(entries_.begin(),entries_,p);
+                                    return entries_.front().second.get();
+                                }
+                            }
+                            return 0;
+                        }
+
+                        void put(std::string const &key,boost::shared_ptr<void> cvt)
+                        {
+                            if(entries_.size() >= max_size)
+                                entries_.pop_back();
+                            entries_.push_front(std::make_pair(key,cvt));
+                        }
+                    private:
+                        typedef std::list<std::pair<std::string,boost::shared_ptr<void> > > entries_type;
+                        entries_type entries_;
+                    };
+
+                    boost::thread_specific_ptr<converters_cache> &get_converters_cache()
+                    {
+                        static boost::thread_specific_ptr<converters_cache> the_cache;
+                        return the_cache;
+                    }
+
+                    struct converters_cache_init {
+                        converters_cache_init()
+                        {
+                            get_converters_cache();
+                        }
+                    } do_converters_cache_init;
+
+                    converters_cache &thread_converters()
+                    {
+                        boost::thread_specific_ptr<converters_cache> &cache = get_converters_cache();
+                        if(!cache.get())
+                            cache.reset(new converters_cache());
+                        return *cache;
+                    }
+
+                    std::string converter_key(char kind,size_t char_size,method_type how,std::string const &to_name,std::string const &from_name)
+                    {
+                        std::string key;
+                        key += kind;
+                        key += char('0' + char_size);
+                        key += char('0' + how);
+                        key += to_name;
+                        key += '/';
+                        key += from_name;
+                        return key;
+                    }
+
+                    //
+                    // Encodings converted without iconv or ICU: UTF-8 and the single byte
+                    // encodings that have built-in tables
+                    //
+                    struct native_encoding {
+                        bool utf8;
+                        simple_codepage const *codepage;
+                        bool supported() const
+                        {
+                            return utf8 || codepage;
+                        }
+                    };
+
+                    native_encoding get_native_encoding(std::string const &name)
+                    {
+                        native_encoding enc;
+                        enc.utf8 = name == "utf8";
+                        enc.codepage = enc.utf8 ? 0 : get_simple_codepage(name);
+                        return enc;
+                    }
+
+                    template<typename CharType>
+                    std::basic_string<CharType> native_to_utf(native_encoding const &from,char const *begin,char const *end,method_type how)
+                    {
+                        if(from.utf8)
+                            return utf_to_utf<CharType>(begin,end,how);
+                        std::basic_string<CharType> result;
+                        result.reserve(end - begin);
+                        std::back_insert_iterator<std::basic_string<CharType> > inserter(result);
+                        for(;begin!=end;++begin) {
+                            utf::code_point c = from.codepage->to_unicode(*begin);
+                            if(c == utf::illegal) {
+                                if(how == stop)
+                                    throw conversion_error();
+                                continue;
+                            }
+                            utf::utf_traits<CharType>::encode(c,inserter);
+                        }
+                        return result;
+                    }
+
+                    template<typename CharType>
+                    std::string native_from_utf(native_encoding const &to,CharType const *begin,CharType const *end,method_type how)
+                    {
+                        if(to.utf8)
+                            return utf_to_utf<char>(begin,end,how);
+                        std::string result;
+                        result.reserve(end - begin);
+                        while(begin!=end) {
+                            CharType const *start = begin;
+                            utf::code_point c = utf::utf_traits<CharType>::decode(begin,end);
+                            int b = -1;
+                            if(c != utf::illegal && c != utf::incomplete)
+                                b = to.codepage->from_unicode(c);
+                            else
+                                begin = start + 1;
+                            if(b < 0) {
+                                if(how == stop)
+                                    throw conversion_error();
+                                continue;
+                            }
+                            result += static_cast<char>(b);
+                        }
+                        return result;
+                    }
+
+                    std::string native_between(native_encoding const &to,native_encoding const &from,char const *begin,char const *end,method_type how)
+                    {
+                        if(from.utf8)
+                            return native_from_utf<char>(to,begin,end,how);
+                        if(to.utf8)
+                            return native_to_utf<char>(from,begin,end,how);
+                        std::string result;
+                        result.reserve(end - begin);
+                        for(;begin!=end;++begin) {
+                            utf::code_point c = from.codepage->to_unicode(*begin);
+                            int b = c == utf::illegal ? -1 : to.codepage->from_unicode(c);
+                            if(b < 0) {
+                                if(how == stop)
+                                    throw conversion_error();
+                                continue;
+                            }
+                            result += static_cast<char>(b);
+                        }
+                        return result;
+                    }
+
+                } // anon
+
+                std::string convert_between(char const *begin,
+                                            char const *end,
+                                            char const *to_charset,
+                                            char const *from_charset,
+                                            method_type how)
+                {
+                    std::string to_name = normalize_encoding(to_charset);
+                    std::string from_name = normalize_encoding(from_charset);
+                    native_encoding to = get_native_encoding(to_name);
+                    native_encoding from = get_native_encoding(from_name);
+                    if(to.supported() && from.supported())
+                        return native_between(to,from,begin,end,how);
+                    converters_cache &cache = thread_converters();
+                    std::string key = converter_key('b',1,how,to_name,from_name);
+                    converter_between *cvt = static_cast<converter_between *>(cache.get(key));
+                    if(!cvt) {
+                        boost::shared_ptr<converter_between> ptr(create_between(to_charset,from_charset,how));
+                        if(!ptr)
+                            throw invalid_charset_error(std::string(to_charset) + " or " + from_charset);
+                        cache.put(key,ptr);
+                        cvt = ptr.get();
+                    }
+                    return cvt->convert(begin,end);
+                }
+
+                template<typename CharType>
+                std::basic_string<CharType> convert_to(
+                                        char const *begin,
+                                        char const *end,
+                                        char const *charset,
+                                        method_type how)
+                {
+                    std::string name = normalize_encoding(charset);
+                    native_encoding from = get_native_encoding(name);
+                    if(from.supported())
+                        return native_to_utf<CharType>(from,begin,end,how);
+                    converters_cache &cache = thread_converters();
+                    std::string key = converter_key('t',sizeof(CharType),how,std::string(),name);
+                    converter_to_utf<CharType> *cvt = static_cast<converter_to_utf<CharType> *>(cache.get(key));
+                    if(!cvt) {
+                        boost::shared_ptr<converter_to_utf<CharType> > ptr(create_to<CharType>(charset,how));
+                        if(!ptr)
+                            throw invalid_charset_error(charset);
+                        cache.put(key,ptr);
+                        cvt = ptr.get();
+                    }
+                    return cvt->convert(begin,end);
+                }
+
+                template<typename CharType>
+                std::string convert_from(
+                                        CharType const *begin,
+                                        CharType const *end,
+                                        char const *charset,
+                                        method_type how)
+                {
+                    std::string name = normalize_encoding(charset);
+                    native_encoding to = get_native_encoding(name);
+                    if(to.supported())
+                        return native_from_utf<CharType>(to,begin,end,how);
+                    converters_cache &cache = thread_converters();
+                    std::string key = converter_key('f',sizeof(CharType),how,name,std::string());
+                    converter_from_utf<CharType> *cvt = static_cast<converter_from_utf<CharType> *>(cache.get(key));
+                    if(!cvt) {
+                        boost::shared_ptr<converter_from_utf<CharType> > ptr(create_from<CharType>(charset,how));
+                        if(!ptr)
+                            throw invalid_charset_error(charset);
+                        cache.put(key,ptr);
+                        cvt = ptr.get();
+                    }
+                    return cvt->convert(begin,end);
                 }
 
                 std::string normalize_encoding(char const *ccharset)
@@ -130,6 +356,37 @@ namespace boost {
             } // impl 
 
             using namespace impl;
+
+            struct converter::data {
+                std::auto_ptr<converter_between> cvt;
+                method_type how;
+                native_encoding to;
+                native_encoding from;
+            };
+
+            converter::converter(std::string const &to_encoding,std::string const &from_encoding,method_type how) :
+                d(new data())
+            {
+                d->how = how;
+                d->to = get_native_encoding(normalize_encoding(to_encoding.c_str()));
+                d->from = get_native_encoding(normalize_encoding(from_encoding.c_str()));
+                if(d->to.supported() && d->from.supported())
+                    return;
+                d->cvt.reset(create_between(to_encoding.c_str(),from_encoding.c_str(),how));
+                if(!d->cvt.get())
+                    throw invalid_charset_error(to_encoding + " or " + from_encoding);
+            }
+
+            converter::~converter()
+            {
+            }
+
+            std::string converter::convert(char const *begin,char const *end)
+            {
+                if(!d->cvt.get())
+                    return native_between(d->to,d->from,begin,end,d->how);
+                return d->cvt->convert(begin,end);
+            }
             
             std::string between(char const *begin,char const *end,
                                 std::string const &to_charset,std::string const &from_charset,method_type how)
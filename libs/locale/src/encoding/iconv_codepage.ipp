@@ -55,6 +55,9 @@ public:
         
         sresult.reserve(uend - ubegin);
 
+        // the converter may be reused, drop a shift state left by an interrupted conversion
+        conv(0,0,0,0);
+
         OutChar result[64];
 
         char *out_start   = reinterpret_cast<char *>(&result[0]);
@@ -0,0 +1,567 @@
+//
+//  Copyright (c) 2009-2011 Artyom Beilis (Tonkikh)
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#define BOOST_LOCALE_SOURCE
+#include "simple_codepage.hpp"
+#include <algorithm>
+#include <string.h>
+
+namespace boost {
+    namespace locale {
+        namespace conv {
+            namespace impl {
+
+                simple_codepage::simple_codepage(uint16_t const *upper_half)
+                {
+                    for(unsigned i=0;i<128;i++)
+                        to_unicode_[i]=i;
+                    for(unsigned i=0;i<128;i++)
+                        to_unicode_[i + 128] = upper_half[i] == 0xFFFF ? 0xFFFFFFFFu : upper_half[i];
+                    memset(pages_index_,0,sizeof(pages_index_));
+                    for(unsigned i=0;i<256;i++) {
+                        uint32_t u = to_unicode_[i];
+                        if(u == 0xFFFFFFFFu)
+                            continue;
+                        unsigned char &page = pages_index_[u >> 8];
+                        if(page == 0) {
+                            pages_.resize(pages_.size() + 256,0);
+                            page = static_cast<unsigned char>(pages_.size() / 256);
+                        }
+                        pages_[(page - 1) * 256 + (u & 0xFF)] = static_cast<unsigned char>(i);
+                    }
+                }
+
+                namespace {
+
+                    //
+                    // Code points of bytes 0x80-0xFF, 0xFFFF for undefined bytes. They match the
+                    // mappings of glibc iconv that were used for these encodings before.
+                    //
+
+                    uint16_t const cp1250[128] = {
+                        0x20AC,0xFFFF,0x201A,0xFFFF,0x201E,0x2026,0x2020,0x2021,
+                        0xFFFF,0x2030,0x0160,0x2039,0x015A,0x0164,0x017D,0x0179,
+                        0xFFFF,0x2018,0x2019,0x201C,0x201D,0x2022,0x2013,0x2014,
+                        0xFFFF,0x2122,0x0161,0x203A,0x015B,0x0165,0x017E,0x017A,
+                        0x00A0,0x02C7,0x02D8,0x0141,0x00A4,0x0104,0x00A6,0x00A7,
+                        0x00A8,0x00A9,0x015E,0x00AB,0x00AC,0x00AD,0x00AE,0x017B,
+                        0x00B0,0x00B1,0x02DB,0x0142,0x00B4,0x00B5,0x00B6,0x00B7,
+                        0x00B8,0x0105,0x015F,0x00BB,0x013D,0x02DD,0x013E,0x017C,
+                        0x0154,0x00C1,0x00C2,0x0102,0x00C4,0x0139,0x0106,0x00C7,
+                        0x010C,0x00C9,0x0118,0x00CB,0x011A,0x00CD,0x00CE,0x010E,
+                        0x0110,0x0143,0x0147,0x00D3,0x00D4,0x0150,0x00D6,0x00D7,
+                        0x0158,0x016E,0x00DA,0x0170,0x00DC,0x00DD,0x0162,0x00DF,
+                        0x0155,0x00E1,0x00E2,0x0103,0x00E4,0x013A,0x0107,0x00E7,
+                        0x010D,0x00E9,0x0119,0x00EB,0x011B,0x00ED,0x00EE,0x010F,
+                        0x0111,0x0144,0x0148,0x00F3,0x00F4,0x0151,0x00F6,0x00F7,
+                        0x0159,0x016F,0x00FA,0x0171,0x00FC,0x00FD,0x0163,0x02D9
+                    };
+
+                    uint16_t const cp1251[128] = {
+                        0x0402,0x0403,0x201A,0x0453,0x201E,0x2026,0x2020,0x2021,
+                        0x20AC,0x2030,0x0409,0x2039,0x040A,0x040C,0x040B,0x040F,
+                        0x0452,0x2018,0x2019,0x201C,0x201D,0x2022,0x2013,0x2014,
+                        0xFFFF,0x2122,0x0459,0x203A,0x045A,0x045C,0x045B,0x045F,
+                        0x00A0,0x040E,0x045E,0x0408,0x00A4,0x0490,0x00A6,0x00A7,
+                        0x0401,0x00A9,0x0404,0x00AB,0x00AC,0x00AD,0x00AE,0x0407,
+                        0x00B0,0x00B1,0x0406,0x0456,0x0491,0x00B5,0x00B6,0x00B7,
+                        0x0451,0x2116,0x0454,0x00BB,0x0458,0x0405,0x0455,0x0457,
+                        0x0410,0x0411,0x0412,0x0413,0x0414,0x0415,0x0416,0x0417,
+                        0x0418,0x0419,0x041A,0x041B,0x041C,0x041D,0x041E,0x041F,
+                        0x0420,0x0421,0x0422,0x0423,0x0424,0x0425,0x0426,0x0427,
+                        0x0428,0x0429,0x042A,0x042B,0x042C,0x042D,0x042E,0x042F,
+                        0x0430,0x0431,0x0432,0x0433,0x0434,0x0435,0x0436,0x0437,
+                        0x0438,0x0439,0x043A,0x043B,0x043C,0x043D,0x043E,0x043F,
+                        0x0440,0x0441,0x0442,0x0443,0x0444,0x0445,0x0446,0x0447,
+                        0x0448,0x0449,0x044A,0x044B,0x044C,0x044D,0x044E,0x044F
+                    };
+
+                    uint16_t const cp1252[128] = {
+                        0x20AC,0xFFFF,0x201A,0x0192,0x201E,0x2026,0x2020,0x2021,
+                        0x02C6,0x2030,0x0160,0x2039,0x0152,0xFFFF,0x017D,0xFFFF,
+                        0xFFFF,0x2018,0x2019,0x201C,0x201D,0x2022,0x2013,0x2014,
+                        0x02DC,0x2122,0x0161,0x203A,0x0153,0xFFFF,0x017E,0x0178,
+                        0x00A0,0x00A1,0x00A2,0x00A3,0x00A4,0x00A5,0x00A6,0x00A7,
+                        0x00A8,0x00A9,0x00AA,0x00AB,0x00AC,0x00AD,0x00AE,0x00AF,
+                        0x00B0,0x00B1,0x00B2,0x00B3,0x00B4,0x00B5,0x00B6,0x00B7,
+                        0x00B8,0x00B9,0x00BA,0x00BB,0x00BC,0x00BD,0x00BE,0x00BF,
+                        0x00C0,0x00C1,0x00C2,0x00C3,0x00C4,0x00C5,0x00C6,0x00C7,
+                        0x00C8,0x00C9,0x00CA,0x00CB,0x00CC,0x00CD,0x00CE,0x00CF,
+                        0x00D0,0x00D1,0x00D2,0x00D3,0x00D4,0x00D5,0x00D6,0x00D7,
+                        0x00D8,0x00D9,0x00DA,0x00DB,0x00DC,0x00DD,0x00DE,0x00DF,
+                        0x00E0,0x00E1,0x00E2,0x00E3,0x00E4,0x00E5,0x00E6,0x00E7,
+                        0x00E8,0x00E9,0x00EA,0x00EB,0x00EC,0x00ED,0x00EE,0x00EF,
+                        0x00F0,0x00F1,0x00F2,0x00F3,0x00F4,0x00F5,0x00F6,0x00F7,
+                        0x00F8,0x00F9,0x00FA,0x00FB,0x00FC,0x00FD,0x00FE,0x00FF
+                    };
+
+                    uint16_t const cp1253[128] = {
+                        0x20AC,0xFFFF,0x201A,0x0192,0x201E,0x2026,0x2020,0x2021,
+                        0xFFFF,0x2030,0xFFFF,0x2039,0xFFFF,0xFFFF,0xFFFF,0xFFFF,
+                        0xFFFF,0x2018,0x2019,0x201C,0x201D,0x2022,0x2013,0x2014,
+                        0xFFFF,0x2122,0xFFFF,0x203A,0xFFFF,0xFFFF,0xFFFF,0xFFFF,
+                        0x00A0,0x0385,0x0386,0x00A3,0x00A4,0x00A5,0x00A6,0x00A7,
+                        0x00A8,0x00A9,0xFFFF,0x00AB,0x00AC,0x00AD,0x00AE,0x2015,
+                        0x00B0,0x00B1,0x00B2,0x00B3,0x0384,0x00B5,0x00B6,0x00B7,
+                        0x0388,0x0389,0x038A,0x00BB,0x038C,0x00BD,0x038E,0x038F,
+                        0x0390,0x0391,0x0392,0x0393,0x0394,0x0395,0x0396,0x0397,
+                        0x0398,0x0399,0x039A,0x039B,0x039C,0x039D,0x039E,0x039F,
+                        0x03A0,0x03A1,0xFFFF,0x03A3,0x03A4,0x03A5,0x03A6,0x03A7,
+                        0x03A8,0x03A9,0x03AA,0x03AB,0x03AC,0x03AD,0x03AE,0x03AF,
+                        0x03B0,0x03B1,0x03B2,0x03B3,0x03B4,0x03B5,0x03B6,0x03B7,
+                        0x03B8,0x03B9,0x03BA,0x03BB,0x03BC,0x03BD,0x03BE,0x03BF,
+                        0x03C0,0x03C1,0x03C2,0x03C3,0x03C4,0x03C5,0x03C6,0x03C7,
+                        0x03C8,0x03C9,0x03CA,0x03CB,0x03CC,0x03CD,0x03CE,0xFFFF
+                    };
+
+                    uint16_t const cp1254[128] = {
+                        0x20AC,0xFFFF,0x201A,0x0192,0x201E,0x2026,0x2020,0x2021,
+                        0x02C6,0x2030,0x0160,0x2039,0x0152,0xFFFF,0xFFFF,0xFFFF,
+                        0xFFFF,0x2018,0x2019,0x201C,0x201D,0x2022,0x2013,0x2014,
+                        0x02DC,0x2122,0x0161,0x203A,0x0153,0xFFFF,0xFFFF,0x0178,
+                        0x00A0,0x00A1,0x00A2,0x00A3,0x00A4,0x00A5,0x00A6,0x00A7,
+                        0x00A8,0x00A9,0x00AA,0x00AB,0x00AC,0x00AD,0x00AE,0x00AF,
+                        0x00B0,0x00B1,0x00B2,0x00B3,0x00B4,0x00B5,0x00B6,0x00B7,
+                        0x00B8,0x00B9,0x00BA,0x00BB,0x00BC,0x00BD,0x00BE,0x00BF,
+                        0x00C0,0x00C1,0x00C2,0x00C3,0x00C4,0x00C5,0x00C6,0x00C7,
+                        0x00C8,0x00C9,0x00CA,0x00CB,0x00CC,0x00CD,0x00CE,0x00CF,
+                        0x011E,0x00D1,0x00D2,0x00D3,0x00D4,0x00D5,0x00D6,0x00D7,
+                        0x00D8,0x00D9,0x00DA,0x00DB,0x00DC,0x0130,0x015E,0x00DF,
+                        0x00E0,0x00E1,0x00E2,0x00E3,0x00E4,0x00E5,0x00E6,0x00E7,
+                        0x00E8,0x00E9,0x00EA,0x00EB,0x00EC,0x00ED,0x00EE,0x00EF,
+                        0x011F,0x00F1,0x00F2,0x00F3,0x00F4,0x00F5,0x00F6,0x00F7,
+                        0x00F8,0x00F9,0x00FA,0x00FB,0x00FC,0x0131,0x015F,0x00FF
+                    };
+
+                    uint16_t const cp1255[128] = {
+                        0x20AC,0xFFFF,0x201A,0x0192,0x201E,0x2026,0x2020,0x2021,
+                        0x02C6,0x2030,0xFFFF,0x2039,0xFFFF,0xFFFF,0xFFFF,0xFFFF,
+                        0xFFFF,0x2018,0x2019,0x201C,0x201D,0x2022,0x2013,0x2014,
+                        0x02DC,0x2122,0xFFFF,0x203A,0xFFFF,0xFFFF,0xFFFF,0xFFFF,
+                        0x00A0,0x00A1,0x00A2,0x00A3,0x20AA,0x00A5,0x00A6,0x00A7,
+                        0x00A8,0x00A9,0x00D7,0x00AB,0x00AC,0x00AD,0x00AE,0x00AF,
+                        0x00B0,0x00B1,0x00B2,0x00B3,0x00B4,0x00B5,0x00B6,0x00B7,
+                        0x00B8,0x00B9,0x00F7,0x00BB,0x00BC,0x00BD,0x00BE,0x00BF,
+                        0x05B0,0x05B1,0x05B2,0x05B3,0x05B4,0x05B5,0x05B6,0x05B7,
+                        0x05B8,0x05B9,0xFFFF,0x05BB,0x05BC,0x05BD,0x05BE,0x05BF,
+                        0x05C0,0x05C1,0x05C2,0x05C3,0x05F0,0x05F1,0x05F2,0x05F3,
+                        0x05F4,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,
+                        0x05D0,0x05D1,0x05D2,0x05D3,0x05D4,0x05D5,0x05D6,0x05D7,
+                        0x05D8,0x05D9,0x05DA,0x05DB,0x05DC,0x05DD,0x05DE,0x05DF,
+                        0x05E0,0x05E1,0x05E2,0x05E3,0x05E4,0x05E5,0x05E6,0x05E7,
+                        0x05E8,0x05E9,0x05EA,0xFFFF,0xFFFF,0x200E,0x200F,0xFFFF
+                    };
+
+                    uint16_t const cp1256[128] = {
+                        0x20AC,0x067E,0x201A,0x0192,0x201E,0x2026,0x2020,0x2021,
+                        0x02C6,0x2030,0x0679,0x2039,0x0152,0x0686,0x0698,0x0688,
+                        0x06AF,0x2018,0x2019,0x201C,0x201D,0x2022,0x2013,0x2014,
+                        0x06A9,0x2122,0x0691,0x203A,0x0153,0x200C,0x200D,0x06BA,
+                        0x00A0,0x060C,0x00A2,0x00A3,0x00A4,0x00A5,0x00A6,0x00A7,
+                        0x00A8,0x00A9,0x06BE,0x00AB,0x00AC,0x00AD,0x00AE,0x00AF,
+                        0x00B0,0x00B1,0x00B2,0x00B3,0x00B4,0x00B5,0x00B6,0x00B7,
+                        0x00B8,0x00B9,0x061B,0x00BB,0x00BC,0x00BD,0x00BE,0x061F,
+                        0x06C1,0x0621,0x0622,0x0623,0x0624,0x0625,0x0626,0x0627,
+                        0x0628,0x0629,0x062A,0x062B,0x062C,0x062D,0x062E,0x062F,
+                        0x0630,0x0631,0x0632,0x0633,0x0634,0x0635,0x0636,0x00D7,
+                        0x0637,0x0638,0x0639,0x063A,0x0640,0x0641,0x0642,0x0643,
+                        0x00E0,0x0644,0x00E2,0x0645,0x0646,0x0647,0x0648,0x00E7,
+                        0x00E8,0x00E9,0x00EA,0x00EB,0x0649,0x064A,0x00EE,0x00EF,
+                        0x064B,0x064C,0x064D,0x064E,0x00F4,0x064F,0x0650,0x00F7,
+                        0x0651,0x00F9,0x0652,0x00FB,0x00FC,0x200E,0x200F,0x06D2
+                    };
+
+                    uint16_t const cp1257[128] = {
+                        0x20AC,0xFFFF,0x201A,0xFFFF,0x201E,0x2026,0x2020,0x2021,
+                        0xFFFF,0x2030,0xFFFF,0x2039,0xFFFF,0x00A8,0x02C7,0x00B8,
+                        0xFFFF,0x2018,0x2019,0x201C,0x201D,0x2022,0x2013,0x2014,
+                        0xFFFF,0x2122,0xFFFF,0x203A,0xFFFF,0x00AF,0x02DB,0xFFFF,
+                        0x00A0,0xFFFF,0x00A2,0x00A3,0x00A4,0xFFFF,0x00A6,0x00A7,
+                        0x00D8,0x00A9,0x0156,0x00AB,0x00AC,0x00AD,0x00AE,0x00C6,
+                        0x00B0,0x00B1,0x00B2,0x00B3,0x00B4,0x00B5,0x00B6,0x00B7,
+                        0x00F8,0x00B9,0x0157,0x00BB,0x00BC,0x00BD,0x00BE,0x00E6,
+                        0x0104,0x012E,0x0100,0x0106,0x00C4,0x00C5,0x0118,0x0112,
+                        0x010C,0x00C9,0x0179,0x0116,0x0122,0x0136,0x012A,0x013B,
+                        0x0160,0x0143,0x0145,0x00D3,0x014C,0x00D5,0x00D6,0x00D7,
+                        0x0172,0x0141,0x015A,0x016A,0x00DC,0x017B,0x017D,0x00DF,
+                        0x0105,0x012F,0x0101,0x0107,0x00E4,0x00E5,0x0119,0x0113,
+                        0x010D,0x00E9,0x017A,0x0117,0x0123,0x0137,0x012B,0x013C,
+                        0x0161,0x0144,0x0146,0x00F3,0x014D,0x00F5,0x00F6,0x00F7,
+                        0x0173,0x0142,0x015B,0x016B,0x00FC,0x017C,0x017E,0x02D9
+                    };
+
+                    uint16_t const iso88591[128] = {
+                        0x0080,0x0081,0x0082,0x0083,0x0084,0x0085,0x0086,0x0087,
+                        0x0088,0x0089,0x008A,0x008B,0x008C,0x008D,0x008E,0x008F,
+                        0x0090,0x0091,0x0092,0x0093,0x0094,0x0095,0x0096,0x0097,
+                        0x0098,0x0099,0x009A,0x009B,0x009C,0x009D,0x009E,0x009F,
+                        0x00A0,0x00A1,0x00A2,0x00A3,0x00A4,0x00A5,0x00A6,0x00A7,
+                        0x00A8,0x00A9,0x00AA,0x00AB,0x00AC,0x00AD,0x00AE,0x00AF,
+                        0x00B0,0x00B1,0x00B2,0x00B3,0x00B4,0x00B5,0x00B6,0x00B7,
+                        0x00B8,0x00B9,0x00BA,0x00BB,0x00BC,0x00BD,0x00BE,0x00BF,
+                        0x00C0,0x00C1,0x00C2,0x00C3,0x00C4,0x00C5,0x00C6,0x00C7,
+                        0x00C8,0x00C9,0x00CA,0x00CB,0x00CC,0x00CD,0x00CE,0x00CF,
+                        0x00D0,0x00D1,0x00D2,0x00D3,0x00D4,0x00D5,0x00D6,0x00D7,
+                        0x00D8,0x00D9,0x00DA,0x00DB,0x00DC,0x00DD,0x00DE,0x00DF,
+                        0x00E0,0x00E1,0x00E2,0x00E3,0x00E4,0x00E5,0x00E6,0x00E7,
+                        0x00E8,0x00E9,0x00EA,0x00EB,0x00EC,0x00ED,0x00EE,0x00EF,
+                        0x00F0,0x00F1,0x00F2,0x00F3,0x00F4,0x00F5,0x00F6,0x00F7,
+                        0x00F8,0x00F9,0x00FA,0x00FB,0x00FC,0x00FD,0x00FE,0x00FF
+                    };
+
+                    uint16_t const iso88592[128] = {
+                        0x0080,0x0081,0x0082,0x0083,0x0084,0x0085,0x0086,0x0087,
+                        0x0088,0x0089,0x008A,0x008B,0x008C,0x008D,0x008E,0x008F,
+                        0x0090,0x0091,0x0092,0x0093,0x0094,0x0095,0x0096,0x0097,
+                        0x0098,0x0099,0x009A,0x009B,0x009C,0x009D,0x009E,0x009F,
+                        0x00A0,0x0104,0x02D8,0x0141,0x00A4,0x013D,0x015A,0x00A7,
+                        0x00A8,0x0160,0x015E,0x0164,0x0179,0x00AD,0x017D,0x017B,
+                        0x00B0,0x0105,0x02DB,0x0142,0x00B4,0x013E,0x015B,0x02C7,
+                        0x00B8,0x0161,0x015F,0x0165,0x017A,0x02DD,0x017E,0x017C,
+                        0x0154,0x00C1,0x00C2,0x0102,0x00C4,0x0139,0x0106,0x00C7,
+                        0x010C,0x00C9,0x0118,0x00CB,0x011A,0x00CD,0x00CE,0x010E,
+                        0x0110,0x0143,0x0147,0x00D3,0x00D4,0x0150,0x00D6,0x00D7,
+                        0x0158,0x016E,0x00DA,0x0170,0x00DC,0x00DD,0x0162,0x00DF,
+                        0x0155,0x00E1,0x00E2,0x0103,0x00E4,0x013A,0x0107,0x00E7,
+                        0x010D,0x00E9,0x0119,0x00EB,0x011B,0x00ED,0x00EE,0x010F,
+                        0x0111,0x0144,0x0148,0x00F3,0x00F4,0x0151,0x00F6,0x00F7,
+                        0x0159,0x016F,0x00FA,0x0171,0x00FC,0x00FD,0x0163,0x02D9
+                    };
+
+                    uint16_t const iso88593[128] = {
+                        0x0080,0x0081,0x0082,0x0083,0x0084,0x0085,0x0086,0x0087,
+                        0x0088,0x0089,0x008A,0x008B,0x008C,0x008D,0x008E,0x008F,
+                        0x0090,0x0091,0x0092,0x0093,0x0094,0x0095,0x0096,0x0097,
+                        0x0098,0x0099,0x009A,0x009B,0x009C,0x009D,0x009E,0x009F,
+                        0x00A0,0x0126,0x02D8,0x00A3,0x00A4,0xFFFF,0x0124,0x00A7,
+                        0x00A8,0x0130,0x015E,0x011E,0x0134,0x00AD,0xFFFF,0x017B,
+                        0x00B0,0x0127,0x00B2,0x00B3,0x00B4,0x00B5,0x0125,0x00B7,
+                        0x00B8,0x0131,0x015F,0x011F,0x0135,0x00BD,0xFFFF,0x017C,
+                        0x00C0,0x00C1,0x00C2,0xFFFF,0x00C4,0x010A,0x0108,0x00C7,
+                        0x00C8,0x00C9,0x00CA,0x00CB,0x00CC,0x00CD,0x00CE,0x00CF,
+                        0xFFFF,0x00D1,0x00D2,0x00D3,0x00D4,0x0120,0x00D6,0x00D7,
+                        0x011C,0x00D9,0x00DA,0x00DB,0x00DC,0x016C,0x015C,0x00DF,
+                        0x00E0,0x00E1,0x00E2,0xFFFF,0x00E4,0x010B,0x0109,0x00E7,
+                        0x00E8,0x00E9,0x00EA,0x00EB,0x00EC,0x00ED,0x00EE,0x00EF,
+                        0xFFFF,0x00F1,0x00F2,0x00F3,0x00F4,0x0121,0x00F6,0x00F7,
+                        0x011D,0x00F9,0x00FA,0x00FB,0x00FC,0x016D,0x015D,0x02D9
+                    };
+
+                    uint16_t const iso88594[128] = {
+                        0x0080,0x0081,0x0082,0x0083,0x0084,0x0085,0x0086,0x0087,
+                        0x0088,0x0089,0x008A,0x008B,0x008C,0x008D,0x008E,0x008F,
+                        0x0090,0x0091,0x0092,0x0093,0x0094,0x0095,0x0096,0x0097,
+                        0x0098,0x0099,0x009A,0x009B,0x009C,0x009D,0x009E,0x009F,
+                        0x00A0,0x0104,0x0138,0x0156,0x00A4,0x0128,0x013B,0x00A7,
+                        0x00A8,0x0160,0x0112,0x0122,0x0166,0x00AD,0x017D,0x00AF,
+                        0x00B0,0x0105,0x02DB,0x0157,0x00B4,0x0129,0x013C,0x02C7,
+                        0x00B8,0x0161,0x0113,0x0123,0x0167,0x014A,0x017E,0x014B,
+                        0x0100,0x00C1,0x00C2,0x00C3,0x00C4,0x00C5,0x00C6,0x012E,
+                        0x010C,0x00C9,0x0118,0x00CB,0x0116,0x00CD,0x00CE,0x012A,
+                        0x0110,0x0145,0x014C,0x0136,0x00D4,0x00D5,0x00D6,0x00D7,
+                        0x00D8,0x0172,0x00DA,0x00DB,0x00DC,0x0168,0x016A,0x00DF,
+                        0x0101,0x00E1,0x00E2,0x00E3,0x00E4,0x00E5,0x00E6,0x012F,
+                        0x010D,0x00E9,0x0119,0x00EB,0x0117,0x00ED,0x00EE,0x012B,
+                        0x0111,0x0146,0x014D,0x0137,0x00F4,0x00F5,0x00F6,0x00F7,
+                        0x00F8,0x0173,0x00FA,0x00FB,0x00FC,0x0169,0x016B,0x02D9
+                    };
+
+                    uint16_t const iso88595[128] = {
+                        0x0080,0x0081,0x0082,0x0083,0x0084,0x0085,0x0086,0x0087,
+                        0x0088,0x0089,0x008A,0x008B,0x008C,0x008D,0x008E,0x008F,
+                        0x0090,0x0091,0x0092,0x0093,0x0094,0x0095,0x0096,0x0097,
+                        0x0098,0x0099,0x009A,0x009B,0x009C,0x009D,0x009E,0x009F,
+                        0x00A0,0x0401,0x0402,0x0403,0x0404,0x0405,0x0406,0x0407,
+                        0x0408,0x0409,0x040A,0x040B,0x040C,0x00AD,0x040E,0x040F,
+                        0x0410,0x0411,0x0412,0x0413,0x0414,0x0415,0x0416,0x0417,
+                        0x0418,0x0419,0x041A,0x041B,0x041C,0x041D,0x041E,0x041F,
+                        0x0420,0x0421,0x0422,0x0423,0x0424,0x0425,0x0426,0x0427,
+                        0x0428,0x0429,0x042A,0x042B,0x042C,0x042D,0x042E,0x042F,
+                        0x0430,0x0431,0x0432,0x0433,0x0434,0x0435,0x0436,0x0437,
+                        0x0438,0x0439,0x043A,0x043B,0x043C,0x043D,0x043E,0x043F,
+                        0x0440,0x0441,0x0442,0x0443,0x0444,0x0445,0x0446,0x0447,
+                        0x0448,0x0449,0x044A,0x044B,0x044C,0x044D,0x044E,0x044F,
+                        0x2116,0x0451,0x0452,0x0453,0x0454,0x0455,0x0456,0x0457,
+                        0x0458,0x0459,0x045A,0x045B,0x045C,0x00A7,0x045E,0x045F
+                    };
+
+                    uint16_t const iso88596[128] = {
+                        0x0080,0x0081,0x0082,0x0083,0x0084,0x0085,0x0086,0x0087,
+                        0x0088,0x0089,0x008A,0x008B,0x008C,0x008D,0x008E,0x008F,
+                        0x0090,0x0091,0x0092,0x0093,0x0094,0x0095,0x0096,0x0097,
+                        0x0098,0x0099,0x009A,0x009B,0x009C,0x009D,0x009E,0x009F,
+                        0x00A0,0xFFFF,0xFFFF,0xFFFF,0x00A4,0xFFFF,0xFFFF,0xFFFF,
+                        0xFFFF,0xFFFF,0xFFFF,0xFFFF,0x060C,0x00AD,0xFFFF,0xFFFF,
+                        0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,
+                        0xFFFF,0xFFFF,0xFFFF,0x061B,0xFFFF,0xFFFF,0xFFFF,0x061F,
+                        0xFFFF,0x0621,0x0622,0x0623,0x0624,0x0625,0x0626,0x0627,
+                        0x0628,0x0629,0x062A,0x062B,0x062C,0x062D,0x062E,0x062F,
+                        0x0630,0x0631,0x0632,0x0633,0x0634,0x0635,0x0636,0x0637,
+                        0x0638,0x0639,0x063A,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,
+                        0x0640,0x0641,0x0642,0x0643,0x0644,0x0645,0x0646,0x0647,
+                        0x0648,0x0649,0x064A,0x064B,0x064C,0x064D,0x064E,0x064F,
+                        0x0650,0x0651,0x0652,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,
+                        0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF
+                    };
+
+                    uint16_t const iso88597[128] = {
+                        0x0080,0x0081,0x0082,0x0083,0x0084,0x0085,0x0086,0x0087,
+                        0x0088,0x0089,0x008A,0x008B,0x008C,0x008D,0x008E,0x008F,
+                        0x0090,0x0091,0x0092,0x0093,0x0094,0x0095,0x0096,0x0097,
+                        0x0098,0x0099,0x009A,0x009B,0x009C,0x009D,0x009E,0x009F,
+                        0x00A0,0x2018,0x2019,0x00A3,0x20AC,0x20AF,0x00A6,0x00A7,
+                        0x00A8,0x00A9,0x037A,0x00AB,0x00AC,0x00AD,0xFFFF,0x2015,
+                        0x00B0,0x00B1,0x00B2,0x00B3,0x0384,0x0385,0x0386,0x00B7,
+                        0x0388,0x0389,0x038A,0x00BB,0x038C,0x00BD,0x038E,0x038F,
+                        0x0390,0x0391,0x0392,0x0393,0x0394,0x0395,0x0396,0x0397,
+                        0x0398,0x0399,0x039A,0x039B,0x039C,0x039D,0x039E,0x039F,
+                        0x03A0,0x03A1,0xFFFF,0x03A3,0x03A4,0x03A5,0x03A6,0x03A7,
+                        0x03A8,0x03A9,0x03AA,0x03AB,0x03AC,0x03AD,0x03AE,0x03AF,
+                        0x03B0,0x03B1,0x03B2,0x03B3,0x03B4,0x03B5,0x03B6,0x03B7,
+                        0x03B8,0x03B9,0x03BA,0x03BB,0x03BC,0x03BD,0x03BE,0x03BF,
+                        0x03C0,0x03C1,0x03C2,0x03C3,0x03C4,0x03C5,0x03C6,0x03C7,
+                        0x03C8,0x03C9,0x03CA,0x03CB,0x03CC,0x03CD,0x03CE,0xFFFF
+                    };
+
+                    uint16_t const iso88598[128] = {
+                        0x0080,0x0081,0x0082,0x0083,0x0084,0x0085,0x0086,0x0087,
+                        0x0088,0x0089,0x008A,0x008B,0x008C,0x008D,0x008E,0x008F,
+                        0x0090,0x0091,0x0092,0x0093,0x0094,0x0095,0x0096,0x0097,
+                        0x0098,0x0099,0x009A,0x009B,0x009C,0x009D,0x009E,0x009F,
+                        0x00A0,0xFFFF,0x00A2,0x00A3,0x00A4,0x00A5,0x00A6,0x00A7,
+                        0x00A8,0x00A9,0x00D7,0x00AB,0x00AC,0x00AD,0x00AE,0x00AF,
+                        0x00B0,0x00B1,0x00B2,0x00B3,0x00B4,0x00B5,0x00B6,0x00B7,
+                        0x00B8,0x00B9,0x00F7,0x00BB,0x00BC,0x00BD,0x00BE,0xFFFF,
+                        0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,
+                        0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,
+                        0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,
+                        0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0x2017,
+                        0x05D0,0x05D1,0x05D2,0x05D3,0x05D4,0x05D5,0x05D6,0x05D7,
+                        0x05D8,0x05D9,0x05DA,0x05DB,0x05DC,0x05DD,0x05DE,0x05DF,
+                        0x05E0,0x05E1,0x05E2,0x05E3,0x05E4,0x05E5,0x05E6,0x05E7,
+                        0x05E8,0x05E9,0x05EA,0xFFFF,0xFFFF,0x200E,0x200F,0xFFFF
+                    };
+
+                    uint16_t const iso88599[128] = {
+                        0x0080,0x0081,0x0082,0x0083,0x0084,0x0085,0x0086,0x0087,
+                        0x0088,0x0089,0x008A,0x008B,0x008C,0x008D,0x008E,0x008F,
+                        0x0090,0x0091,0x0092,0x0093,0x0094,0x0095,0x0096,0x0097,
+                        0x0098,0x0099,0x009A,0x009B,0x009C,0x009D,0x009E,0x009F,
+                        0x00A0,0x00A1,0x00A2,0x00A3,0x00A4,0x00A5,0x00A6,0x00A7,
+                        0x00A8,0x00A9,0x00AA,0x00AB,0x00AC,0x00AD,0x00AE,0x00AF,
+                        0x00B0,0x00B1,0x00B2,0x00B3,0x00B4,0x00B5,0x00B6,0x00B7,
+                        0x00B8,0x00B9,0x00BA,0x00BB,0x00BC,0x00BD,0x00BE,0x00BF,
+                        0x00C0,0x00C1,0x00C2,0x00C3,0x00C4,0x00C5,0x00C6,0x00C7,
+                        0x00C8,0x00C9,0x00CA,0x00CB,0x00CC,0x00CD,0x00CE,0x00CF,
+                        0x011E,0x00D1,0x00D2,0x00D3,0x00D4,0x00D5,0x00D6,0x00D7,
+                        0x00D8,0x00D9,0x00DA,0x00DB,0x00DC,0x0130,0x015E,0x00DF,
+                        0x00E0,0x00E1,0x00E2,0x00E3,0x00E4,0x00E5,0x00E6,0x00E7,
+                        0x00E8,0x00E9,0x00EA,0x00EB,0x00EC,0x00ED,0x00EE,0x00EF,
+                        0x011F,0x00F1,0x00F2,0x00F3,0x00F4,0x00F5,0x00F6,0x00F7,
+                        0x00F8,0x00F9,0x00FA,0x00FB,0x00FC,0x0131,0x015F,0x00FF
+                    };
+
+                    uint16_t const iso885913[128] = {
+                        0x0080,0x0081,0x0082,0x0083,0x0084,0x0085,0x0086,0x0087,
+                        0x0088,0x0089,0x008A,0x008B,0x008C,0x008D,0x008E,0x008F,
+                        0x0090,0x0091,0x0092,0x0093,0x0094,0x0095,0x0096,0x0097,
+                        0x0098,0x0099,0x009A,0x009B,0x009C,0x009D,0x009E,0x009F,
+                        0x00A0,0x201D,0x00A2,0x00A3,0x00A4,0x201E,0x00A6,0x00A7,
+                        0x00D8,0x00A9,0x0156,0x00AB,0x00AC,0x00AD,0x00AE,0x00C6,
+                        0x00B0,0x00B1,0x00B2,0x00B3,0x201C,0x00B5,0x00B6,0x00B7,
+                        0x00F8,0x00B9,0x0157,0x00BB,0x00BC,0x00BD,0x00BE,0x00E6,
+                        0x0104,0x012E,0x0100,0x0106,0x00C4,0x00C5,0x0118,0x0112,
+                        0x010C,0x00C9,0x0179,0x0116,0x0122,0x0136,0x012A,0x013B,
+                        0x0160,0x0143,0x0145,0x00D3,0x014C,0x00D5,0x00D6,0x00D7,
+                        0x0172,0x0141,0x015A,0x016A,0x00DC,0x017B,0x017D,0x00DF,
+                        0x0105,0x012F,0x0101,0x0107,0x00E4,0x00E5,0x0119,0x0113,
+                        0x010D,0x00E9,0x017A,0x0117,0x0123,0x0137,0x012B,0x013C,
+                        0x0161,0x0144,0x0146,0x00F3,0x014D,0x00F5,0x00F6,0x00F7,
+                        0x0173,0x0142,0x015B,0x016B,0x00FC,0x017C,0x017E,0x2019
+                    };
+
+                    uint16_t const iso885915[128] = {
+                        0x0080,0x0081,0x0082,0x0083,0x0084,0x0085,0x0086,0x0087,
+                        0x0088,0x0089,0x008A,0x008B,0x008C,0x008D,0x008E,0x008F,
+                        0x0090,0x0091,0x0092,0x0093,0x0094,0x0095,0x0096,0x0097,
+                        0x0098,0x0099,0x009A,0x009B,0x009C,0x009D,0x009E,0x009F,
+                        0x00A0,0x00A1,0x00A2,0x00A3,0x20AC,0x00A5,0x0160,0x00A7,
+                        0x0161,0x00A9,0x00AA,0x00AB,0x00AC,0x00AD,0x00AE,0x00AF,
+                        0x00B0,0x00B1,0x00B2,0x00B3,0x017D,0x00B5,0x00B6,0x00B7,
+                        0x017E,0x00B9,0x00BA,0x00BB,0x0152,0x0153,0x0178,0x00BF,
+                        0x00C0,0x00C1,0x00C2,0x00C3,0x00C4,0x00C5,0x00C6,0x00C7,
+                        0x00C8,0x00C9,0x00CA,0x00CB,0x00CC,0x00CD,0x00CE,0x00CF,
+                        0x00D0,0x00D1,0x00D2,0x00D3,0x00D4,0x00D5,0x00D6,0x00D7,
+                        0x00D8,0x00D9,0x00DA,0x00DB,0x00DC,0x00DD,0x00DE,0x00DF,
+                        0x00E0,0x00E1,0x00E2,0x00E3,0x00E4,0x00E5,0x00E6,0x00E7,
+                        0x00E8,0x00E9,0x00EA,0x00EB,0x00EC,0x00ED,0x00EE,0x00EF,
+                        0x00F0,0x00F1,0x00F2,0x00F3,0x00F4,0x00F5,0x00F6,0x00F7,
+                        0x00F8,0x00F9,0x00FA,0x00FB,0x00FC,0x00FD,0x00FE,0x00FF
+                    };
+
+                    uint16_t const koi8r[128] = {
+                        0x2500,0x2502,0x250C,0x2510,0x2514,0x2518,0x251C,0x2524,
+                        0x252C,0x2534,0x253C,0x2580,0x2584,0x2588,0x258C,0x2590,
+                        0x2591,0x2592,0x2593,0x2320,0x25A0,0x2219,0x221A,0x2248,
+                        0x2264,0x2265,0x00A0,0x2321,0x00B0,0x00B2,0x00B7,0x00F7,
+                        0x2550,0x2551,0x2552,0x0451,0x2553,0x2554,0x2555,0x2556,
+                        0x2557,0x2558,0x2559,0x255A,0x255B,0x255C,0x255D,0x255E,
+                        0x255F,0x2560,0x2561,0x0401,0x2562,0x2563,0x2564,0x2565,
+                        0x2566,0x2567,0x2568,0x2569,0x256A,0x256B,0x256C,0x00A9,
+                        0x044E,0x0430,0x0431,0x0446,0x0434,0x0435,0x0444,0x0433,
+                        0x0445,0x0438,0x0439,0x043A,0x043B,0x043C,0x043D,0x043E,
+                        0x043F,0x044F,0x0440,0x0441,0x0442,0x0443,0x0436,0x0432,
+                        0x044C,0x044B,0x0437,0x0448,0x044D,0x0449,0x0447,0x044A,
+                        0x042E,0x0410,0x0411,0x0426,0x0414,0x0415,0x0424,0x0413,
+                        0x0425,0x0418,0x0419,0x041A,0x041B,0x041C,0x041D,0x041E,
+                        0x041F,0x042F,0x0420,0x0421,0x0422,0x0423,0x0416,0x0412,
+                        0x042C,0x042B,0x0417,0x0428,0x042D,0x0429,0x0427,0x042A
+                    };
+
+                    uint16_t const koi8u[128] = {
+                        0x2500,0x2502,0x250C,0x2510,0x2514,0x2518,0x251C,0x2524,
+                        0x252C,0x2534,0x253C,0x2580,0x2584,0x2588,0x258C,0x2590,
+                        0x2591,0x2592,0x2593,0x2320,0x25A0,0x2219,0x221A,0x2248,
+                        0x2264,0x2265,0x00A0,0x2321,0x00B0,0x00B2,0x00B7,0x00F7,
+                        0x2550,0x2551,0x2552,0x0451,0x0454,0x2554,0x0456,0x0457,
+                        0x2557,0x2558,0x2559,0x255A,0x255B,0x0491,0x255D,0x255E,
+                        0x255F,0x2560,0x2561,0x0401,0x0404,0x2563,0x0406,0x0407,
+                        0x2566,0x2567,0x2568,0x2569,0x256A,0x0490,0x256C,0x00A9,
+                        0x044E,0x0430,0x0431,0x0446,0x0434,0x0435,0x0444,0x0433,
+                        0x0445,0x0438,0x0439,0x043A,0x043B,0x043C,0x043D,0x043E,
+                        0x043F,0x044F,0x0440,0x0441,0x0442,0x0443,0x0436,0x0432,
+                        0x044C,0x044B,0x0437,0x0448,0x044D,0x0449,0x0447,0x044A,
+                        0x042E,0x0410,0x0411,0x0426,0x0414,0x0415,0x0424,0x0413,
+                        0x0425,0x0418,0x0419,0x041A,0x041B,0x041C,0x041D,0x041E,
+                        0x041F,0x042F,0x0420,0x0421,0x0422,0x0423,0x0416,0x0412,
+                        0x042C,0x042B,0x0417,0x0428,0x042D,0x0429,0x0427,0x042A
+                    };
+
+                    uint16_t const usascii[128] = {
+                        0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,
+                        0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,
+                        0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,
+                        0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,
+                        0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,
+                        0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,
+                        0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,
+                        0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,
+                        0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,
+                        0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,
+                        0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,
+                        0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,
+                        0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,
+                        0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,
+                        0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,
+                        0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF
+                    };
+
+                    struct codepage_name {
+                        char const *name;
+                        uint16_t const *table;
+                    };
+
+                    codepage_name const simple_encoding_table[] = {
+                        { "cp1250", cp1250 },
+                        { "cp1251", cp1251 },
+                        { "cp1252", cp1252 },
+                        { "cp1253", cp1253 },
+                        { "cp1254", cp1254 },
+                        { "cp1255", cp1255 },
+                        { "cp1256", cp1256 },
+                        { "cp1257", cp1257 },
+                        { "iso88591", iso88591 },
+                        { "iso885913", iso885913 },
+                        { "iso885915", iso885915 },
+                        { "iso88592", iso88592 },
+                        { "iso88593", iso88593 },
+                        { "iso88594", iso88594 },
+                        { "iso88595", iso88595 },
+                        { "iso88596", iso88596 },
+                        { "iso88597", iso88597 },
+                        { "iso88598", iso88598 },
+                        { "iso88599", iso88599 },
+                        { "koi8r", koi8r },
+                        { "koi8u", koi8u },
+                        { "usascii", usascii },
+                        { "windows1250", cp1250 },
+                        { "windows1251", cp1251 },
+                        { "windows1252", cp1252 },
+                        { "windows1253", cp1253 },
+                        { "windows1254", cp1254 },
+                        { "windows1255", cp1255 },
+                        { "windows1256", cp1256 },
+                        { "windows1257", cp1257 }
+                    };
+
+                    size_t const simple_encodings_count = sizeof(simple_encoding_table)/sizeof(simple_encoding_table[0]);
+
+                    bool compare_names(codepage_name const &l,char const *r)
+                    {
+                        return strcmp(l.name,r) < 0;
+                    }
+
+                    class simple_codepages {
+                    public:
+                        simple_codepages()
+                        {
+                            // aliases share the same table
+                            codepages_.reserve(simple_encodings_count);
+                            for(size_t i=0;i<simple_encodings_count;i++) {
+                                size_t j=0;
+                                while(j<i && simple_encoding_table[j].table != simple_encoding_table[i].table)
+                                    j++;
+                                if(j==i) {
+                                    index_.push_back(codepages_.size());
+                                    codepages_.push_back(simple_codepage(simple_encoding_table[i].table));
+                                }
+                                else {
+                                    index_.push_back(index_[j]);
+                                }
+                            }
+                        }
+
+                        simple_codepage const *get(char const *name) const
+                        {
+                            codepage_name const *begin = simple_encoding_table;
+                            codepage_name const *end = simple_encoding_table + simple_encodings_count;
+                            codepage_name const *p = std::lower_bound(begin,end,name,compare_names);
+                            if(p==end || strcmp(p->name,name)!=0)
+                                return 0;
+                            return &codepages_[index_[p - begin]];
+                        }
+                    private:
+                        std::vector<simple_codepage> codepages_;
+                        std::vector<size_t> index_;
+                    };
+
+                    simple_codepages const &get_simple_codepages()
+                    {
+                        static simple_codepages const codepages;
+                        return codepages;
+                    }
+
+                    struct simple_codepages_init {
+                        simple_codepages_init()
+                        {
+                            get_simple_codepages();
+                        }
+                    } do_simple_codepages_init;
+
+                } // anon
+
+                simple_codepage const *get_simple_codepage(std::string const &normalized_encoding)
+                {
+                    return get_simple_codepages().get(normalized_encoding.c_str());
+                }
+
+            } // impl
+        } // conv
+    } // locale
+} // boost
+
+// vim: tabstop=4 expandtab shiftwidth=4 softtabstop=4
@@ -0,0 +1,72 @@
+//
+//  Copyright (c) 2009-2011 Artyom Beilis (Tonkikh)
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef BOOST_LOCALE_IMPL_SIMPLE_CODEPAGE_HPP
+#define BOOST_LOCALE_IMPL_SIMPLE_CODEPAGE_HPP
+
+#include <boost/cstdint.hpp>
+#include <string>
+#include <vector>
+
+namespace boost {
+    namespace locale {
+        namespace conv {
+            namespace impl {
+
+                ///
+                /// Built-in table of a single byte encoding that maps each byte to one code point
+                ///
+                class simple_codepage {
+                public:
+                    ///
+                    /// Create from the code points of bytes 0x80-0xFF, 0xFFFF marks undefined bytes
+                    ///
+                    simple_codepage(uint16_t const *upper_half);
+
+                    ///
+                    /// The code point of \a c or 0xFFFFFFFF if undefined
+                    ///
+                    uint32_t to_unicode(unsigned char c) const
+                    {
+                        return to_unicode_[c];
+                    }
+
+                    ///
+                    /// The byte that represents \a u or -1 if it can't be represented
+                    ///
+                    int from_unicode(uint32_t u) const
+                    {
+                        if(u > 0xFFFF)
+                            return -1;
+                        unsigned page = pages_index_[u >> 8];
+                        if(page == 0)
+                            return -1;
+                        unsigned char c = pages_[(page - 1) * 256 + (u & 0xFF)];
+                        if(c == 0 && u != 0)
+                            return -1;
+                        return c;
+                    }
+
+                private:
+                    uint32_t to_unicode_[256];
+                    unsigned char pages_index_[256];    // 0 - no byte maps to this page, otherwise page + 1
+                    std::vector<unsigned char> pages_;
+                };
+
+                ///
+                /// Get the built-in table of an encoding by its normalized name, returns 0 if there is none
+                ///
+                simple_codepage const *get_simple_codepage(std::string const &normalized_encoding);
+
+            } // impl
+        } // conv
+    } // locale
+} // boost
+
+#endif
+
+// vim: tabstop=4 expandtab shiftwidth=4 softtabstop=4
@@ -0,0 +1,237 @@
+//
+//  Copyright (c) 2009-2011 Artyom Beilis (Tonkikh)
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#define BOOST_LOCALE_SOURCE
+#include <boost/locale/encoding.hpp>
+#include <boost/locale/utf.hpp>
+
+#if (defined(__x86_64__) || defined(__i386__)) \
+    && (defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#  define BOOST_LOCALE_AVX2_DISPATCH
+#  include <immintrin.h>
+#endif
+
+namespace boost {
+    namespace locale {
+        namespace conv {
+            namespace {
+
+                //
+                // Portable versions, narrow text is scanned with SSE2 or a word at a time
+                // while it is ASCII and decoded by code points otherwise
+                //
+
+                bool generic_validate_utf8(char const *begin,char const *end)
+                {
+                    while(begin!=end) {
+                        begin = utf::details::skip_ascii(begin,end);
+                        if(begin==end)
+                            break;
+                        utf::code_point c = utf::utf_traits<char>::decode(begin,end);
+                        if(c==utf::illegal || c==utf::incomplete)
+                            return false;
+                    }
+                    return true;
+                }
+
+                bool generic_is_ascii(char const *begin,char const *end)
+                {
+                    return utf::details::skip_ascii(begin,end)==end;
+                }
+
+                #ifdef BOOST_LOCALE_AVX2_DISPATCH
+
+                //
+                // Validation of 32 bytes at a time by the lookup algorithm of Keiser and Lemire,
+                // "Validating UTF-8 In Less Than One Instruction Per Byte": the high nibble of each
+                // byte and both nibbles of the byte before it index three tables whose common bits
+                // mark an error, required continuation bytes are checked separately
+                //
+
+                static const char too_short      = 1<<0; // lead byte or ASCII followed by lead byte or ASCII
+                static const char too_long       = 1<<1; // ASCII followed by continuation
+                static const char overlong_3     = 1<<2;
+                static const char too_large      = 1<<3;
+                static const char surrogate      = 1<<4;
+                static const char overlong_2     = 1<<5;
+                static const char too_large_1000 = 1<<6;
+                static const char overlong_4     = 1<<6;
+                static const char two_conts      = char(1<<7); // continuation followed by continuation
+                static const char carry          = too_short | too_long | two_conts;
+
+                #define BOOST_LOCALE_TABLE16(a,b,c,d,e,f,g,h,i,j,k,l,m,n,o,p) \
+                    _mm256_setr_epi8(a,b,c,d,e,f,g,h,i,j,k,l,m,n,o,p,a,b,c,d,e,f,g,h,i,j,k,l,m,n,o,p)
+
+                __attribute__((target("avx2")))
+                inline __m256i avx2_prev(__m256i input,__m256i prev_input,int n)
+                {
+                    __m256i shifted = _mm256_permute2x128_si256(prev_input,input,0x21);
+                    switch(n) {
+                    case 1: return _mm256_alignr_epi8(input,shifted,16-1);
+                    case 2: return _mm256_alignr_epi8(input,shifted,16-2);
+                    default: return _mm256_alignr_epi8(input,shifted,16-3);
+                    }
+                }
+
+                __attribute__((target("avx2")))
+                inline __m256i avx2_high_nibble(__m256i v)
+                {
+                    return _mm256_and_si256(_mm256_srli_epi16(v,4),_mm256_set1_epi8(0x0F));
+                }
+
+                __attribute__((target("avx2")))
+                inline __m256i avx2_check_block(__m256i input,__m256i prev_input)
+                {
+                    __m256i prev1 = avx2_prev(input,prev_input,1);
+                    __m256i byte_1_high = _mm256_shuffle_epi8(BOOST_LOCALE_TABLE16(
+                        // 0_______ ________ ASCII in byte 1
+                        too_long, too_long, too_long, too_long,
+                        too_long, too_long, too_long, too_long,
+                        // 10______ ________ continuation in byte 1
+                        two_conts, two_conts, two_conts, two_conts,
+                        // 1100____ ________ two byte lead
+                        too_short | overlong_2,
+                        // 1101____ ________ two byte lead
+                        too_short,
+                        // 1110____ ________ three byte lead
+                        too_short | overlong_3 | surrogate,
+                        // 1111____ ________ four byte lead
+                        too_short | too_large | too_large_1000 | overlong_4),
+                        avx2_high_nibble(prev1));
+                    __m256i byte_1_low = _mm256_shuffle_epi8(BOOST_LOCALE_TABLE16(
+                        // ____0000 ________
+                        carry | overlong_3 | overlong_2 | overlong_4,
+                        // ____0001 ________
+                        carry | overlong_2,
+                        // ____001_ ________
+                        carry,
+                        carry,
+                        // ____0100 ________
+                        carry | too_large,
+                        // ____0101 ________
+                        carry | too_large | too_large_1000,
+                        // ____011_ ________
+                        carry | too_large | too_large_1000,
+                        carry | too_large | too_large_1000,
+                        // ____1___ ________
+                        carry | too_large | too_large_1000,
+                        carry | too_large | too_large_1000,
+                        carry | too_large | too_large_1000,
+                        carry | too_large | too_large_1000,
+                        carry | too_large | too_large_1000,
+                        // ____1101 ________
+                        carry | too_large | too_large_1000 | surrogate,
+                        carry | too_large | too_large_1000,
+                        carry | too_large | too_large_1000),
+                        _mm256_and_si256(prev1,_mm256_set1_epi8(0x0F)));
+                    __m256i byte_2_high = _mm256_shuffle_epi8(BOOST_LOCALE_TABLE16(
+                        // ________ 0_______ ASCII in byte 2
+                        too_short, too_short, too_short, too_short,
+                        too_short, too_short, too_short, too_short,
+                        // ________ 1000____
+                        too_long | overlong_2 | two_conts | overlong_3 | too_large_1000 | overlong_4,
+                        // ________ 1001____
+                        too_long | overlong_2 | two_conts | overlong_3 | too_large,
+                        // ________ 101_____
+                        too_long | overlong_2 | two_conts | surrogate  | too_large,
+                        too_long | overlong_2 | two_conts | surrogate  | too_large,
+                        // ________ 11______ lead byte in byte 2
+                        too_short, too_short, too_short, too_short),
+                        avx2_high_nibble(input));
+                    __m256i special_cases = _mm256_and_si256(_mm256_and_si256(byte_1_high,byte_1_low),byte_2_high);
+
+                    // the third and the fourth bytes of a sequence must be continuations, which
+                    // special_cases marks as two_conts
+                    __m256i prev2 = avx2_prev(input,prev_input,2);
+                    __m256i prev3 = avx2_prev(input,prev_input,3);
+                    __m256i is_third_byte  = _mm256_subs_epu8(prev2,_mm256_set1_epi8(char(0xE0-0x80)));
+                    __m256i is_fourth_byte = _mm256_subs_epu8(prev3,_mm256_set1_epi8(char(0xF0-0x80)));
+                    __m256i must23_80 = _mm256_and_si256(_mm256_or_si256(is_third_byte,is_fourth_byte),_mm256_set1_epi8(char(0x80)));
+                    return _mm256_xor_si256(must23_80,special_cases);
+                }
+
+                #undef BOOST_LOCALE_TABLE16
+
+                __attribute__((target("avx2")))
+                bool avx2_validate_utf8(char const *begin,char const *end)
+                {
+                    char const *start = begin;
+                    __m256i prev_input = _mm256_setzero_si256();
+                    __m256i error = _mm256_setzero_si256();
+                    while(end - begin >= 32) {
+                        __m256i input = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(begin));
+                        // ASCII after complete sequences can not hold an error
+                        if(_mm256_movemask_epi8(input)==0 && _mm256_movemask_epi8(prev_input)==0) {
+                            prev_input = input;
+                            begin += 32;
+                            continue;
+                        }
+                        error = _mm256_or_si256(error,avx2_check_block(input,prev_input));
+                        prev_input = input;
+                        begin += 32;
+                    }
+                    if(!_mm256_testz_si256(error,error))
+                        return false;
+                    // the sequence holding the last byte of the blocks may continue past them,
+                    // so it is validated again together with the rest of the text
+                    if(begin!=start) {
+                        --begin;
+                        for(int i=0;i<3 && begin!=start && (static_cast<unsigned char>(*begin) & 0xC0)==0x80;i++)
+                            --begin;
+                    }
+                    return generic_validate_utf8(begin,end);
+                }
+
+                __attribute__((target("avx2")))
+                bool avx2_is_ascii(char const *begin,char const *end)
+                {
+                    while(end - begin >= 128) {
+                        __m256i a = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(begin));
+                        __m256i b = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(begin + 32));
+                        __m256i c = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(begin + 64));
+                        __m256i d = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(begin + 96));
+                        __m256i all = _mm256_or_si256(_mm256_or_si256(a,b),_mm256_or_si256(c,d));
+                        if(_mm256_movemask_epi8(all)!=0)
+                            return false;
+                        begin += 128;
+                    }
+                    return generic_is_ascii(begin,end);
+                }
+
+                bool has_avx2()
+                {
+                    static bool const supported = __builtin_cpu_supports("avx2") != 0;
+                    return supported;
+                }
+
+                #endif
+
+            } // anon
+
+            bool validate_utf8(char const *begin,char const *end)
+            {
+                #ifdef BOOST_LOCALE_AVX2_DISPATCH
+                if(has_avx2())
+                    return avx2_validate_utf8(begin,end);
+                #endif
+                return generic_validate_utf8(begin,end);
+            }
+
+            bool is_ascii(char const *begin,char const *end)
+            {
+                #ifdef BOOST_LOCALE_AVX2_DISPATCH
+                if(has_avx2())
+                    return avx2_is_ascii(begin,end);
+                #endif
+                return generic_is_ascii(begin,end);
+            }
+
+        } // conv
+    } // locale
+} // boost
+
+// vim: tabstop=4 expandtab shiftwidth=4 softtabstop=4
@@ -106,23 +106,23 @@ public:
         switch(how) {
         case upper_case:
             {
-                std::wstring tmp = conv::to_utf<wchar_t>(begin,end,"UTF-8");
+                std::wstring tmp = conv::utf_to_utf<wchar_t>(begin,end);
                 std::wstring wres;
                 wres.reserve(tmp.size());
                 for(unsigned i=0;i<tmp.size();i++)
                     wres+=towupper_l(tmp[i],*lc_);
-                return conv::from_utf<wchar_t>(wres,"UTF-8");
+                return conv::utf_to_utf<char>(wres);
             }
             
         case lower_case:
         case case_folding:
             {
-                std::wstring tmp = conv::to_utf<wchar_t>(begin,end,"UTF-8");
+                std::wstring tmp = conv::utf_to_utf<wchar_t>(begin,end);
                 std::wstring wres;
                 wres.reserve(tmp.size());
                 for(unsigned i=0;i<tmp.size();i++)
                     wres+=towlower_l(tmp[i],*lc_);
-                return conv::from_utf<wchar_t>(wres,"UTF-8");
+                return conv::utf_to_utf<char>(wres);
             }
         default:
             return std::string(begin,end-begin);
@@ -0,0 +1,24 @@
+//
+//  Copyright (c) 2009-2011 Artyom Beilis (Tonkikh)
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef BOOST_SRC_LOCALE_BACKEND_VERSION_HPP_INCLUDED
+#define BOOST_SRC_LOCALE_BACKEND_VERSION_HPP_INCLUDED
+
+namespace boost {
+    namespace locale {
+        namespace impl {
+            ///
+            /// The number of times the global localization_backend_manager was replaced, the locales
+            /// generated with the global manager may differ when it changes
+            ///
+            unsigned global_backend_manager_version();
+        } // impl
+    } // locale
+} // boost
+
+#endif
+// vim: tabstop=4 expandtab shiftwidth=4 softtabstop=4
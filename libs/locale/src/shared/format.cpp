@@ -9,77 +9,249 @@
 #include <boost/locale/format.hpp>
 #include <boost/locale/generator.hpp>
 #include <boost/locale/info.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
 #include <limits>
+#include <map>
 #include <stdlib.h>
+#include "backend_version.hpp"
 
 #include <iostream>
 
 namespace boost {
     namespace locale {
         namespace details {
-            struct format_parser::data {
-                unsigned position;
-                std::streamsize precision;
-                std::ios_base::fmtflags flags;
-                ios_info info;
-                std::locale saved_locale;
-                bool restore_locale;
-                void *cookie;
-                void (*imbuer)(void *,std::locale const &);
-            };
+
+            namespace {
+                //
+                // Process-wide cache of the locales generated for the locale flag. It is emptied when it
+                // grows too large or when the global localization backend is replaced.
+                //
+                class formatting_locale_cache {
+                public:
+                    formatting_locale_cache() : 
+                        version_(0)
+                    {
+                    }
+
+                    std::locale get(std::string const &id)
+                    {
+                        unsigned version = impl::global_backend_manager_version();
+                        {
+                            boost::unique_lock<boost::mutex> guard(lock_);
+                            if(version_ != version) {
+                                cache_.clear();
+                                version_ = version;
+                            }
+                            cache_type::const_iterator p = cache_.find(id);
+                            if(p!=cache_.end())
+                                return p->second;
+                        }
+
+                        generator gen;
+                        gen.categories(formatting_facet);
+                        gen.locale_cache_enabled(false);
+                        std::locale result = gen(id);
+
+                        boost::unique_lock<boost::mutex> guard(lock_);
+                        if(version_ == version) {
+                            if(cache_.size() >= max_size)
+                                cache_.clear();
+                            cache_.insert(std::make_pair(id,result));
+                        }
+                        return result;
+                    }
+                private:
+                    static size_t const max_size = 64;
+                    typedef std::map<std::string,std::locale> cache_type;
+                    boost::mutex lock_;
+                    unsigned version_;
+                    cache_type cache_;
+                };
+
+                formatting_locale_cache &get_formatting_locale_cache()
+                {
+                    static formatting_locale_cache the_cache;
+                    return the_cache;
+                }
+
+                struct formatting_locale_cache_init {
+                    formatting_locale_cache_init()
+                    {
+                        get_formatting_locale_cache();
+                    }
+                } do_formatting_locale_cache_init;
+            } // anon
 
             format_parser::format_parser(std::ios_base &ios,void *cookie,void (*imbuer)(void *,std::locale const &)) : 
                 ios_(ios),
-                d(new data)
+                cookie_(cookie),
+                imbuer_(imbuer),
+                position_(std::numeric_limits<unsigned>::max()),
+                saved_(0),
+                display_flags_(0),
+                stream_flags_(),
+                precision_(0),
+                locale_(std::locale::classic())
             {
-                d->position=std::numeric_limits<unsigned>::max();
-                d->precision=ios.precision();
-                d->flags = ios.flags();
-                d->info=ios_info::get(ios);
-                d->saved_locale = ios.getloc();
-                d->restore_locale=false;
-                d->cookie = cookie;
-                d->imbuer = imbuer;
             }
 
             void format_parser::imbue(std::locale const &l)
             {
-                d->imbuer(d->cookie,l);
+                imbuer_(cookie_,l);
             }
 
             format_parser::~format_parser()
             {
             }
 
+            void format_parser::save(unsigned what)
+            {
+                what &= ~saved_;
+                if(what == 0)
+                    return;
+                if(what & saved_display_flags) {
+                    ios_info const &info = ios_info::get(ios_);
+                    display_flags_ = info.display_flags() | info.currency_flags() | info.date_flags() | info.time_flags();
+                }
+                if(what & saved_stream_flags)
+                    stream_flags_ = ios_.flags();
+                if(what & saved_precision)
+                    precision_ = ios_.precision();
+                if(what & saved_time_zone)
+                    time_zone_ = ios_info::get(ios_).time_zone();
+                if(what & saved_locale)
+                    locale_ = ios_.getloc();
+                saved_ |= what;
+            }
+
+            void format_parser::save_info()
+            {
+                if(!info_.get())
+                    info_.reset(new ios_info(ios_info::get(ios_)));
+            }
+
             void format_parser::restore()
             {
-                ios_info::get(ios_) = d->info;
+                ios_info &info = ios_info::get(ios_);
+                // the flags and the time zone may have been changed before the complete copy was made
+                if(info_.get())
+                    info = *info_;
+                if(saved_ & saved_display_flags) {
+                    info.display_flags(display_flags_ & flags::display_flags_mask);
+                    info.currency_flags(display_flags_ & flags::currency_flags_mask);
+                    info.date_flags(display_flags_ & flags::date_flags_mask);
+                    info.time_flags(display_flags_ & flags::time_flags_mask);
+                }
+                if(saved_ & saved_time_zone)
+                    info.time_zone(time_zone_);
                 ios_.width(0);
-                ios_.flags(d->flags);
-                if(d->restore_locale)
-                    imbue(d->saved_locale);
+                if(saved_ & saved_stream_flags)
+                    ios_.flags(stream_flags_);
+                if(saved_ & saved_precision)
+                    ios_.precision(precision_);
+                if(saved_ & saved_locale)
+                    imbue(locale_);
             }
 
             unsigned format_parser::get_position()
             {
-                return d->position;
+                return position_;
             }
 
-            void format_parser::set_one_flag(std::string const &key,std::string const &value)
+            int format_parser::key_code(std::string const &key)
             {
                 if(key.empty())
-                    return;
+                    return unknown_key;
                 unsigned i;
                 for(i=0;i<key.size();i++) {
                     if(key[i] < '0' || '9'< key[i])
                         break;
                 }
-                if(i==key.size()) {
-                    d->position=atoi(key.c_str()) - 1;
-                    return;
+                if(i==key.size())
+                    return position_key;
+
+                if(key=="num" || key=="number")
+                    return number_key;
+                else if(key=="cur" || key=="currency")
+                    return currency_key;
+                else if(key=="per" || key=="percent")
+                    return percent_key;
+                else if(key=="date")
+                    return date_key;
+                else if(key=="time")
+                    return time_key;
+                else if(key=="dt" || key=="datetime")
+                    return datetime_key;
+                else if(key=="ftime" || key=="strftime")
+                    return ftime_key;
+                else if(key=="spell" || key=="spellout")
+                    return spellout_key;
+                else if(key=="ord" || key=="ordinal")
+                    return ordinal_key;
+                else if(key=="left" || key=="<")
+                    return left_key;
+                else if(key=="right" || key==">")
+                    return right_key;
+                else if(key=="gmt")
+                    return gmt_key;
+                else if(key=="local")
+                    return local_key;
+                else if(key=="timezone" || key=="tz")
+                    return timezone_key;
+                else if(key=="w" || key=="width")
+                    return width_key;
+                else if(key=="p" || key=="precision")
+                    return precision_key;
+                else if(key=="locale")
+                    return locale_key;
+                return unknown_key;
+            }
+
+            void format_parser::set_one_flag(std::string const &key,std::string const &value)
+            {
+                int code = key_code(key);
+                if(code == position_key)
+                    position_=atoi(key.c_str()) - 1;
+                else
+                    set_flag(code,value);
+            }
+
+            void format_parser::set_flag(int key,std::string const &value)
+            {
+                switch(key) {
+                case number_key:
+                    save(saved_display_flags | saved_stream_flags);
+                    break;
+                case left_key:
+                case right_key:
+                    save(saved_stream_flags);
+                    break;
+                case currency_key:
+                case percent_key:
+                case date_key:
+                case time_key:
+                case datetime_key:
+                case spellout_key:
+                case ordinal_key:
+                    save(saved_display_flags);
+                    break;
+                case gmt_key:
+                case local_key:
+                case timezone_key:
+                    save(saved_time_zone);
+                    break;
+                case precision_key:
+                    save(saved_precision);
+                    break;
+                case locale_key:
+                    save(saved_locale);
+                    break;
+                default:
+                    break;
                 }
 
-                if(key=="num" || key=="number") {
+                if(key==number_key) {
                     as::number(ios_);
 
                     if(value=="hex")
@@ -91,17 +263,17 @@ namespace boost {
                     else if(value=="fix" || value=="fixed")
                         ios_.setf(std::ios_base::fixed,std::ios_base::floatfield);
                 }
-                else if(key=="cur" || key=="currency") {
+                else if(key==currency_key) {
                     as::currency(ios_);
                     if(value=="iso") 
                         as::currency_iso(ios_);
                     else if(value=="nat" || value=="national")
                         as::currency_national(ios_);
                 }
-                else if(key=="per" || key=="percent") {
+                else if(key==percent_key) {
                     as::percent(ios_);
                 }
-                else if(key=="date") {
+                else if(key==date_key) {
                     as::date(ios_);
                     if(value=="s" || value=="short")
                         as::date_short(ios_);
@@ -112,7 +284,7 @@ namespace boost {
                     else if(value=="f" || value=="full")
                         as::date_full(ios_);
                 }
-                else if(key=="time") {
+                else if(key==time_key) {
                     as::time(ios_);
                     if(value=="s" || value=="short")
                         as::time_short(ios_);
@@ -123,7 +295,7 @@ namespace boost {
                     else if(value=="f" || value=="full")
                         as::time_full(ios_);
                 }
-                else if(key=="dt" || key=="datetime") {
+                else if(key==datetime_key) {
                     as::datetime(ios_);
                     if(value=="s" || value=="short") {
                         as::date_short(ios_);
@@ -142,46 +314,381 @@ namespace boost {
                         as::time_full(ios_);
                     }
                 }
-                else if(key=="spell" || key=="spellout") {
+                else if(key==spellout_key) {
                     as::spellout(ios_);
                 }
-                else if(key=="ord" || key=="ordinal") {
+                else if(key==ordinal_key) {
                     as::ordinal(ios_);
                 }
-                else if(key=="left" || key=="<")
+                else if(key==left_key)
                     ios_.setf(std::ios_base::left,std::ios_base::adjustfield);
-                else if(key=="right" || key==">")
+                else if(key==right_key)
                     ios_.setf(std::ios_base::right,std::ios_base::adjustfield);
-                else if(key=="gmt")
+                else if(key==gmt_key)
                     as::gmt(ios_);
-                else if(key=="local")
+                else if(key==local_key)
                     as::local_time(ios_);
-                else if(key=="timezone" || key=="tz")
+                else if(key==timezone_key)
                     ios_info::get(ios_).time_zone(value);
-                else if(key=="w" || key=="width")
+                else if(key==width_key)
                     ios_.width(atoi(value.c_str()));
-                else if(key=="p" || key=="precision")
+                else if(key==precision_key)
                     ios_.precision(atoi(value.c_str()));
-                else if(key=="locale") {
-                    if(!d->restore_locale) {
-                        d->saved_locale=ios_.getloc();
-                        d->restore_locale=true;
-                    }
+                else if(key==locale_key) {
+                    std::string encoding=std::use_facet<info>(locale_).encoding();
 
-                    std::string encoding=std::use_facet<info>(d->saved_locale).encoding();
-                    generator gen;
-                    gen.categories(formatting_facet);
-                   
-                    std::locale new_loc;
                     if(value.find('.')==std::string::npos) 
-                        new_loc = gen(value + "." +  encoding);
+                        imbue(get_formatting_locale_cache().get(value + "." +  encoding));
                     else
-                        new_loc = gen(value);
+                        imbue(get_formatting_locale_cache().get(value));
+                }
+
+            }
+
+            namespace {
+
+                //
+                // The format string [begin,end) that reads as 0 past its end
+                //
+                template<typename CharType>
+                class format_text {
+                public:
+                    format_text(CharType const *begin,CharType const *end) :
+                        begin_(begin),
+                        size_(end - begin)
+                    {
+                    }
+                    CharType operator[](size_t pos) const
+                    {
+                        return pos < size_ ? begin_[pos] : 0;
+                    }
+                private:
+                    CharType const *begin_;
+                    size_t size_;
+                };
+
+                template<typename CharType>
+                compiled_format *compile(CharType const *begin,CharType const *end)
+                {
+                    CharType obrk='{';
+                    CharType cbrk='}';
+                    CharType eq='=';
+                    CharType comma=',';
+                    CharType quote='\'';
+
+                    std::auto_ptr<compiled_format> result(new compiled_format());
+                    std::vector<compiled_format::item> &items = result->items;
+                    std::vector<compiled_format::flag> &flags = result->flags;
 
-                    imbue(new_loc);
+                    size_t pos = 0;
+                    size_t size=end - begin;
+                    format_text<CharType> format(begin,end);
+                    while(format[pos]!=0) {
+                        if(format[pos] != obrk || (pos+1 < size && format[pos+1]==obrk)) {
+                            // literal text, "{{" and "}}" stand for a single bracket
+                            size_t begin = pos;
+                            if(format[pos]==obrk || (format[pos]==cbrk && format[pos+1]==cbrk))
+                                pos+=2;
+                            else
+                                pos++;
+                            if(!items.empty() && !items.back().placeholder && items.back().end == begin) {
+                                items.back().end++;
+                            }
+                            else {
+                                compiled_format::item it;
+                                it.begin = begin;
+                                it.end = begin + 1;
+                                it.position = 0;
+                                it.placeholder = false;
+                                items.push_back(it);
+                            }
+                            continue;
+                        }
+                        pos++;
+
+                        compiled_format::item it;
+                        it.begin = flags.size();
+                        it.end = it.begin;
+                        it.position = std::numeric_limits<unsigned>::max();
+                        it.placeholder = true;
+                        bool closed = false;
+
+                        while(pos < size) {
+                            std::string key;
+                            compiled_format::flag f;
+                            f.quoted = false;
+                            f.begin = f.end = 0;
+                            for(;format[pos];pos++) {
+                                CharType c=format[pos];
+                                if(c==comma || c==eq || c==cbrk)
+                                    break;
+                                else {
+                                    key+=static_cast<char>(c);
+                                }
+                            }
+
+                            if(format[pos]==eq) {
+                                pos++;
+                                if(format[pos]==quote) {
+                                    pos++;
+                                    f.quoted = true;
+                                    f.begin = f.end = pos;
+                                    while(format[pos]) {
+                                        if(format[pos]==quote) {
+                                            if(format[pos+1]==quote) {
+                                                pos+=2;
+                                                f.end = pos;
+                                            }
+                                            else {
+                                                pos++;
+                                                break;
+                                            }
+                                        }
+                                        else {
+                                            pos++;
+                                            f.end = pos;
+                                        }
+                                    }
+                                }
+                                else {
+                                    CharType c;
+                                    while((c=format[pos])!=0 && c!=comma && c!=cbrk) {
+                                        f.value+=static_cast<char>(c);
+                                        pos++;
+                                    }
+                                }
+                            }
+
+                            f.key = format_parser::key_code(key);
+                            if(f.quoted) {
+                                // only ftime takes a quoted value
+                                if(f.key == format_parser::ftime_key)
+                                    flags.push_back(f);
+                            }
+                            else if(f.key == format_parser::position_key)
+                                it.position = atoi(key.c_str()) - 1;
+                            else if(f.key != format_parser::unknown_key)
+                                flags.push_back(f);
+
+                            if(format[pos]==comma) {
+                                pos++;
+                                continue;
+                            }
+                            else if(format[pos]==cbrk)  {
+                                closed = true;
+                                pos++;
+                            }
+                            break;
+                        }
+
+                        // a placeholder that is not closed produces no output
+                        if(closed) {
+                            it.end = flags.size();
+                            items.push_back(it);
+                        }
+                        else
+                            flags.resize(it.begin);
+                    }
+                    return result.release();
                 }
 
+                //
+                // Cache of compiled format strings of a single thread, so the lookup takes no locks and the
+                // compiled formats it returns are not shared with other threads. It is a set associative
+                // cache: a format may be kept in one of the ways of the set selected by its hash, and
+                // the least recently used way is replaced when the set is full.
+                //
+                template<typename CharType>
+                class format_cache {
+                public:
+                    typedef std::basic_string<CharType> string_type;
+                    typedef std::char_traits<CharType> traits_type;
+
+                    format_cache() :
+                        clock_(0)
+                    {
+                        for(size_t i=0;i<sets * ways;i++) {
+                            entries_[i].hash = 0;
+                            entries_[i].last_use = 0;
+                        }
+                    }
+
+                    shared_ptr<compiled_format const> get(CharType const *begin,CharType const *end)
+                    {
+                        size_t size = end - begin;
+                        boost::uint32_t hash = format_hash(begin,end);
+                        entry *set = entries_ + (hash % sets) * ways;
+                        entry *victim = set;
+                        clock_++;
+                        for(size_t i=0;i<ways;i++) {
+                            entry &e = set[i];
+                            if( e.compiled && e.hash == hash && e.format.size() == size
+                                && traits_type::compare(e.format.data(),begin,size) == 0)
+                            {
+                                e.last_use = clock_;
+                                return e.compiled;
+                            }
+                            if(e.last_use < victim->last_use)
+                                victim = &e;
+                        }
+                        shared_ptr<compiled_format const> result(compile(begin,end));
+                        victim->hash = hash;
+                        victim->format.assign(begin,end);
+                        victim->compiled = result;
+                        victim->last_use = clock_;
+                        return result;
+                    }
+                private:
+                    static size_t const sets = 64;
+                    static size_t const ways = 4;
+
+                    struct entry {
+                        boost::uint32_t hash;
+                        boost::uint64_t last_use;
+                        string_type format;
+                        shared_ptr<compiled_format const> compiled;
+                    };
+
+                    static boost::uint32_t format_hash(CharType const *begin,CharType const *end)
+                    {
+                        // FNV-1a
+                        boost::uint32_t hash = 2166136261U;
+                        for(;begin!=end;++begin) {
+                            hash ^= static_cast<boost::uint32_t>(*begin);
+                            hash *= 16777619U;
+                        }
+                        return hash;
+                    }
+
+                    boost::uint64_t clock_;
+                    entry entries_[sets * ways];
+                };
+
+                template<typename CharType>
+                boost::thread_specific_ptr<format_cache<CharType> > &get_format_caches()
+                {
+                    static boost::thread_specific_ptr<format_cache<CharType> > the_caches;
+                    return the_caches;
+                }
+
+                struct format_cache_init {
+                    format_cache_init()
+                    {
+                        get_format_caches<char>();
+                        get_format_caches<wchar_t>();
+                        #ifdef BOOST_HAS_CHAR16_T
+                        get_format_caches<char16_t>();
+                        #endif
+                        #ifdef BOOST_HAS_CHAR32_T
+                        get_format_caches<char32_t>();
+                        #endif
+                    }
+                } do_format_cache_init;
+
+                template<typename CharType>
+                format_cache<CharType> &get_format_cache()
+                {
+                    boost::thread_specific_ptr<format_cache<CharType> > &caches = get_format_caches<CharType>();
+                    format_cache<CharType> *cache = caches.get();
+                    if(!cache) {
+                        cache = new format_cache<CharType>();
+                        caches.reset(cache);
+                    }
+                    return *cache;
+                }
+
+                template<typename CharType>
+                boost::thread_specific_ptr<format_stream<CharType> > &get_format_streams()
+                {
+                    static boost::thread_specific_ptr<format_stream<CharType> > the_streams;
+                    return the_streams;
+                }
+
+                struct format_streams_init {
+                    format_streams_init()
+                    {
+                        get_format_streams<char>();
+                        get_format_streams<wchar_t>();
+                        #ifdef BOOST_HAS_CHAR16_T
+                        get_format_streams<char16_t>();
+                        #endif
+                        #ifdef BOOST_HAS_CHAR32_T
+                        get_format_streams<char32_t>();
+                        #endif
+                    }
+                } do_format_streams_init;
+
+                template<typename CharType>
+                format_stream<CharType> *acquire_thread_format_stream()
+                {
+                    boost::thread_specific_ptr<format_stream<CharType> > &streams = get_format_streams<CharType>();
+                    format_stream<CharType> *stream = streams.get();
+                    if(!stream) {
+                        stream = new format_stream<CharType>();
+                        streams.reset(stream);
+                    }
+                    if(!stream->acquire())
+                        return 0;
+                    return stream;
+                }
+
+            } // anon
+
+            template<>
+            BOOST_LOCALE_DECL format_stream<char> *acquire_format_stream()
+            {
+                return acquire_thread_format_stream<char>();
+            }
+
+            template<>
+            BOOST_LOCALE_DECL format_stream<wchar_t> *acquire_format_stream()
+            {
+                return acquire_thread_format_stream<wchar_t>();
+            }
+
+            #ifdef BOOST_HAS_CHAR16_T
+            template<>
+            BOOST_LOCALE_DECL format_stream<char16_t> *acquire_format_stream()
+            {
+                return acquire_thread_format_stream<char16_t>();
+            }
+            #endif
+
+            #ifdef BOOST_HAS_CHAR32_T
+            template<>
+            BOOST_LOCALE_DECL format_stream<char32_t> *acquire_format_stream()
+            {
+                return acquire_thread_format_stream<char32_t>();
+            }
+            #endif
+
+            template<>
+            BOOST_LOCALE_DECL shared_ptr<compiled_format const> compile_format(char const *begin,char const *end)
+            {
+                return get_format_cache<char>().get(begin,end);
+            }
+
+            template<>
+            BOOST_LOCALE_DECL shared_ptr<compiled_format const> compile_format(wchar_t const *begin,wchar_t const *end)
+            {
+                return get_format_cache<wchar_t>().get(begin,end);
+            }
+
+            #ifdef BOOST_HAS_CHAR16_T
+            template<>
+            BOOST_LOCALE_DECL shared_ptr<compiled_format const> compile_format(char16_t const *begin,char16_t const *end)
+            {
+                return get_format_cache<char16_t>().get(begin,end);
+            }
+            #endif
+
+            #ifdef BOOST_HAS_CHAR32_T
+            template<>
+            BOOST_LOCALE_DECL shared_ptr<compiled_format const> compile_format(char32_t const *begin,char32_t const *end)
+            {
+                return get_format_cache<char32_t>().get(begin,end);
             }
+            #endif
         }
     }
 }
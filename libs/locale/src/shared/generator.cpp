@@ -9,6 +9,7 @@
 #include <boost/locale/generator.hpp>
 #include <boost/locale/encoding.hpp>
 #include <boost/locale/localization_backend.hpp>
+#include <boost/locale/gnu_gettext.hpp>
 #include <map>
 #include <vector>
 #include <algorithm>
@@ -96,6 +97,18 @@ namespace boost {
         {
             d->domains.clear();
         }
+
+        int generator::messages_domain_id(std::string const &domain) const
+        {
+            // the domains are passed to the messages facet in this order and numbered from 0,
+            // the facet keeps the last one of the domains with the same name
+            std::string name = gnu_gettext::messages_info::domain(domain).name;
+            for(size_t i=d->domains.size();i>0;i--) {
+                if(gnu_gettext::messages_info::domain(d->domains[i-1]).name == name)
+                    return static_cast<int>(i-1);
+            }
+            return -1;
+        }
         void generator::add_messages_path(std::string const &path)
         {
             d->paths.push_back(path);
@@ -107,6 +120,7 @@ namespace boost {
         void generator::clear_cache()
         {
             d->cached.clear();
+            gnu_gettext::clear_catalog_search_cache();
         }
 
         std::locale generator::generate(std::string const &id) const
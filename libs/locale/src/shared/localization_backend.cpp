@@ -10,6 +10,7 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/thread/mutex.hpp>
 #include <vector>
+#include "backend_version.hpp"
 
 #ifdef BOOST_LOCALE_WITH_ICU
 #include "../icu/icu_backend.hpp"
@@ -213,6 +214,7 @@ namespace boost {
                 static localization_backend_manager the_manager;
                 return the_manager;
             }
+            unsigned localization_backend_manager_version;
 
             struct init {
                 init() { 
@@ -254,9 +256,18 @@ namespace boost {
             boost::unique_lock<boost::mutex> lock(localization_backend_manager_mutex());
             localization_backend_manager mgr = localization_backend_manager_global();
             localization_backend_manager_global() = in;
+            localization_backend_manager_version++;
             return mgr;
         }
 
+        namespace impl {
+            unsigned global_backend_manager_version()
+            {
+                boost::unique_lock<boost::mutex> lock(localization_backend_manager_mutex());
+                return localization_backend_manager_version;
+            }
+        }
+
 
 
     } // locale
@@ -10,35 +10,99 @@
 #include <boost/locale/message.hpp>
 #include <boost/locale/gnu_gettext.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/function.hpp>
+#include <boost/scoped_array.hpp>
+#include <boost/atomic.hpp>
 #include <boost/locale/encoding.hpp>
 #ifdef BOOST_MSVC
 #  pragma warning(disable : 4996)
 #endif
 
-
-#if BOOST_VERSION >= 103600
-#define BOOST_LOCALE_UNORDERED_CATALOG
-#endif
-
-#ifdef BOOST_LOCALE_UNORDERED_CATALOG
-#include <boost/unordered_map.hpp>
-#else
-#include <map>
-#endif
-
 #include <iostream>
+#include <algorithm>
+#include <map>
+#include <set>
+#include <list>
+#include <sstream>
+#include <typeinfo>
 
 
 #include "mo_hash.hpp"
 #include "mo_lambda.hpp"
+#include "mo_compiled.hpp"
+#include "mo_filter.hpp"
 
 #include <stdio.h>
 
 #include <string.h>
 
+#if defined(BOOST_WINDOWS)
+#  ifndef NOMINMAX
+#    define NOMINMAX
+#  endif
+#  include <windows.h>
+#else
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#  include <sys/mman.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <dirent.h>
+#  include <errno.h>
+#  if defined(__APPLE__)
+#    define BOOST_LOCALE_STAT_NSEC(st,time) ((st).st_##time##timespec.tv_nsec)
+#  elif defined(st_mtime) // defined through st_mtim that has nanoseconds
+#    define BOOST_LOCALE_STAT_NSEC(st,time) ((st).st_##time##tim.tv_nsec)
+#  else
+#    define BOOST_LOCALE_STAT_NSEC(st,time) 0
+#  endif
+#endif
+
+#if defined(__GNUC__)
+#  define BOOST_LOCALE_PREFETCH(ptr) __builtin_prefetch(ptr)
+#else
+#  define BOOST_LOCALE_PREFETCH(ptr) ((void)0)
+#endif
+
+#ifndef BOOST_LOCALE_NO_CATALOG_STATISTICS
+#  define BOOST_LOCALE_CATALOG_STATISTICS
+#endif
+
+#if !defined(BOOST_WINDOWS)
+#  include <time.h>
+#  include <sys/time.h>
+#endif
+
 namespace boost {
     namespace locale {
         namespace gnu_gettext {
+
+            //
+            // Monotonic time in microseconds, used to measure the conversions of catalogs and the age of
+            // the catalogs replaced by reloads
+            //
+            inline boost::uint64_t monotonic_clock()
+            {
+                #if defined(BOOST_WINDOWS)
+                LARGE_INTEGER frequency,counter;
+                QueryPerformanceFrequency(&frequency);
+                QueryPerformanceCounter(&counter);
+                boost::uint64_t f = frequency.QuadPart,c = counter.QuadPart;
+                return c / f * 1000000 + c % f * 1000000 / f;
+                #elif defined(CLOCK_MONOTONIC)
+                timespec ts;
+                clock_gettime(CLOCK_MONOTONIC,&ts);
+                return boost::uint64_t(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+                #else
+                timeval tv;
+                gettimeofday(&tv,0);
+                return boost::uint64_t(tv.tv_sec) * 1000000 + tv.tv_usec;
+                #endif
+            }
             
             class c_file {
                 c_file(c_file const &);
@@ -101,6 +165,124 @@ namespace boost {
 
             };
 
+            ///
+            /// Read-only memory mapping of a catalog file, so it is served directly from the page
+            /// cache and shared between all processes that use it.
+            ///
+            class mmap_file {
+                mmap_file(mmap_file const &);
+                void operator=(mmap_file const &);
+            public:
+                
+                char const *data;
+                size_t size;
+
+                mmap_file() :
+                    data(0),
+                    size(0)
+                    #if defined(BOOST_WINDOWS)
+                    ,mapping_(0)
+                    #endif
+                {
+                }
+                ~mmap_file()
+                {
+                    close();
+                }
+
+                #if defined(BOOST_WINDOWS)
+
+                void close()
+                {
+                    if(data) {
+                        UnmapViewOfFile(data);
+                        data = 0;
+                        size = 0;
+                    }
+                    if(mapping_) {
+                        CloseHandle(mapping_);
+                        mapping_ = 0;
+                    }
+                }
+
+                bool open(std::string const &file_name,std::string const &encoding)
+                {
+                    close();
+
+                    std::wstring wfile_name = conv::to_utf<wchar_t>(file_name,encoding);
+                    // FILE_SHARE_DELETE lets a new version of the file be renamed over the mapped one
+                    HANDLE h = CreateFileW( wfile_name.c_str(),
+                                            GENERIC_READ,
+                                            FILE_SHARE_READ | FILE_SHARE_DELETE,
+                                            0,
+                                            OPEN_EXISTING,
+                                            FILE_ATTRIBUTE_NORMAL,
+                                            0);
+                    if(h == INVALID_HANDLE_VALUE)
+                        return false;
+                    LARGE_INTEGER len;
+                    if(!GetFileSizeEx(h,&len) || len.QuadPart < 4 || len.QuadPart > 0x7FFFFFFF) {
+                        CloseHandle(h);
+                        throw std::runtime_error("invalid 'mo' file format - the file is too short or too long");
+                    }
+                    mapping_ = CreateFileMappingW(h,0,PAGE_READONLY,0,0,0);
+                    CloseHandle(h);
+                    if(!mapping_)
+                        throw std::runtime_error("Failed to map file");
+                    data = static_cast<char const *>(MapViewOfFile(mapping_,FILE_MAP_READ,0,0,0));
+                    if(!data) {
+                        close();
+                        throw std::runtime_error("Failed to map file");
+                    }
+                    size = static_cast<size_t>(len.QuadPart);
+                    return true;
+                }
+
+            private:
+                HANDLE mapping_;
+                
+                #else
+
+                void close()
+                {
+                    if(data) {
+                        munmap(const_cast<char *>(data),size);
+                        data = 0;
+                        size = 0;
+                    }
+                }
+
+                // We do not use encoding as we use native file name encoding
+                
+                bool open(std::string const &file_name,std::string const &/* encoding */)
+                {
+                    close();
+
+                    int fd = ::open(file_name.c_str(),O_RDONLY);
+                    if(fd < 0)
+                        return false;
+                    struct stat st;
+                    if(fstat(fd,&st) < 0 || !S_ISREG(st.st_mode)) {
+                        ::close(fd);
+                        return false;
+                    }
+                    if(st.st_size < 4 || st.st_size > 0x7FFFFFFF) {
+                        ::close(fd);
+                        throw std::runtime_error("invalid 'mo' file format - the file is too short or too long");
+                    }
+                    void *ptr = mmap(0,st.st_size,PROT_READ,MAP_SHARED,fd,0);
+                    ::close(fd); // the mapping keeps the file referenced
+                    if(ptr == MAP_FAILED)
+                        throw std::runtime_error("Failed to map file");
+                    data = static_cast<char const *>(ptr);
+                    size = st.st_size;
+                    return true;
+                }
+
+                #endif
+
+            };
+
             class mo_file {
             public:
                 typedef std::pair<char const *,char const *> pair_type;
@@ -121,20 +303,75 @@ namespace boost {
                     init();
                 }
 
+                mo_file(catalog_region const &region) :
+                    native_byteorder_(true),
+                    size_(0)
+                {
+                    load_file(region);
+                    init();
+                }
+
                 pair_type find(char const *context_in,char const *key_in) const
                 {
-                    pair_type null_pair((char const *)0,(char const *)0);
-                    if(hash_size_==0)
-                        return null_pair;
-                    uint32_t hkey = 0;
+                    return find(context_in,key_in,key_hash(context_in,key_in));
+                }
+
+                ///
+                /// Find the key using its hash \a hkey that was computed in advance
+                ///
+                pair_type find(char const *context_in,char const *key_in,uint32_t hkey) const
+                {
+                    int idx = find_index(context_in,key_in,hkey);
+                    if(idx < 0)
+                        return pair_type((char const *)0,(char const *)0);
+                    return value(idx);
+                }
+
+                static uint32_t key_hash(char const *context_in,char const *key_in)
+                {
                     if(context_in == 0)
-                        hkey = pj_winberger_hash_function(key_in);
-                    else {
-                        pj_winberger_hash::state_type st = pj_winberger_hash::initial_state;
-                        st = pj_winberger_hash::update_state(st,context_in);
-                        st = pj_winberger_hash::update_state(st,'\4'); // EOT
-                        st = pj_winberger_hash::update_state(st,key_in);
-                        hkey = st; 
+                        return pj_winberger_hash_function(key_in);
+                    pj_winberger_hash::state_type st = pj_winberger_hash::initial_state;
+                    st = pj_winberger_hash::update_state(st,context_in);
+                    st = pj_winberger_hash::update_state(st,'\4'); // EOT
+                    st = pj_winberger_hash::update_state(st,key_in);
+                    return st;
+                }
+
+                ///
+                /// Hint that the key with hash \a hkey is going to be looked up soon
+                ///
+                void prefetch(uint32_t hkey) const
+                {
+                    if(hash_size_ != 0)
+                        BOOST_LOCALE_PREFETCH(data_ + hash_offset_ + 4*(hkey % hash_size_));
+                    else if(!side_index_.empty())
+                        BOOST_LOCALE_PREFETCH(&side_index_[hkey & (side_index_.size() - 1)]);
+                }
+
+                ///
+                /// Find the index of the entry for given key, returns -1 if not found
+                ///
+                int find_index(char const *context_in,char const *key_in) const
+                {
+                    return find_index(context_in,key_in,key_hash(context_in,key_in));
+                }
+
+                int find_index(char const *context_in,char const *key_in,uint32_t hkey) const
+                {
+                    if(!filter_.may_contain(hkey))
+                        return -1;
+                    if(hash_size_==0) {
+                        if(side_index_.empty())
+                            return -1;
+                        size_t mask = side_index_.size() - 1;
+                        for(size_t pos = hkey & mask;;pos = (pos + 1) & mask) {
+                            uint32_t idx = side_index_[pos];
+                            if(idx == 0)
+                                return -1;
+                            if(key_equals(key(idx-1),context_in,key_in))
+                                return idx-1;
+                        }
                     }
                     uint32_t incr = 1 + hkey % (hash_size_-2);
                     hkey %= hash_size_;
@@ -145,14 +382,14 @@ namespace boost {
                         uint32_t idx = get(hash_offset_ + 4*hkey);
                         /// Not found
                         if(idx == 0)
-                            return null_pair;
+                            return -1;
                         /// If equal values return translation
                         if(key_equals(key(idx-1),context_in,key_in))
-                            return value(idx-1);
+                            return idx-1;
                         /// Rehash
                         hkey=(hkey + incr) % hash_size_;
                     } while(hkey!=orig);
-                    return null_pair;
+                    return -1;
                 }
 
                 static bool key_equals(char const *real_key,char const *cntx,char const *key)
@@ -175,9 +412,20 @@ namespace boost {
                 char const *key(int id) const
                 {
                     uint32_t off = get(keys_offset_ + id*8 + 4);
+                    if(off >= file_size_)
+                        throw std::runtime_error("Bad mo-file format");
                     return data_ + off;
                 }
 
+                pair_type key_range(int id) const
+                {
+                    uint32_t len = get(keys_offset_ + id*8);
+                    uint32_t off = get(keys_offset_ + id*8 + 4);
+                    if(off >= file_size_ || off + len >= file_size_)
+                        throw std::runtime_error("Bad mo-file format");
+                    return pair_type(&data_[off],&data_[off]+len);
+                }
+
                 pair_type value(int id) const
                 {
                     uint32_t len = get(translations_offset_ + id*8);
@@ -187,6 +435,10 @@ namespace boost {
                     return pair_type(&data_[off],&data_[off]+len);
                 }
 
+                ///
+                /// Check if the file has its own hash table, otherwise the lookup uses an index created when
+                /// the file is loaded
+                ///
                 bool has_hash() const
                 {
                     return hash_size_ != 0;
@@ -202,6 +454,19 @@ namespace boost {
                     return size_ == 0;
                 }
 
+                size_t file_size() const
+                {
+                    return file_size_;
+                }
+
+                ///
+                /// Memory allocated for the index of files without a hash table and for the filter
+                ///
+                size_t index_memory() const
+                {
+                    return side_index_.size() * sizeof(uint32_t) + filter_.memory();
+                }
+
             private:
                 void init()
                 {
@@ -211,6 +476,51 @@ namespace boost {
                     translations_offset_=get(16);
                     hash_size_=get(20);
                     hash_offset_=get(24);
+                    if(hash_size_ <= 2) {
+                        hash_size_ = 0;
+                        build_side_index();
+                    }
+                    build_filter();
+                }
+
+                //
+                // Most lookups are for messages that are not translated, the filter rejects them
+                // without walking the probe sequence and comparing the keys
+                //
+                void build_filter()
+                {
+                    if(size_ == 0)
+                        return;
+                    filter_.reset(size_);
+                    for(unsigned i=0;i<size_;i++)
+                        filter_.add(pj_winberger_hash_function(key(i)));
+                }
+
+                //
+                // Files created without a hash table (msgfmt --no-hash or other tools)
+                // get a compact open addressing index over entry numbers, so they can be
+                // used directly like any other file
+                //
+                void build_side_index()
+                {
+                    if(size_ == 0)
+                        return;
+                    size_t table_size = 1;
+                    while(table_size < size_ * 2)
+                        table_size <<= 1;
+                    std::vector<uint32_t>(table_size,0).swap(side_index_);
+                    size_t mask = table_size - 1;
+                    for(unsigned i=0;i<size_;i++) {
+                        char const *k = key(i);
+                        size_t pos = pj_winberger_hash_function(k) & mask;
+                        while(side_index_[pos] != 0) {
+                            if(strcmp(key(side_index_[pos]-1),k) == 0)
+                                break; // keep the first one
+                            pos = (pos + 1) & mask;
+                        }
+                        if(side_index_[pos] == 0)
+                            side_index_[pos] = i + 1;
+                    }
                 }
 
                 void load_file(std::vector<char> &data)
@@ -218,6 +528,19 @@ namespace boost {
                     vdata_.swap(data);
                     file_size_ = vdata_.size();
                     data_ = &vdata_[0];
+                    check_magic();
+                }
+
+                void load_file(catalog_region const &region)
+                {
+                    holder_ = region.holder;
+                    data_ = region.begin;
+                    file_size_ = region.end - region.begin;
+                    check_magic();
+                }
+
+                void check_magic()
+                {
                     if(file_size_ < 4 )
                         throw std::runtime_error("invalid 'mo' file format - the file is too short");
                     uint32_t magic=0;
@@ -287,6 +610,9 @@ namespace boost {
                 char const *data_;
                 size_t file_size_;
                 std::vector<char> vdata_;
+                std::vector<uint32_t> side_index_;
+                key_filter filter_;
+                boost::shared_ptr<void> holder_;
                 bool native_byteorder_;
                 size_t size_;
             };
@@ -300,6 +626,10 @@ namespace boost {
                 {
                     return pair_type((char_type const *)(0),(char_type const *)(0));
                 }
+                static pair_type use(mo_file const &/*mo*/,char_type const * /*context*/,char_type const * /*key*/,uint32_t /*hash*/)
+                {
+                    return pair_type((char_type const *)(0),(char_type const *)(0));
+                }
             };
             
             template<>
@@ -311,6 +641,10 @@ namespace boost {
                 {
                     return mo.find(context,key);
                 }
+                static pair_type use(mo_file const &mo,char const *context,char const *key,uint32_t hash)
+                {
+                    return mo.find(context,key,hash);
+                }
             };
 
             template<typename CharType>
@@ -321,7 +655,7 @@ namespace boost {
                 {
                 }
 
-                std::basic_string<CharType> operator()(char const *begin,char const *end)
+                std::basic_string<CharType> operator()(char const *begin,char const *end) const
                 {
                     return conv::to_utf<CharType>(begin,end,in_,conv::stop);
                 }
@@ -339,7 +673,7 @@ namespace boost {
                 {
                 }
 
-                std::string operator()(char const *begin,char const *end)
+                std::string operator()(char const *begin,char const *end) const
                 {
                     return conv::between(begin,end,out_,in_,conv::stop);
                 }
@@ -348,205 +682,1316 @@ namespace boost {
                 std::string out_,in_;
             };
 
-            template<typename CharType>
-            struct message_key {
-                typedef CharType char_type;
-                typedef std::basic_string<char_type> string_type;
-
+            ///
+            /// Storage of a lookup key converted to the encoding of the mo file, short keys
+            /// are kept in place so converting them does not allocate memory
+            ///
+            class key_buffer {
+                key_buffer(key_buffer const &);
+                void operator=(key_buffer const &);
+            public:
+                key_buffer()
+                {
+                }
 
-                message_key(string_type const &c = string_type()) :
-                    c_context_(0),
-                    c_key_(0)
+                template<typename CharType>
+                char const *assign_ascii(CharType const *begin,CharType const *end)
                 {
-                    size_t pos = c.find(char_type(4));
-                    if(pos == string_type::npos) {
-                        key_ = c;
+                    size_t len = end - begin;
+                    char *out = 0;
+                    if(len < sizeof(small_)) {
+                        out = small_;
                     }
                     else {
-                        context_ = c.substr(0,pos);
-                        key_ = c.substr(pos+1);
+                        large_.resize(len + 1);
+                        out = &large_[0];
                     }
+                    for(size_t i=0;i<len;i++)
+                        out[i] = static_cast<char>(begin[i]);
+                    out[len] = 0;
+                    return out;
                 }
-                message_key(char_type const *c,char_type const *k) :
-                    c_key_(k)
-                {
-                    static const char_type empty = 0;
-                    if(c!=0)
-                        c_context_ = c;
-                    else
-                        c_context_ = &empty; 
-                }
-                bool operator < (message_key const &other) const
-                {
-                    int cc = compare(context(),other.context());
-                    if(cc != 0)
-                        return cc < 0;
-                    return compare(key(),other.key()) < 0;
-                }
-                bool operator==(message_key const &other) const
+
+                char const *assign(std::string &converted)
                 {
-                    return compare(context(),other.context()) == 0
-                            && compare(key(),other.key())==0;
+                    large_.swap(converted);
+                    return large_.c_str();
                 }
-                bool operator!=(message_key const &other) const
+
+            private:
+                char small_[128];
+                std::string large_;
+            };
+
+            ///
+            /// Converts the keys used for lookup to the encoding of the mo file, so they
+            /// can be searched in it without converting the catalog
+            ///
+            template<typename CharType>
+            class key_converter {
+            public:
+                key_converter(std::string mo_enc,std::string /*key_enc*/) :
+                    mo_(mo_enc)
                 {
-                    return !(*this==other);
                 }
-                char_type const *context() const
+
+                ///
+                /// Returns the converted key or NULL if it can't be represented in the mo file encoding
+                ///
+                /// \a transcoded is set to true if code units of the result differ from the original
+                ///
+                char const *operator()(CharType const *key,key_buffer &buffer,bool &transcoded) const
                 {
-                    if(c_context_)
-                        return c_context_;
-                    return context_.c_str();
+                    CharType const *p = key;
+                    while(0 < *p && *p < 0x7F)
+                        p++;
+                    if(*p == 0) {
+                        transcoded = false;
+                        return buffer.assign_ascii(key,p); // US-ASCII is same in all encodings
+                    }
+                    transcoded = true;
+                    try {
+                        std::string converted = conv::from_utf<CharType>(key,mo_,conv::stop);
+                        return buffer.assign(converted);
+                    }
+                    catch(conv::conversion_error const &) {
+                        return 0;
+                    }
                 }
-                char_type const *key() const
+
+            private:
+                std::string mo_;
+            };
+
+            template<>
+            class key_converter<char> {
+            public:
+                key_converter(std::string mo_enc,std::string key_enc) :
+                    mo_(mo_enc),
+                    key_(key_enc)
                 {
-                    if(c_key_)
-                        return c_key_;
-                    return key_.c_str();
                 }
-            private:
-                static int compare(char_type const *l,char_type const *r)
+
+                char const *operator()(char const *key,key_buffer &buffer,bool &transcoded) const
                 {
-                    typedef std::char_traits<char_type> traits_type;
-                    for(;;) {
-                        char_type cl = *l++;
-                        char_type cr = *r++;
-                        if(cl == 0 && cr == 0)
-                            return 0;
-                        if(traits_type::lt(cl,cr))
-                            return -1;
-                        if(traits_type::lt(cr,cl))
-                            return 1;
+                    transcoded = false;
+                    if(details::is_us_ascii_string(key))
+                        return key;
+                    transcoded = true;
+                    try {
+                        std::string converted = conv::between(key,mo_,key_,conv::stop);
+                        return buffer.assign(converted);
+                    }
+                    catch(conv::conversion_error const &) {
+                        return 0;
                     }
                 }
-                string_type context_;
-                string_type key_;
-                char_type const *c_context_;
-                char_type const *c_key_;
-            };
 
-            template<typename CharType>
-            struct hash_function {
-                size_t operator()(message_key<CharType> const &msg) const
-                {
-                    pj_winberger_hash::state_type state = pj_winberger_hash::initial_state;
-                    CharType const *p = msg.context();
-                    if(*p != 0) {
-                        CharType const *e = p;
-                        while(*e)
-                            e++;
-                        state = pj_winberger_hash::update_state(state,
-                                    static_cast<char const *>(p),
-                                    static_cast<char const *>(e));
-                        state = pj_winberger_hash::update_state(state,'\4');
-                    }
-                    p = msg.key();
-                    CharType const *e = p;
-                    while(*e)
-                        e++;
-                    state = pj_winberger_hash::update_state(state,
-                                static_cast<char const *>(p),
-                                static_cast<char const *>(e));
-                    return state;
-                }
+            private:
+                std::string mo_,key_;
             };
-            
-           
-            // By default for wide types the conversion is not requiredyy
+
+            ///
+            /// Immutable catalog used when the mo file can't be used directly: all keys and values
+            /// are stored in a single arena and indexed by a flat open addressing hash table,
+            /// so the whole catalog takes two memory blocks regardless of its size
+            ///
             template<typename CharType>
-            CharType const *runtime_conversion(CharType const *msg,
-                                                std::basic_string<CharType> &/*buffer*/,
-                                                bool /*do_conversion*/,
-                                                std::string const &/*locale_encoding*/,
-                                                std::string const &/*key_encoding*/)
-            {
-                return msg;
-            }
+            class flat_catalog {
+            public:
+                typedef CharType char_type;
+                typedef std::pair<char_type const *,char_type const *> pair_type;
 
-            // But still need to specialize for char
-            template<>
-            char const *runtime_conversion( char const *msg,
-                                            std::string &buffer,
-                                            bool do_conversion,
-                                            std::string const &locale_encoding,
-                                            std::string const &key_encoding)
-            {
-                if(!do_conversion)
-                    return msg;
-                if(details::is_us_ascii_string(msg))
-                    return msg;
-                std::string tmp = conv::between(msg,locale_encoding,key_encoding,conv::skip);
-                buffer.swap(tmp);
-                return buffer.c_str();
-            }
+                flat_catalog() :
+                    mask_(0),
+                    size_(0)
+                {
+                }
 
-            template<typename CharType>
-            class mo_message : public message_format<CharType> {
+                ///
+                /// Number of entries, valid after build()
+                ///
+                size_t size() const
+                {
+                    return size_;
+                }
 
-                typedef CharType char_type;
-                typedef std::basic_string<CharType> string_type;
-                typedef message_key<CharType> key_type;
-                #ifdef BOOST_LOCALE_UNORDERED_CATALOG
-                typedef boost::unordered_map<key_type,string_type,hash_function<CharType> > catalog_type;
-                #else
-                typedef std::map<key_type,string_type> catalog_type;
-                #endif
-                typedef std::vector<catalog_type> catalogs_set_type;
-                typedef std::map<std::string,int> domains_map_type;
-            public:
+                size_t index_memory() const
+                {
+                    return index_.size() * sizeof(entry) + filter_.memory();
+                }
 
-                typedef std::pair<CharType const *,CharType const *> pair_type;
+                size_t strings_memory() const
+                {
+                    return arena_.size() * sizeof(char_type);
+                }
 
-                virtual char_type const *get(int domain_id,char_type const *context,char_type const *id) const
+                ///
+                /// Add a key - context and id separated by EOT - and its value to the catalog,
+                /// if the key already exists the value is replaced. build() should be called
+                /// once all entries are added.
+                ///
+                void add(   char_type const *key_begin,char_type const *key_end,
+                            char_type const *value_begin,char_type const *value_end)
                 {
-                    return get_string(domain_id,context,id).first;
+                    // Empty context is same as no context
+                    if(key_begin != key_end && *key_begin == 4)
+                        key_begin++;
+                    entry e;
+                    e.hash = pj_winberger_hash::update_units(pj_winberger_hash::initial_state,key_begin,key_end);
+                    e.key = append(key_begin,key_end);
+                    e.value = append(value_begin,value_end);
+                    e.value_size = static_cast<uint32_t>(value_end - value_begin);
+                    index_.push_back(e);
                 }
 
-                virtual char_type const *get(int domain_id,char_type const *context,char_type const *single_id,int n) const
+                ///
+                /// Create the hash index over added entries, the table is kept at most half full
+                ///
+                void build()
                 {
-                    pair_type ptr = get_string(domain_id,context,single_id);
-                    if(!ptr.first)
-                        return 0;
-                    int form=0;
-                    if(plural_forms_.at(domain_id)) 
-                        form = (*plural_forms_[domain_id])(n);
-                    else
-                        form = n == 1 ? 0 : 1; // Fallback to english plural form
+                    std::vector<char_type>(arena_).swap(arena_); // release reserved memory
+                    std::vector<entry> entries;
+                    entries.swap(index_);
+                    size_t table_size = 1;
+                    while(table_size < entries.size() * 2)
+                        table_size <<= 1;
+                    entry empty = entry();
+                    empty.key = empty_slot;
+                    std::vector<entry>(table_size,empty).swap(index_);
+                    mask_ = table_size - 1;
+                    for(size_t i=0;i<entries.size();i++) {
+                        entry const &e = entries[i];
+                        size_t pos = e.hash & mask_;
+                        while(index_[pos].key != empty_slot) {
+                            if(index_[pos].hash == e.hash && key_equals(&arena_[index_[pos].key],&arena_[e.key]))
+                                break;
+                            pos = (pos + 1) & mask_;
+                        }
+                        index_[pos] = e;
+                    }
+                    filter_.reset(entries.size());
+                    for(size_t i=0;i<entries.size();i++)
+                        filter_.add(entries[i].hash);
+                    size_ = entries.size();
+                }
 
-                    CharType const *p=ptr.first;
-                    for(int i=0;p < ptr.second && i<form;i++) {
-                        p=std::find(p,ptr.second,0);
-                        if(p==ptr.second)
-                            return 0;
-                        ++p;
+                static uint32_t key_hash(char_type const *context,char_type const *key)
+                {
+                    pj_winberger_hash::state_type hkey = pj_winberger_hash::initial_state;
+                    if(context && *context) {
+                        hkey = pj_winberger_hash::update_units(hkey,context);
+                        hkey = pj_winberger_hash::update_unit(hkey,char_type(4)); // EOT
                     }
-                    if(p>=ptr.second)
-                        return 0;
-                    return p;
+                    return pj_winberger_hash::update_units(hkey,key);
                 }
 
-                virtual int domain(std::string const &domain) const
+                ///
+                /// Hint that the key with hash \a hkey is going to be looked up soon
+                ///
+                void prefetch(uint32_t hkey) const
                 {
-                    domains_map_type::const_iterator p=domains_.find(domain);
-                    if(p==domains_.end())
-                        return -1;
-                    return p->second;
+                    if(!index_.empty())
+                        BOOST_LOCALE_PREFETCH(&index_[hkey & mask_]);
                 }
 
-                mo_message(messages_info const &inf)
+                pair_type find(char_type const *context,char_type const *key) const
                 {
-                    std::string language = inf.language;
-                    std::string variant = inf.variant;
-                    std::string country = inf.country;
+                    return find(context,key,key_hash(context,key));
+                }
+
+                pair_type find(char_type const *context,char_type const *key,uint32_t hkey) const
+                {
+                    pair_type null_pair((char_type const *)0,(char_type const *)0);
+                    if(index_.empty() || !filter_.may_contain(hkey))
+                        return null_pair;
+                    if(context && *context == 0)
+                        context = 0;
+                    for(size_t pos = hkey & mask_;;pos = (pos + 1) & mask_) {
+                        entry const &e = index_[pos];
+                        if(e.key == empty_slot)
+                            return null_pair;
+                        if(e.hash == hkey && key_equals(&arena_[e.key],context,key)) {
+                            char_type const *value = &arena_[e.value];
+                            return pair_type(value,value + e.value_size);
+                        }
+                    }
+                }
+
+            private:
+                static const uint32_t empty_slot = 0xFFFFFFFFU;
+
+                struct entry {
+                    uint32_t hash;
+                    uint32_t key;
+                    uint32_t value;
+                    uint32_t value_size;
+                };
+
+                uint32_t append(char_type const *begin,char_type const *end)
+                {
+                    size_t offset = arena_.size();
+                    if(offset + (end - begin) + 1 >= empty_slot)
+                        throw std::runtime_error("Message catalog is too big");
+                    arena_.insert(arena_.end(),begin,end);
+                    arena_.push_back(0);
+                    return static_cast<uint32_t>(offset);
+                }
+
+                static bool key_equals(char_type const *left,char_type const *right)
+                {
+                    typedef std::char_traits<char_type> traits_type;
+                    size_t len = traits_type::length(left);
+                    return len == traits_type::length(right) && traits_type::compare(left,right,len) == 0;
+                }
+
+                static bool key_equals(char_type const *real_key,char_type const *cntx,char_type const *key)
+                {
+                    typedef std::char_traits<char_type> traits_type;
+                    if(cntx == 0)
+                        return key_equals(real_key,key);
+                    size_t real_len = traits_type::length(real_key);
+                    size_t cntx_len = traits_type::length(cntx);
+                    size_t key_len = traits_type::length(key);
+                    if(cntx_len + 1 + key_len != real_len)
+                        return false;
+                    return 
+                        traits_type::compare(real_key,cntx,cntx_len) == 0
+                        && real_key[cntx_len] == 4
+                        && traits_type::compare(real_key + cntx_len + 1 ,key,key_len) == 0;
+                }
+
+                std::vector<char_type> arena_;
+                std::vector<entry> index_;
+                key_filter filter_;
+                size_t mask_;
+                size_t size_;
+            };
+
+            ///
+            /// Catalog that keeps the original mo file and converts translations to the
+            /// target encoding only when they are requested for the first time. Converted
+            /// strings are never modified or released while the catalog is alive, so the
+            /// readers need only a single atomic load to find them.
+            ///
+            template<typename CharType>
+            class lazy_catalog {
+                lazy_catalog(lazy_catalog const &);
+                void operator=(lazy_catalog const &);
+            public:
+                typedef CharType char_type;
+                typedef std::basic_string<CharType> string_type;
+                typedef std::pair<char_type const *,char_type const *> pair_type;
+
+                lazy_catalog(   boost::shared_ptr<mo_file> const &mo,
+                                std::string const &locale_encoding,
+                                std::string const &key_encoding,
+                                std::string const &mo_encoding) :
+                    mo_(mo),
+                    cvt_value_(locale_encoding,mo_encoding),
+                    cvt_key_(mo_encoding,key_encoding),
+                    cache_(new boost::atomic<string_type *>[mo->size()])
+                {
+                    for(size_t i=0;i<mo_->size();i++)
+                        cache_[i].store(0,boost::memory_order_relaxed);
+                    #ifdef BOOST_LOCALE_CATALOG_STATISTICS
+                    conversions_.store(0,boost::memory_order_relaxed);
+                    converted_memory_.store(0,boost::memory_order_relaxed);
+                    conversion_time_.store(0,boost::memory_order_relaxed);
+                    failed_keys_.store(0,boost::memory_order_relaxed);
+                    #endif
+                }
+
+                ~lazy_catalog()
+                {
+                    for(size_t i=0;i<mo_->size();i++)
+                        delete cache_[i].load(boost::memory_order_relaxed);
+                }
+
+                pair_type find(char_type const *context,char_type const *key) const
+                {
+                    return find(context,key,false,0);
+                }
+
+                pair_type find(char_type const *context,char_type const *key,uint32_t hkey) const
+                {
+                    return find(context,key,true,hkey);
+                }
+
+                void prefetch(uint32_t hkey) const
+                {
+                    mo_->prefetch(hkey);
+                }
+
+                mo_file const &mo() const
+                {
+                    return *mo_;
+                }
+
+                size_t index_memory() const
+                {
+                    return mo_->index_memory() + mo_->size() * sizeof(cache_[0]);
+                }
+
+                #ifdef BOOST_LOCALE_CATALOG_STATISTICS
+                boost::uint64_t conversions() const
+                {
+                    return conversions_.load(boost::memory_order_relaxed);
+                }
+                size_t converted_memory() const
+                {
+                    return converted_memory_.load(boost::memory_order_relaxed);
+                }
+                boost::uint64_t conversion_time() const
+                {
+                    return conversion_time_.load(boost::memory_order_relaxed);
+                }
+                boost::uint64_t failed_keys() const
+                {
+                    return failed_keys_.load(boost::memory_order_relaxed);
+                }
+                #endif
+
+            private:
+                pair_type find(char_type const *context,char_type const *key,bool has_hash,uint32_t hkey) const
+                {
+                    pair_type null_pair((char_type const *)0,(char_type const *)0);
+                    key_buffer context_buffer,id_buffer;
+                    bool context_transcoded = false,key_transcoded = false;
+                    char const *mo_context = 0;
+                    if(context && *context) {
+                        mo_context = cvt_key_(context,context_buffer,context_transcoded);
+                        if(!mo_context) {
+                            count_failed_key();
+                            return null_pair;
+                        }
+                    }
+                    char const *mo_key = cvt_key_(key,id_buffer,key_transcoded);
+                    if(!mo_key) {
+                        count_failed_key();
+                        return null_pair;
+                    }
+                    // the hash is valid only if the key is same in the mo file encoding
+                    if(!has_hash || context_transcoded || key_transcoded)
+                        hkey = mo_file::key_hash(mo_context,mo_key);
+                    int idx = mo_->find_index(mo_context,mo_key,hkey);
+                    if(idx < 0)
+                        return null_pair;
+                    string_type const *value = translation(idx);
+                    if(!value)
+                        return null_pair;
+                    return pair_type(value->data(),value->data() + value->size());
+                }
+
+                //
+                // The key can't be represented in the encoding of the mo file, so it can't be
+                // in the catalog, the lookup is a miss but it is reported by the statistics
+                //
+                void count_failed_key() const
+                {
+                    #ifdef BOOST_LOCALE_CATALOG_STATISTICS
+                    failed_keys_.fetch_add(1,boost::memory_order_relaxed);
+                    #endif
+                }
+
+                string_type const *translation(int idx) const
+                {
+                    string_type *value = cache_[idx].load(boost::memory_order_acquire);
+                    if(value)
+                        return value;
+                    mo_file::pair_type raw = mo_->value(idx);
+                    std::auto_ptr<string_type> converted;
+                    #ifdef BOOST_LOCALE_CATALOG_STATISTICS
+                    boost::uint64_t start = monotonic_clock();
+                    #endif
+                    try {
+                        converted.reset(new string_type(cvt_value_(raw.first,raw.second)));
+                    }
+                    catch(conv::conversion_error const &) {
+                        return 0; // untranslatable, fall back to the original string
+                    }
+                    #ifdef BOOST_LOCALE_CATALOG_STATISTICS
+                    conversion_time_.fetch_add(monotonic_clock() - start,boost::memory_order_relaxed);
+                    #endif
+                    string_type *expected = 0;
+                    if(cache_[idx].compare_exchange_strong(expected,converted.get(),boost::memory_order_acq_rel)) {
+                        #ifdef BOOST_LOCALE_CATALOG_STATISTICS
+                        conversions_.fetch_add(1,boost::memory_order_relaxed);
+                        converted_memory_.fetch_add(sizeof(string_type) + (converted->size() + 1) * sizeof(char_type),boost::memory_order_relaxed);
+                        #endif
+                        return converted.release();
+                    }
+                    // other thread was faster
+                    return expected;
+                }
+
+                boost::shared_ptr<mo_file> mo_;
+                converter<CharType> cvt_value_;
+                key_converter<CharType> cvt_key_;
+                boost::scoped_array<boost::atomic<string_type *> > cache_;
+                #ifdef BOOST_LOCALE_CATALOG_STATISTICS
+                mutable boost::atomic<boost::uint64_t> conversions_;
+                mutable boost::atomic<size_t> converted_memory_;
+                mutable boost::atomic<boost::uint64_t> conversion_time_;
+                mutable boost::atomic<boost::uint64_t> failed_keys_;
+                #endif
+            };
+
+            ///
+            /// Catalog created by the compile_catalog tool, see mo_compiled.hpp. It is used in place,
+            /// the translations for every character type are ready in the file and each key is found
+            /// with a single probe.
+            ///
+            template<typename CharType>
+            class compiled_catalog {
+                compiled_catalog(compiled_catalog const &);
+                void operator=(compiled_catalog const &);
+            public:
+                typedef CharType char_type;
+                typedef std::pair<char_type const *,char_type const *> pair_type;
+
+                compiled_catalog(catalog_region const &region) :
+                    holder_(region.holder)
+                {
+                    char const *data = region.begin;
+                    size_t size = region.end - region.begin;
+                    if(reinterpret_cast<size_t>(data) % 4 != 0) {
+                        // the words must be aligned
+                        boost::shared_ptr<std::vector<uint32_t> > copy(new std::vector<uint32_t>(size / 4 + 1));
+                        memcpy(&(*copy)[0],data,size);
+                        data = reinterpret_cast<char const *>(&(*copy)[0]);
+                        holder_ = copy;
+                    }
+                    init(data,size);
+                    file_size_ = size;
+                }
+
+                size_t size() const
+                {
+                    return count_;
+                }
+
+                size_t file_size() const
+                {
+                    return file_size_;
+                }
+
+                pair_type find(char_type const *context,char_type const *id) const
+                {
+                    pair_type null_pair((char_type const *)0,(char_type const *)0);
+                    if(count_ == 0)
+                        return null_pair;
+                    if(context && *context == 0)
+                        context = 0;
+                    compiled::key_hasher h;
+                    if(!compiled::hash_key(context,id,h))
+                        return null_pair;
+                    int32_t d = buckets_[h.bucket(buckets_size_)];
+                    uint32_t slot = d < 0 ? uint32_t(-(d + 1)) : h.slot(d,count_);
+                    if(slot >= count_)
+                        return null_pair;
+                    compiled::entry const &e = entries_[slot];
+                    if( e.key >= strings_size_ || strings_size_ - e.key <= e.key_size
+                        || e.value >= strings_size_ || strings_size_ - e.value <= e.value_size)
+                    {
+                        return null_pair;
+                    }
+                    if(!key_equals(strings_ + e.key,e.key_size,context,id))
+                        return null_pair;
+                    return pair_type(strings_ + e.value,strings_ + e.value + e.value_size);
+                }
+
+                std::string plural_forms() const
+                {
+                    return plural_;
+                }
+
+                bool ascii_keys() const
+                {
+                    return (flags_ & compiled::flag_ascii_keys) != 0;
+                }
+
+            private:
+
+                void init(char const *data,size_t size)
+                {
+                    compiled::file_header hdr;
+                    if(size < sizeof(hdr))
+                        throw std::runtime_error("Bad compiled catalog format");
+                    memcpy(&hdr,data,sizeof(hdr));
+                    if(hdr.magic != compiled::file_magic) {
+                        if(hdr.magic == swap(compiled::file_magic))
+                            throw std::runtime_error("Compiled catalog was created for different byte order");
+                        throw std::runtime_error("Bad compiled catalog format");
+                    }
+                    if(hdr.version != compiled::file_version)
+                        throw std::runtime_error("Unsupported compiled catalog version");
+                    if(hdr.size != size || hdr.buckets == 0 || hdr.buckets_offset % 4 != 0 || !in_range(size,hdr.buckets_offset,hdr.buckets,4))
+                        throw std::runtime_error("Bad compiled catalog format");
+                    if(hdr.plural_offset >= size || !memchr(data + hdr.plural_offset,0,size - hdr.plural_offset))
+                        throw std::runtime_error("Bad compiled catalog format");
+
+                    int const unit = sizeof(char_type);
+                    compiled::section_header sec;
+                    uint32_t sec_offset = hdr.sections[compiled::section_index<sizeof(char_type)>::value];
+                    if(!in_range(size,sec_offset,1,sizeof(sec)))
+                        throw std::runtime_error("Bad compiled catalog format");
+                    memcpy(&sec,data + sec_offset,sizeof(sec));
+                    if( !in_range(size,sec.entries_offset,hdr.count,sizeof(compiled::entry))
+                        || sec.strings_size == 0
+                        || !in_range(size,sec.strings_offset,sec.strings_size,unit)
+                        || sec.entries_offset % 4 != 0 || sec.strings_offset % unit != 0)
+                    {
+                        throw std::runtime_error("Bad compiled catalog format");
+                    }
+
+                    flags_ = hdr.flags;
+                    count_ = hdr.count;
+                    buckets_size_ = hdr.buckets;
+                    buckets_ = reinterpret_cast<int32_t const *>(data + hdr.buckets_offset);
+                    plural_ = data + hdr.plural_offset;
+                    entries_ = reinterpret_cast<compiled::entry const *>(data + sec.entries_offset);
+                    strings_ = reinterpret_cast<char_type const *>(data + sec.strings_offset);
+                    strings_size_ = sec.strings_size;
+                    // all strings are terminated
+                    if(strings_[strings_size_ - 1] != 0)
+                        throw std::runtime_error("Bad compiled catalog format");
+                }
+
+                static bool in_range(size_t size,uint32_t offset,uint32_t n,size_t item_size)
+                {
+                    return offset <= size && (size - offset) / item_size >= n;
+                }
+
+                static uint32_t swap(uint32_t v)
+                {
+                    return ((v & 0xFF) << 24) | ((v & 0xFF00) << 8) | ((v & 0xFF0000) >> 8) | ((v & 0xFF000000) >> 24);
+                }
+
+                static bool key_equals(char_type const *real_key,uint32_t real_size,char_type const *context,char_type const *id)
+                {
+                    typedef std::char_traits<char_type> traits_type;
+                    size_t id_size = traits_type::length(id);
+                    if(!context)
+                        return id_size == real_size && traits_type::compare(real_key,id,id_size) == 0;
+                    size_t context_size = traits_type::length(context);
+                    return 
+                        context_size + 1 + id_size == real_size
+                        && traits_type::compare(real_key,context,context_size) == 0
+                        && real_key[context_size] == 4
+                        && traits_type::compare(real_key + context_size + 1,id,id_size) == 0;
+                }
+
+                boost::shared_ptr<void> holder_;
+                uint32_t flags_;
+                uint32_t count_;
+                uint32_t buckets_size_;
+                int32_t const *buckets_;
+                std::string plural_;
+                compiled::entry const *entries_;
+                char_type const *strings_;
+                uint32_t strings_size_;
+                size_t file_size_;
+            };
+
+            namespace {
+
+                ///
+                /// Get a string that uniquely identifies the current version of the file \a file_name,
+                /// returns false if the file does not exist.
+                ///
+                #if defined(BOOST_WINDOWS)
+                bool file_identity(std::string const &file_name,std::string const &encoding,std::string &identity)
+                {
+                    std::wstring wfile_name = conv::to_utf<wchar_t>(file_name,encoding);
+                    WIN32_FILE_ATTRIBUTE_DATA attr;
+                    if(!GetFileAttributesExW(wfile_name.c_str(),GetFileExInfoStandard,&attr))
+                        return false;
+                    if(attr.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+                        return false;
+                    std::ostringstream ss;
+                    ss  << attr.ftLastWriteTime.dwHighDateTime << ':' << attr.ftLastWriteTime.dwLowDateTime << ':'
+                        << attr.nFileSizeHigh << ':' << attr.nFileSizeLow << ':' << file_name;
+                    identity = ss.str();
+                    return true;
+                }
+                #else
+                bool file_identity(std::string const &file_name,std::string const &/*encoding*/,std::string &identity)
+                {
+                    struct stat st;
+                    if(stat(file_name.c_str(),&st) < 0 || !S_ISREG(st.st_mode))
+                        return false;
+                    // device and inode already identify the file regardless of the path used to reach it, the
+                    // change time catches edits within the same modification time tick that keep the size
+                    std::ostringstream ss;
+                    ss  << st.st_dev << ':' << st.st_ino << ':' << st.st_size << ':'
+                        << st.st_mtime << '.' << BOOST_LOCALE_STAT_NSEC(st,m) << ':'
+                        << st.st_ctime << '.' << BOOST_LOCALE_STAT_NSEC(st,c);
+                    identity = ss.str();
+                    return true;
+                }
+                #endif
+
+                //
+                // Process-wide registry of loaded catalogs, so all mo_message objects created
+                // for the same file, encodings and character type share a single copy.
+                // It holds only weak references, so catalogs are released together with the
+                // last facet that uses them.
+                //
+                typedef std::map<std::string,boost::weak_ptr<void> > catalog_registry_type;
+
+                // prevent initialization order fiasco
+                boost::mutex &catalog_registry_mutex()
+                {
+                    static boost::mutex the_mutex;
+                    return the_mutex;
+                }
+                // prevent initialization order fiasco
+                catalog_registry_type &catalog_registry()
+                {
+                    static catalog_registry_type the_registry;
+                    return the_registry;
+                }
+
+                struct catalog_registry_init {
+                    catalog_registry_init()
+                    {
+                        catalog_registry_mutex();
+                        catalog_registry();
+                    }
+                } do_catalog_registry_init;
+
+                boost::shared_ptr<void> find_shared_catalog(std::string const &key)
+                {
+                    boost::unique_lock<boost::mutex> guard(catalog_registry_mutex());
+                    catalog_registry_type::const_iterator p = catalog_registry().find(key);
+                    if(p == catalog_registry().end())
+                        return boost::shared_ptr<void>();
+                    return p->second.lock();
+                }
+
+                //
+                // Register catalog \a cat under \a key. If other thread was faster returns its catalog
+                // instead so the duplicate can be discarded.
+                //
+                boost::shared_ptr<void> share_catalog(std::string const &key,boost::shared_ptr<void> const &cat)
+                {
+                    boost::unique_lock<boost::mutex> guard(catalog_registry_mutex());
+                    catalog_registry_type &reg = catalog_registry();
+                    for(catalog_registry_type::iterator p = reg.begin();p!=reg.end();) {
+                        if(p->second.expired())
+                            reg.erase(p++);
+                        else
+                            ++p;
+                    }
+                    boost::shared_ptr<void> existing = reg[key].lock();
+                    if(existing)
+                        return existing;
+                    reg[key] = cat;
+                    return cat;
+                }
+
+                //
+                // Process-wide cache of the names of the files in the directories catalogs are searched in,
+                // so each directory is listed once instead of trying to open every possible catalog in it.
+                // A null entry means that the directory can't be listed and its files should be tried.
+                //
+                typedef boost::shared_ptr<std::set<std::string> const> directory_entries_type;
+                typedef std::map<std::string,directory_entries_type> directory_cache_type;
+
+                // prevent initialization order fiasco
+                boost::mutex &directory_cache_mutex()
+                {
+                    static boost::mutex the_mutex;
+                    return the_mutex;
+                }
+                // prevent initialization order fiasco
+                directory_cache_type &directory_cache()
+                {
+                    static directory_cache_type the_cache;
+                    return the_cache;
+                }
+
+                struct directory_cache_init {
+                    directory_cache_init()
+                    {
+                        directory_cache_mutex();
+                        directory_cache();
+                    }
+                } do_directory_cache_init;
+
+                #if defined(BOOST_WINDOWS)
+                //
+                // File names are not case sensitive, so they are kept in lower case UTF-8
+                //
+                std::string directory_entry_name(std::wstring name)
+                {
+                    if(!name.empty())
+                        CharLowerBuffW(&name[0],static_cast<DWORD>(name.size()));
+                    return conv::from_utf(name,"UTF-8");
+                }
+
+                directory_entries_type list_directory(std::string const &dir,std::string const &encoding)
+                {
+                    boost::shared_ptr<std::set<std::string> > entries(new std::set<std::string>());
+                    std::wstring pattern = conv::to_utf<wchar_t>(dir,encoding) + L"\\*";
+                    WIN32_FIND_DATAW data;
+                    HANDLE h = FindFirstFileW(pattern.c_str(),&data);
+                    if(h == INVALID_HANDLE_VALUE) {
+                        DWORD err = GetLastError();
+                        if(err == ERROR_FILE_NOT_FOUND || err == ERROR_PATH_NOT_FOUND)
+                            return entries;
+                        return directory_entries_type();
+                    }
+                    do {
+                        entries->insert(directory_entry_name(data.cFileName));
+                    } while(FindNextFileW(h,&data));
+                    FindClose(h);
+                    return entries;
+                }
+                #else
+                directory_entries_type list_directory(std::string const &dir,std::string const &/*encoding*/)
+                {
+                    boost::shared_ptr<std::set<std::string> > entries(new std::set<std::string>());
+                    DIR *d = opendir(dir.c_str());
+                    if(!d) {
+                        if(errno == ENOENT || errno == ENOTDIR)
+                            return entries;
+                        return directory_entries_type();
+                    }
+                    while(struct dirent *e = readdir(d))
+                        entries->insert(e->d_name);
+                    closedir(d);
+                    return entries;
+                }
+                #endif
+
+                //
+                // Returns false if the file \a file_name certainly does not exist
+                //
+                bool catalog_file_may_exist(std::string const &file_name,std::string const &encoding)
+                {
+                    size_t pos = file_name.rfind('/');
+                    std::string dir = pos == std::string::npos ? std::string(".") : file_name.substr(0,pos);
+                    std::string name = pos == std::string::npos ? file_name : file_name.substr(pos + 1);
+                    directory_entries_type entries;
+                    {
+                        boost::unique_lock<boost::mutex> guard(directory_cache_mutex());
+                        directory_cache_type::const_iterator p = directory_cache().find(dir);
+                        if(p != directory_cache().end()) {
+                            entries = p->second;
+                            if(!entries)
+                                return true;
+                        }
+                    }
+                    if(!entries) {
+                        entries = list_directory(dir,encoding);
+                        boost::unique_lock<boost::mutex> guard(directory_cache_mutex());
+                        directory_cache()[dir] = entries;
+                        if(!entries)
+                            return true;
+                    }
+                    #if defined(BOOST_WINDOWS)
+                    return entries->count(directory_entry_name(conv::to_utf<wchar_t>(name,encoding))) != 0;
+                    #else
+                    return entries->count(name) != 0;
+                    #endif
+                }
+
+                //
+                // Threads that load catalogs of different domains concurrently, shared by all facets. A worker
+                // that has nothing to do for idle_seconds exits, so the threads exist only while locales are
+                // generated, and the remaining ones are joined when the library is unloaded.
+                //
+                class loader_pool {
+                    loader_pool(loader_pool const &);
+                    void operator=(loader_pool const &);
+                public:
+                    typedef boost::function<void()> task_type;
+
+                    loader_pool() :
+                        workers_(0),
+                        stop_(false)
+                    {
+                    }
+
+                    ~loader_pool()
+                    {
+                        {
+                            boost::unique_lock<boost::mutex> guard(lock_);
+                            stop_ = true;
+                        }
+                        ready_.notify_all();
+                        for(size_t i=0;i<threads_.size();i++)
+                            threads_[i]->join();
+                    }
+
+                    //
+                    // Run \a task in the calling thread and in up to \a helpers pool threads at once and wait
+                    // for all of them. The copies that no pool thread took before the calling thread finished
+                    // are dropped, so the task should complete the whole work in any number of threads.
+                    //
+                    void run(task_type const &task,unsigned helpers)
+                    {
+                        unsigned running = 0;
+                        {
+                            boost::unique_lock<boost::mutex> guard(lock_);
+                            join_exited();
+                            try {
+                                for(;workers_ < helpers;workers_++) {
+                                    thread_ptr worker(new boost::thread(&loader_pool::work,this));
+                                    threads_.push_back(worker);
+                                }
+                            }
+                            catch(std::exception const &) {
+                                // fewer helpers, the task is completed anyway
+                            }
+                            for(unsigned i=0;i<helpers;i++)
+                                queue_.push_back(job(task,&running));
+                        }
+                        ready_.notify_all();
+                        task();
+                        boost::unique_lock<boost::mutex> guard(lock_);
+                        for(std::list<job>::iterator p = queue_.begin();p!=queue_.end();) {
+                            if(p->running == &running)
+                                p = queue_.erase(p);
+                            else
+                                ++p;
+                        }
+                        while(running > 0)
+                            done_.wait(guard);
+                    }
+
+                private:
+                    typedef boost::shared_ptr<boost::thread> thread_ptr;
+
+                    static int const idle_seconds = 2;
+
+                    struct job {
+                        job(task_type const &t,unsigned *r) : task(t),running(r) {}
+                        task_type task;
+                        unsigned *running;  ///< the number of copies of the task being run by the pool
+                    };
+
+                    void work()
+                    {
+                        boost::unique_lock<boost::mutex> guard(lock_);
+                        for(;;) {
+                            while(queue_.empty() && !stop_) {
+                                if(!ready_.timed_wait(guard,boost::posix_time::seconds(idle_seconds)) && queue_.empty())
+                                    break;
+                            }
+                            if(queue_.empty() || stop_)
+                                break;
+                            job j = queue_.front();
+                            queue_.pop_front();
+                            ++*j.running;
+                            guard.unlock();
+                            try {
+                                j.task();
+                            }
+                            catch(...) {
+                            }
+                            guard.lock();
+                            --*j.running;
+                            done_.notify_all();
+                        }
+                        workers_--;
+                        exited_.push_back(boost::this_thread::get_id());
+                    }
+
+                    //
+                    // Join the workers that exited, called with lock_ held: they do not take it again
+                    //
+                    void join_exited()
+                    {
+                        for(size_t i=0;i<exited_.size();i++) {
+                            for(size_t j=0;j<threads_.size();j++) {
+                                if(threads_[j]->get_id() == exited_[i]) {
+                                    threads_[j]->join();
+                                    threads_.erase(threads_.begin() + j);
+                                    break;
+                                }
+                            }
+                        }
+                        exited_.clear();
+                    }
+
+                    boost::mutex lock_;
+                    boost::condition_variable ready_;
+                    boost::condition_variable done_;
+                    std::list<job> queue_;
+                    std::vector<thread_ptr> threads_;           ///< the workers, including exited ones not joined yet
+                    std::vector<boost::thread::id> exited_;     ///< the workers that exited
+                    unsigned workers_;                          ///< the number of workers that did not exit
+                    bool stop_;
+                };
+
+                // prevent initialization order fiasco
+                loader_pool &catalog_loader_pool()
+                {
+                    static loader_pool the_pool;
+                    return the_pool;
+                }
+
+                struct loader_pool_init {
+                    loader_pool_init()
+                    {
+                        catalog_loader_pool();
+                    }
+                } do_loader_pool_init;
+
+                //
+                // Forget the contents of the directories \a dirs, so they are listed again
+                //
+                void forget_catalog_directories(std::vector<std::string> const &dirs)
+                {
+                    boost::unique_lock<boost::mutex> guard(directory_cache_mutex());
+                    for(size_t i=0;i<dirs.size();i++)
+                        directory_cache().erase(dirs[i]);
+                }
+            } // anon
+
+            void clear_catalog_search_cache()
+            {
+                boost::unique_lock<boost::mutex> guard(directory_cache_mutex());
+                directory_cache().clear();
+            }
+
+            struct catalog_watcher::data {
+                data(std::locale const &l,unsigned ms) :
+                    loc(l),
+                    interval_ms(ms),
+                    stop(false),
+                    thread(&data::run,this)
+                {
+                }
+
+                template<typename CharType>
+                void reload()
+                {
+                    if(!std::has_facet<message_format<CharType> >(loc))
+                        return;
+                    try {
+                        std::use_facet<message_format<CharType> >(loc).reload();
+                    }
+                    catch(std::exception const &) {
+                        // keep the catalogs in use
+                    }
+                }
+
+                void run()
+                {
+                    boost::unique_lock<boost::mutex> guard(lock);
+                    boost::system_time next = boost::get_system_time() + boost::posix_time::milliseconds(interval_ms);
+                    while(!stop) {
+                        if(cond.timed_wait(guard,next))
+                            continue;
+                        guard.unlock();
+                        reload<char>();
+                        reload<wchar_t>();
+                        #ifdef BOOST_HAS_CHAR16_T
+                        reload<char16_t>();
+                        #endif
+                        #ifdef BOOST_HAS_CHAR32_T
+                        reload<char32_t>();
+                        #endif
+                        guard.lock();
+                        next = boost::get_system_time() + boost::posix_time::milliseconds(interval_ms);
+                    }
+                }
+
+                std::locale loc;
+                unsigned interval_ms;
+                bool stop;
+                boost::mutex lock;
+                boost::condition_variable cond;
+                boost::thread thread;
+            };
+
+            catalog_watcher::catalog_watcher(std::locale const &loc,unsigned interval_ms) :
+                d(new data(loc,interval_ms))
+            {
+            }
+
+            catalog_watcher::~catalog_watcher()
+            {
+                {
+                    boost::unique_lock<boost::mutex> guard(d->lock);
+                    d->stop = true;
+                }
+                d->cond.notify_all();
+                d->thread.join();
+            }
+
+            ///
+            /// All the information loaded for a single domain, it is immutable once loaded
+            /// and may be shared between many mo_message objects.
+            ///
+            template<typename CharType>
+            struct domain_catalog {
+                typedef CharType char_type;
+                typedef flat_catalog<CharType> catalog_type;
+
+                domain_catalog() :
+                    conversion_time(0),
+                    source_digest(0),
+                    source_size(0)
+                {
+                }
+
+                ///
+                /// Check if both catalogs were given by a callback as the same bytes
+                ///
+                bool same_source(domain_catalog const &other) const
+                {
+                    return source_size != 0 && source_size == other.source_size && source_digest == other.source_digest;
+                }
+
+                boost::shared_ptr<mo_file> mo;                  ///< used directly if not null
+                boost::shared_ptr<lazy_catalog<CharType> > lazy;///< converted on demand if not null
+                catalog_type catalog;                           ///< converted catalog otherwise
+                lambda::plural plural_forms;                    ///< empty if not specified or not valid
+                boost::shared_ptr<compiled_catalog<CharType> > compiled; ///< used instead of all others if not null
+                boost::uint64_t conversion_time;                ///< microseconds spent converting the catalog when loaded
+                boost::uint64_t source_digest;                  ///< digest of the bytes given by a callback
+                size_t source_size;                             ///< the number of bytes given by a callback, 0 for files
+            };
+
+            //
+            // 64 bit FNV-1a digest of the bytes of a catalog, used to find callback catalogs that did not change
+            //
+            inline boost::uint64_t catalog_digest(char const *begin,char const *end)
+            {
+                boost::uint64_t hash = 14695981039346656037ULL;
+                for(;begin!=end;++begin) {
+                    hash ^= static_cast<unsigned char>(*begin);
+                    hash *= 1099511628211ULL;
+                }
+                return hash;
+            }
+
+            // By default for wide types the conversion is not requiredyy
+            template<typename CharType>
+            CharType const *runtime_conversion(CharType const *msg,
+                                                std::basic_string<CharType> &/*buffer*/,
+                                                bool /*do_conversion*/,
+                                                std::string const &/*locale_encoding*/,
+                                                std::string const &/*key_encoding*/)
+            {
+                return msg;
+            }
+
+            // But still need to specialize for char
+            template<>
+            char const *runtime_conversion( char const *msg,
+                                            std::string &buffer,
+                                            bool do_conversion,
+                                            std::string const &locale_encoding,
+                                            std::string const &key_encoding)
+            {
+                if(!do_conversion)
+                    return msg;
+                if(details::is_us_ascii_string(msg))
+                    return msg;
+                std::string tmp = conv::between(msg,locale_encoding,key_encoding,conv::skip);
+                buffer.swap(tmp);
+                return buffer.c_str();
+            }
+
+            template<typename CharType>
+            class mo_message : public message_format<CharType> {
+
+                typedef CharType char_type;
+                typedef std::basic_string<CharType> string_type;
+                typedef domain_catalog<CharType> domain_catalog_type;
+                typedef typename domain_catalog_type::catalog_type catalog_type;
+                typedef boost::shared_ptr<domain_catalog_type const> catalog_ptr_type;
+                typedef std::vector<catalog_ptr_type> catalogs_set_type;
+                typedef std::map<std::string,int> domains_map_type;
+            public:
+
+                typedef std::pair<CharType const *,CharType const *> pair_type;
+
+                virtual char_type const *get(int domain_id,char_type const *context,char_type const *id) const
+                {
+                    return get_string(domain_id,context,id,false,0).first;
+                }
+
+                virtual char_type const *get(int domain_id,char_type const *context,char_type const *single_id,int n) const
+                {
+                    domain_catalog_type const *dcat = catalog(domain_id);
+                    return get_plural(get_string(domain_id,dcat,context,single_id,false,0),dcat,n);
+                }
+
+                virtual char_type const *get(int domain_id,char_type const *context,char_type const *id,message_key_hash hash) const
+                {
+                    return get_string(domain_id,context,id,true,hash.value).first;
+                }
+
+                virtual char_type const *get(int domain_id,char_type const *context,char_type const *single_id,int n,message_key_hash hash) const
+                {
+                    domain_catalog_type const *dcat = catalog(domain_id);
+                    return get_plural(get_string(domain_id,dcat,context,single_id,true,hash.value),dcat,n);
+                }
+
+                virtual void get_batch( int domain_id,
+                                        basic_message_request<char_type> const *requests,
+                                        size_t count,
+                                        char_type const **translations) const
+                {
+                    domain_catalog_type const *dcat_ptr = catalog(domain_id);
+                    if(!dcat_ptr) {
+                        std::fill(translations,translations + count,static_cast<char_type const *>(0));
+                        return;
+                    }
+                    domain_catalog_type const &dcat = *dcat_ptr;
+                    // hash a group of keys and prefetch their slots before probing any of them
+                    static const size_t group_size = 16;
+                    uint32_t hashes[group_size];
+                    for(size_t start = 0;start < count;start += group_size) {
+                        size_t size = std::min(group_size,count - start);
+                        basic_message_request<char_type> const *group = requests + start;
+                        for(size_t i=0;i<size;i++) {
+                            basic_message_request<char_type> const &r = group[i];
+                            hashes[i] = r.has_hash ? r.hash : catalog_type::key_hash(r.context,r.id);
+                            prefetch(dcat,hashes[i]);
+                        }
+                        for(size_t i=0;i<size;i++) {
+                            basic_message_request<char_type> const &r = group[i];
+                            pair_type ptr = get_string(dcat,r.context,r.id,true,hashes[i]);
+                            count_lookup(domain_id,ptr.first != 0);
+                            translations[start + i] = r.plural ? get_plural(ptr,dcat,r.n) : ptr.first;
+                        }
+                    }
+                }
+
+                virtual pair_type get_range(int domain_id,basic_message_request<char_type> const &r) const
+                {
+                    domain_catalog_type const *dcat = catalog(domain_id);
+                    pair_type ptr = get_string(domain_id,dcat,r.context,r.id,r.has_hash,r.hash);
+                    if(!ptr.first)
+                        return ptr;
+                    if(r.plural)
+                        return get_plural_range(ptr,*dcat,r.n);
+                    // a message without plural forms is the first form of the entry
+                    return pair_type(ptr.first,form_end(ptr.first,ptr.second));
+                }
+
+                #ifdef BOOST_LOCALE_CATALOG_STATISTICS
+
+                virtual bool statistics(int domain_id,message_lookup_statistics &stats) const
+                {
+                    if(!counters_ || !catalog(domain_id))
+                        return false;
+                    stats.hits = counters_[domain_id].hits.load(boost::memory_order_relaxed);
+                    stats.misses = counters_[domain_id].misses.load(boost::memory_order_relaxed);
+                    return true;
+                }
+
+                virtual bool statistics(int domain_id,message_catalog_statistics &stats) const
+                {
+                    domain_catalog_type const *dcat = catalog(domain_id);
+                    if(!dcat)
+                        return false;
+                    stats = message_catalog_statistics();
+                    stats.storage = message_catalog_statistics::no_catalog;
+                    stats.conversion_time = dcat->conversion_time;
+                    if(dcat->compiled) {
+                        stats.storage = message_catalog_statistics::compiled;
+                        stats.entries = dcat->compiled->size();
+                        stats.file_bytes = dcat->compiled->file_size();
+                    }
+                    else if(mo_file_use_traits<char_type>::in_use && dcat->mo) {
+                        stats.storage = message_catalog_statistics::mo_file;
+                        stats.entries = dcat->mo->size();
+                        stats.file_bytes = dcat->mo->file_size();
+                        stats.index_bytes = dcat->mo->index_memory();
+                    }
+                    else if(dcat->lazy) {
+                        stats.storage = message_catalog_statistics::converted_on_demand;
+                        stats.entries = dcat->lazy->mo().size();
+                        stats.file_bytes = dcat->lazy->mo().file_size();
+                        stats.index_bytes = dcat->lazy->index_memory();
+                        stats.converted_bytes = dcat->lazy->converted_memory();
+                        stats.conversions = dcat->lazy->conversions();
+                        stats.conversion_time += dcat->lazy->conversion_time();
+                        stats.failed_key_conversions = dcat->lazy->failed_keys();
+                    }
+                    else if(dcat != empty_catalog_.get()) {
+                        stats.storage = message_catalog_statistics::converted;
+                        stats.entries = dcat->catalog.size();
+                        stats.index_bytes = dcat->catalog.index_memory();
+                        stats.converted_bytes = dcat->catalog.strings_memory();
+                    }
+                    if(counters_) {
+                        stats.lookups.hits = counters_[domain_id].hits.load(boost::memory_order_relaxed);
+                        stats.lookups.misses = counters_[domain_id].misses.load(boost::memory_order_relaxed);
+                    }
+                    return true;
+                }
+
+                #endif
+
+                virtual unsigned generation() const
+                {
+                    return generation_.load(boost::memory_order_acquire);
+                }
+
+                virtual bool reload() const
+                {
+                    // custom file systems provide no version of the files
+                    if((info_.callback || info_.mapped_callback) && !info_.reload_callback_catalogs)
+                        return false;
+                    boost::unique_lock<boost::mutex> guard(reload_lock_);
+                    release_retired_sets();
+                    // all the replaced sets may still be in use, the change is picked up by a later call
+                    if(retired_.size() >= max_retired_sets)
+                        return false;
+                    // new files may appear in the directories this facet searches
+                    forget_catalog_directories(directories_);
+                    boost::shared_ptr<catalogs_set_type> fresh(new catalogs_set_type(info_.domains.size()));
+                    load_domains(*fresh);
+                    // unchanged files are found in the registry of shared catalogs, unchanged callback
+                    // catalogs are recognized by their bytes
+                    catalogs_set_type const &current = *current_;
+                    for(size_t id=0;id<fresh->size();id++) {
+                        if((*fresh)[id] != current[id] && (*fresh)[id]->same_source(*current[id]))
+                            (*fresh)[id] = current[id];
+                    }
+                    if(*fresh == current)
+                        return false;
+                    retired_set retired = { current_, monotonic_clock() };
+                    retired_.push_back(retired);
+                    current_ = fresh;
+                    catalogs_.store(fresh.get(),boost::memory_order_release);
+                    generation_.fetch_add(1,boost::memory_order_acq_rel);
+                    return true;
+                }
+
+                virtual int domain(std::string const &domain) const
+                {
+                    domains_map_type::const_iterator p=domains_.find(domain);
+                    if(p==domains_.end())
+                        return -1;
+                    return p->second;
+                }
+
+                mo_message(messages_info const &inf) :
+                    info_(inf),
+                    empty_catalog_(new domain_catalog_type()),
+                    generation_(0)
+                {
+                    std::string language = inf.language;
+                    std::string variant = inf.variant;
+                    std::string country = inf.country;
                     std::string encoding = inf.encoding;
-                    std::string lc_cat = inf.locale_category;
                     std::vector<messages_info::domain> const &domains = inf.domains;
-                    std::vector<std::string> const &search_paths = inf.paths;
                     
                     //
                     // List of fallbacks: en_US@euro, en@euro, en_US, en. 
                     //
-                    std::vector<std::string> paths;
+                    std::vector<std::string> &paths = paths_;
 
 
                     if(!variant.empty() && !country.empty()) 
@@ -560,25 +2005,31 @@ namespace boost {
 
                     paths.push_back(language);
 
-                    catalogs_.resize(domains.size());
-                    mo_catalogs_.resize(domains.size());
-                    plural_forms_.resize(domains.size());
+                    #ifdef BOOST_LOCALE_CATALOG_STATISTICS
+                    if(inf.collect_statistics) {
+                        counters_.reset(new lookup_counters[domains.size()]);
+                        for(unsigned id=0;id<domains.size();id++) {
+                            counters_[id].hits.store(0,boost::memory_order_relaxed);
+                            counters_[id].misses.store(0,boost::memory_order_relaxed);
+                        }
+                    }
+                    #endif
 
+                    for(unsigned id=0;id<domains.size();id++)
+                        domains_[domains[id].name]=id;
 
-                    for(unsigned id=0;id<domains.size();id++) {
-                        std::string domain=domains[id].name;
-                        std::string key_encoding = domains[id].encoding;
-                        domains_[domain]=id;
+                    for(unsigned j=0;j<paths.size();j++) {
+                        for(unsigned i=0;i<inf.paths.size();i++)
+                            directories_.push_back(inf.paths[i]+"/"+paths[j]+"/" + inf.locale_category);
+                    }
 
+                    // the conversion of the keys is done with the encoding of the last domain
+                    set_encodings(encoding,domains.empty() ? encoding : domains.back().encoding);
 
-                        bool found=false; 
-                        for(unsigned j=0;!found && j<paths.size();j++) {
-                            for(unsigned i=0;!found && i<search_paths.size();i++) {
-                                std::string full_path = search_paths[i]+"/"+paths[j]+"/" + lc_cat + "/"+domain+".mo";
-                                found = load_file(full_path,encoding,key_encoding,id,inf.callback);
-                            }
-                        }
-                    }
+                    boost::shared_ptr<catalogs_set_type> catalogs(new catalogs_set_type(domains.size()));
+                    load_domains(*catalogs);
+                    current_ = catalogs;
+                    catalogs_.store(catalogs.get(),boost::memory_order_release);
                 }
                 
                 char_type const *convert(char_type const *msg,string_type &buffer) const 
@@ -591,12 +2042,97 @@ namespace boost {
                 }
 
             private:
-                int compare_encodings(std::string const &left,std::string const &right)
+
+                struct domain_loader {
+                    mo_message const *self;
+                    catalogs_set_type *catalogs;
+                    boost::atomic<unsigned> *next_domain;
+                    std::vector<char> *failed;
+
+                    void operator()() const
+                    {
+                        for(;;) {
+                            unsigned id = next_domain->fetch_add(1,boost::memory_order_relaxed);
+                            if(id >= failed->size())
+                                return;
+                            try {
+                                self->load_domain(id,*catalogs);
+                            }
+                            catch(...) {
+                                (*failed)[id] = 1;
+                            }
+                        }
+                    }
+                };
+
+                //
+                // Load the catalogs of all domains to \a catalogs
+                //
+                void load_domains(catalogs_set_type &catalogs) const
+                {
+                    size_t domains = info_.domains.size();
+                    unsigned threads = info_.load_threads;
+                    if(threads > domains)
+                        threads = domains;
+                    if(threads <= 1) {
+                        for(unsigned id=0;id<domains;id++)
+                            load_domain(id,catalogs);
+                        return;
+                    }
+
+                    //
+                    // Domains are independent, so they are loaded by the threads of the shared pool each taking
+                    // the next domain that is not loaded yet. The calling thread takes part as well.
+                    //
+                    boost::atomic<unsigned> next_domain(0);
+                    std::vector<char> failed(domains,0);
+                    domain_loader loader = { this, &catalogs, &next_domain, &failed };
+                    catalog_loader_pool().run(loader,threads - 1);
+
+                    // load the domains that failed once again so the original error reaches the caller
+                    for(unsigned id=0;id<domains;id++) {
+                        if(failed[id])
+                            load_domain(id,catalogs);
+                    }
+                }
+
+                //
+                // Find the catalog of the domain \a id in the search paths and store it in catalogs[id], nothing
+                // else is modified so different domains can be loaded concurrently
+                //
+                void load_domain(unsigned id,catalogs_set_type &catalogs) const
+                {
+                    messages_info const &inf = info_;
+                    std::vector<std::string> const &paths = paths_;
+                    std::string const &domain = inf.domains[id].name;
+                    std::string const &key_encoding = inf.domains[id].encoding;
+                    std::string const &encoding = inf.encoding;
+                    std::vector<std::string> const &search_paths = inf.paths;
+                    // custom file systems are asked for every file
+                    bool real_fs = !inf.callback && !inf.mapped_callback;
+
+                    bool found=false; 
+                    for(unsigned j=0;!found && j<paths.size();j++) {
+                        for(unsigned i=0;!found && i<search_paths.size();i++) {
+                            std::string base_path = search_paths[i]+"/"+paths[j]+"/" + inf.locale_category + "/"+domain;
+                            std::string file_name = base_path + ".mcat";
+                            if(inf.compiled_catalogs && (!real_fs || catalog_file_may_exist(file_name,encoding)))
+                                found = load_compiled_file(file_name,encoding,key_encoding,catalogs[id],inf.callback,inf.mapped_callback,inf.use_mmap);
+                            file_name = base_path + ".mo";
+                            if(!found && (!real_fs || catalog_file_may_exist(file_name,encoding)))
+                                found = load_file(file_name,encoding,key_encoding,catalogs[id],inf.callback,inf.mapped_callback,inf.use_mmap,inf.lazy_conversion);
+                        }
+                    }
+                    if(!found)
+                        catalogs[id] = empty_catalog_;
+                }
+
+                int compare_encodings(std::string const &left,std::string const &right) const
                 {
                     return convert_encoding_name(left).compare(convert_encoding_name(right)); 
                 }
 
-                std::string convert_encoding_name(std::string const &in)
+                std::string convert_encoding_name(std::string const &in) const
                 {
                     std::string result;
                     for(unsigned i=0;i<in.size();i++) {
@@ -613,26 +2149,189 @@ namespace boost {
                 }
 
 
-                bool load_file( std::string const &file_name,
-                                std::string const &locale_encoding,
-                                std::string const &key_encoding,
-                                int id,
-                                messages_info::callback_type const &callback)
+                //
+                // Create the key of the catalog loaded from file \a file_name in the registry of shared
+                // catalogs, returns false if the file does not exist
+                //
+                bool shared_catalog_key(std::string const &file_name,
+                                        std::string const &locale_encoding,
+                                        std::string const &key_encoding,
+                                        std::string &shared_key) const
+                {
+                    if(!file_identity(file_name,locale_encoding,shared_key))
+                        return false;
+                    shared_key += '\0';
+                    shared_key += convert_encoding_name(locale_encoding);
+                    shared_key += '\0';
+                    shared_key += convert_encoding_name(key_encoding);
+                    shared_key += '\0';
+                    shared_key += typeid(CharType).name();
+                    return true;
+                }
+
+                //
+                // Load the catalog created by compile_catalog tool, returns false if it does not exist
+                // or it can't be used for this encoding
+                //
+                bool load_compiled_file(std::string const &file_name,
+                                        std::string const &locale_encoding,
+                                        std::string const &key_encoding,
+                                        catalog_ptr_type &catalog,
+                                        messages_info::callback_type const &callback,
+                                        messages_info::mapped_callback_type const &mapped_callback,
+                                        bool use_mmap) const
+                {
+                    std::string shared_key;
+                    if(!mapped_callback && !callback) {
+                        if(!shared_catalog_key(file_name,locale_encoding,key_encoding,shared_key))
+                            return false;
+                        shared_key += use_mmap ? ":mmap" : ":read";
+                        shared_key += ":compiled";
+                        boost::shared_ptr<void> existing = find_shared_catalog(shared_key);
+                        if(existing) {
+                            catalog = boost::static_pointer_cast<domain_catalog_type const>(existing);
+                            return true;
+                        }
+                    }
+
+                    // narrow catalogs are kept in UTF-8 only
+                    bool utf8_locale = compare_encodings(locale_encoding,"UTF-8") == 0;
+                    if(sizeof(CharType) == 1 && !utf8_locale)
+                        return false;
+
+                    catalog_region region;
+                    if(mapped_callback) {
+                        region = mapped_callback(file_name,locale_encoding);
+                        if(!region.begin)
+                            return false;
+                    }
+                    else if(callback) {
+                        boost::shared_ptr<std::vector<char> > data(new std::vector<char>(callback(file_name,locale_encoding)));
+                        if(data->empty()) 
+                            return false;
+                        region.begin = &(*data)[0];
+                        region.end = region.begin + data->size();
+                        region.holder = data;
+                    }
+                    boost::uint64_t digest = 0;
+                    if(callback || mapped_callback)
+                        digest = catalog_digest(region.begin,region.end);
+                    else if(use_mmap) {
+                        boost::shared_ptr<mmap_file> the_file(new mmap_file());
+                        if(!the_file->open(file_name,locale_encoding))
+                            return false;
+                        region.begin = the_file->data;
+                        region.end = the_file->data + the_file->size;
+                        region.holder = the_file;
+                    }
+                    else {
+                        c_file the_file;
+                        the_file.open(file_name,locale_encoding);
+                        if(!the_file.file)
+                            return false;
+                        fseek(the_file.file,0,SEEK_END);
+                        long len=ftell(the_file.file);
+                        if(len < 0)
+                            throw std::runtime_error("Wrong file object");
+                        fseek(the_file.file,0,SEEK_SET);
+                        // words aligned buffer
+                        boost::shared_ptr<std::vector<uint32_t> > data(new std::vector<uint32_t>(len / 4 + 1));
+                        if(fread(&(*data)[0],1,len,the_file.file)!=unsigned(len))
+                            throw std::runtime_error("Failed to read file");
+                        region.begin = reinterpret_cast<char const *>(&(*data)[0]);
+                        region.end = region.begin + len;
+                        region.holder = data;
+                    }
+
+                    boost::shared_ptr<compiled_catalog<CharType> > compiled(new compiled_catalog<CharType>(region));
+                    if(sizeof(CharType) == 1 && compare_encodings(key_encoding,"UTF-8") != 0 && !compiled->ascii_keys())
+                        return false;
+
+                    boost::shared_ptr<domain_catalog_type> cat(new domain_catalog_type());
+                    std::string plural = compiled->plural_forms();
+                    if(!plural.empty())
+                        cat->plural_forms = lambda::compile(plural.c_str());
+                    cat->compiled = compiled;
+                    if(callback || mapped_callback) {
+                        cat->source_digest = digest;
+                        cat->source_size = region.end - region.begin;
+                    }
+
+                    if(shared_key.empty()) {
+                        catalog = cat;
+                    }
+                    else {
+                        boost::shared_ptr<void> shared = share_catalog(shared_key,cat);
+                        catalog = boost::static_pointer_cast<domain_catalog_type const>(shared);
+                    }
+                    return true;
+                }
+
+                void set_encodings(std::string const &locale_encoding,std::string const &key_encoding)
                 {
                     locale_encoding_ = locale_encoding;
                     key_encoding_ = key_encoding;
-                    
                     key_conversion_required_ =  sizeof(CharType) == 1 
                                                 && compare_encodings(locale_encoding,key_encoding)!=0;
+                }
+
+                bool load_file( std::string const &file_name,
+                                std::string const &locale_encoding,
+                                std::string const &key_encoding,
+                                catalog_ptr_type &catalog,
+                                messages_info::callback_type const &callback,
+                                messages_info::mapped_callback_type const &mapped_callback,
+                                bool use_mmap,
+                                bool lazy_conversion) const
+                {
+                    //
+                    // Catalogs that come from the real file system are shared with all other
+                    // facets that use the same version of the file, custom file systems
+                    // do not provide the file identity so they are always loaded
+                    //
+                    std::string shared_key;
+                    if(!mapped_callback && !callback) {
+                        if(!shared_catalog_key(file_name,locale_encoding,key_encoding,shared_key))
+                            return false;
+                        shared_key += use_mmap ? ":mmap" : ":read";
+                        shared_key += lazy_conversion ? ":lazy" : ":eager";
+                        boost::shared_ptr<void> existing = find_shared_catalog(shared_key);
+                        if(existing) {
+                            catalog = boost::static_pointer_cast<domain_catalog_type const>(existing);
+                            return true;
+                        }
+                    }
 
                     std::auto_ptr<mo_file> mo;
+                    boost::uint64_t digest = 0;
+                    size_t source_size = 0;
 
-                    if(callback) {
+                    if(mapped_callback) {
+                        catalog_region region = mapped_callback(file_name,locale_encoding);
+                        if(!region.begin)
+                            return false;
+                        digest = catalog_digest(region.begin,region.end);
+                        source_size = region.end - region.begin;
+                        mo.reset(new mo_file(region));
+                    }
+                    else if(callback) {
                         std::vector<char> vfile = callback(file_name,locale_encoding);
                         if(vfile.empty()) 
                             return false;
+                        digest = catalog_digest(&vfile[0],&vfile[0] + vfile.size());
+                        source_size = vfile.size();
                         mo.reset(new mo_file(vfile));
                     }
+                    else if(use_mmap) {
+                        boost::shared_ptr<mmap_file> the_file(new mmap_file());
+                        if(!the_file->open(file_name,locale_encoding))
+                            return false;
+                        catalog_region region;
+                        region.begin = the_file->data;
+                        region.end = the_file->data + the_file->size;
+                        region.holder = the_file;
+                        mo.reset(new mo_file(region));
+                    }
                     else {
                         c_file the_file;
                         the_file.open(file_name,locale_encoding);
@@ -648,27 +2347,48 @@ namespace boost {
                     if(mo_encoding.empty())
                         throw std::runtime_error("Invalid mo-format, encoding is not specified");
 
-                    if(!plural.empty()) {
-                        std::auto_ptr<lambda::plural> ptr=lambda::compile(plural.c_str());
-                        plural_forms_[id] = ptr;
-                    }
+                    boost::shared_ptr<domain_catalog_type> cat(new domain_catalog_type());
+                    cat->source_digest = digest;
+                    cat->source_size = source_size;
+
+                    if(!plural.empty())
+                        cat->plural_forms = lambda::compile(plural.c_str());
 
-                    if( mo_useable_directly(mo_encoding,*mo) )
+                    if( mo_useable_directly(mo_encoding,locale_encoding,key_encoding,*mo) )
                     {
-                        mo_catalogs_[id]=mo;
+                        cat->mo = mo;
+                    }
+                    else if(lazy_conversion) {
+                        boost::shared_ptr<mo_file> shared_mo(mo);
+                        cat->lazy.reset(new lazy_catalog<CharType>(shared_mo,locale_encoding,key_encoding,mo_encoding));
                     }
                     else {
+                        #ifdef BOOST_LOCALE_CATALOG_STATISTICS
+                        boost::uint64_t start = monotonic_clock();
+                        #endif
                         converter<CharType> cvt_value(locale_encoding,mo_encoding);
                         converter<CharType> cvt_key(key_encoding,mo_encoding);
                         for(unsigned i=0;i<mo->size();i++) {
                             char const *ckey = mo->key(i);
-                            string_type skey = cvt_key(ckey,ckey+strlen(ckey));
-                            key_type key(skey);
+                            string_type key = cvt_key(ckey,ckey+strlen(ckey));
                             
                             mo_file::pair_type tmp = mo->value(i);
                             string_type value = cvt_value(tmp.first,tmp.second);
-                            catalogs_[id][key].swap(value);
+                            cat->catalog.add(   key.data(),key.data() + key.size(),
+                                                value.data(),value.data() + value.size());
                         }
+                        cat->catalog.build();
+                        #ifdef BOOST_LOCALE_CATALOG_STATISTICS
+                        cat->conversion_time = monotonic_clock() - start;
+                        #endif
+                    }
+
+                    if(shared_key.empty()) {
+                        catalog = cat;
+                    }
+                    else {
+                        boost::shared_ptr<void> shared = share_catalog(shared_key,cat);
+                        catalog = boost::static_pointer_cast<domain_catalog_type const>(shared);
                     }
                     return true;
 
@@ -680,19 +2400,20 @@ namespace boost {
                 // 3. The source strings encoding and mo encoding is same or all
                 //    mo key strings are US-ASCII
                 bool mo_useable_directly(   std::string const &mo_encoding,
-                                            mo_file const &mo)
+                                            std::string const &locale_encoding,
+                                            std::string const &key_encoding,
+                                            mo_file const &mo) const
                 {
                     if(sizeof(CharType) != 1)
                         return false;
-                    if(!mo.has_hash())
+                    if(compare_encodings(mo_encoding.c_str(),locale_encoding.c_str())!=0)
                         return false;
-                    if(compare_encodings(mo_encoding.c_str(),locale_encoding_.c_str())!=0)
-                        return false;
-                    if(compare_encodings(mo_encoding.c_str(),key_encoding_.c_str())==0) {
+                    if(compare_encodings(mo_encoding.c_str(),key_encoding.c_str())==0) {
                         return true;
                     }
                     for(unsigned i=0;i<mo.size();i++) {
-                        if(!details::is_us_ascii_string(mo.key(i))) {
+                        mo_file::pair_type key = mo.key_range(i);
+                        if(!details::is_us_ascii_string(key.first,key.second)) {
                             return false;
                         }
                     }
@@ -714,29 +2435,185 @@ namespace boost {
 
 
 
-                pair_type get_string(int domain_id,char_type const *context,char_type const *in_id) const
+                static char_type const *get_plural(pair_type ptr,domain_catalog_type const *dcat,int n)
+                {
+                    if(!dcat)
+                        return 0;
+                    return get_plural(ptr,*dcat,n);
+                }
+
+                static char_type const *get_plural(pair_type ptr,domain_catalog_type const &dcat,int n)
+                {
+                    if(!ptr.first)
+                        return 0;
+                    return get_plural_range(ptr,dcat,n).first;
+                }
+
+                //
+                // The range of the form for \a n in the entry \a ptr
+                //
+                static pair_type get_plural_range(pair_type ptr,domain_catalog_type const &dcat,int n)
+                {
+                    pair_type null_pair((CharType const *)0,(CharType const *)0);
+                    int form=0;
+                    lambda::plural const &plural_forms = dcat.plural_forms;
+                    if(!plural_forms.empty()) 
+                        form = plural_forms(n);
+                    else
+                        form = n == 1 ? 0 : 1; // Fallback to english plural form
+
+                    CharType const *p=ptr.first;
+                    for(int i=0;p < ptr.second && i<form;i++) {
+                        p=std::find(p,ptr.second,0);
+                        if(p==ptr.second)
+                            return null_pair;
+                        ++p;
+                    }
+                    if(p>=ptr.second)
+                        return null_pair;
+                    return pair_type(p,form_end(p,ptr.second));
+                }
+
+                //
+                // The end of the form starting at \a p, forms are separated by null characters
+                //
+                static char_type const *form_end(char_type const *p,char_type const *end)
+                {
+                    char_type const *e = std::char_traits<char_type>::find(p,end - p,char_type());
+                    return e ? e : end;
+                }
+
+                //
+                // Get the catalog of the domain \a domain_id from the current set, returns NULL if the id is not valid.
+                // Sets replaced by reload() are kept for the grace period, so the catalog can be used by the lookup
+                // that is in progress when it is replaced.
+                //
+                domain_catalog_type const *catalog(int domain_id) const
+                {
+                    catalogs_set_type const &catalogs = *catalogs_.load(boost::memory_order_acquire);
+                    if(domain_id < 0 || size_t(domain_id) >= catalogs.size())
+                        return 0;
+                    return catalogs[domain_id].get();
+                }
+
+                pair_type get_string(int domain_id,char_type const *context,char_type const *in_id,bool has_hash,uint32_t hash) const
+                {
+                    return get_string(domain_id,catalog(domain_id),context,in_id,has_hash,hash);
+                }
+
+                pair_type get_string(   int domain_id,
+                                        domain_catalog_type const *dcat,
+                                        char_type const *context,
+                                        char_type const *in_id,
+                                        bool has_hash,
+                                        uint32_t hash) const
                 {
                     pair_type null_pair((CharType const *)0,(CharType const *)0);
-                    if(domain_id < 0 || size_t(domain_id) >= catalogs_.size())
+                    if(!dcat)
                         return null_pair;
-                    if(mo_file_use_traits<char_type>::in_use && mo_catalogs_[domain_id]) {
-                        return mo_file_use_traits<char_type>::use(*mo_catalogs_[domain_id],context,in_id);
+                    pair_type ptr = get_string(*dcat,context,in_id,has_hash,hash);
+                    count_lookup(domain_id,ptr.first != 0);
+                    return ptr;
+                }
+
+                void count_lookup(int domain_id,bool found) const
+                {
+                    #ifndef BOOST_LOCALE_CATALOG_STATISTICS
+                    (void)domain_id;
+                    (void)found;
+                    #else
+                    if(!counters_)
+                        return;
+                    lookup_counters &c = counters_[domain_id];
+                    if(found)
+                        c.hits.fetch_add(1,boost::memory_order_relaxed);
+                    else
+                        c.misses.fetch_add(1,boost::memory_order_relaxed);
+                    #endif
+                }
+
+                static pair_type get_string(domain_catalog_type const &dcat,char_type const *context,char_type const *in_id,bool has_hash,uint32_t hash)
+                {
+                    if(context && *context == 0)
+                        context = 0;
+                    if(dcat.compiled) {
+                        // the catalog uses its own hash function
+                        return dcat.compiled->find(context,in_id);
+                    }
+                    else if(mo_file_use_traits<char_type>::in_use && dcat.mo) {
+                        if(has_hash)
+                            return mo_file_use_traits<char_type>::use(*dcat.mo,context,in_id,hash);
+                        return mo_file_use_traits<char_type>::use(*dcat.mo,context,in_id);
+                    }
+                    else if(dcat.lazy) {
+                        if(has_hash)
+                            return dcat.lazy->find(context,in_id,hash);
+                        return dcat.lazy->find(context,in_id);
                     }
                     else {
-                        key_type key(context,in_id);
-                        catalog_type const &cat = catalogs_[domain_id];
-                        typename catalog_type::const_iterator p = cat.find(key);
-                        if(p==cat.end()) {
-                            return null_pair;
-                        }
-                        return pair_type(p->second.data(),p->second.data()+p->second.size());
+                        if(has_hash)
+                            return dcat.catalog.find(context,in_id,hash);
+                        return dcat.catalog.find(context,in_id);
                     }
                 }
 
-                catalogs_set_type catalogs_;
-                std::vector<boost::shared_ptr<mo_file> > mo_catalogs_;
-                std::vector<boost::shared_ptr<lambda::plural> > plural_forms_;
+                static void prefetch(domain_catalog_type const &dcat,uint32_t hash)
+                {
+                    if(dcat.compiled)
+                        return;
+                    if(mo_file_use_traits<char_type>::in_use && dcat.mo)
+                        dcat.mo->prefetch(hash);
+                    else if(dcat.lazy)
+                        dcat.lazy->prefetch(hash);
+                    else
+                        dcat.catalog.prefetch(hash);
+                }
+
+                struct lookup_counters {
+                    boost::atomic<boost::uint64_t> hits;
+                    boost::atomic<boost::uint64_t> misses;
+                };
+
+                messages_info info_;
+                std::vector<std::string> paths_;            ///< the names of the locale directories to search
+                std::vector<std::string> directories_;      ///< all directories the catalogs are searched in
+                catalog_ptr_type empty_catalog_;            ///< used for the domains that are not found
+
+                //
+                // Release the sets that were replaced at least reload_grace_period seconds ago, the set replaced
+                // by the last reload is kept until the next one in any case
+                //
+                void release_retired_sets() const
+                {
+                    boost::uint64_t now = monotonic_clock();
+                    boost::uint64_t grace = boost::uint64_t(info_.reload_grace_period) * 1000000;
+                    size_t expired = 0;
+                    while(expired < retired_.size() && now - retired_[expired].retired >= grace)
+                        expired++;
+                    retired_.erase(retired_.begin(),retired_.begin() + expired);
+                }
+
+                struct retired_set {
+                    boost::shared_ptr<catalogs_set_type const> catalogs;
+                    boost::uint64_t retired;    ///< monotonic_clock() when the set was replaced
+                };
+
+                static size_t const max_retired_sets = 16;
+
+                //
+                // Readers use the set catalogs_ points to without any locking and the translations they return may
+                // be used for a while after it is replaced. So reload() keeps the replaced sets in retired_ and
+                // releases them only after the grace period, at most max_retired_sets of them are kept. Catalogs
+                // that did not change are shared between the sets, only the replaced ones are kept in addition.
+                //
+                mutable boost::atomic<catalogs_set_type const *> catalogs_;
+                mutable boost::shared_ptr<catalogs_set_type const> current_;
+                mutable std::vector<retired_set> retired_;
+                mutable boost::mutex reload_lock_;
+                mutable boost::atomic<unsigned> generation_;
+
                 domains_map_type domains_;
+                boost::scoped_array<lookup_counters> counters_; ///< null if the statistics are not collected
 
                 std::string locale_encoding_;
                 std::string key_encoding_; 
@@ -0,0 +1,473 @@
+//
+//  Copyright (c) 2009-2011 Artyom Beilis (Tonkikh)
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef BOOST_SRC_LOCALE_MO_COMPILED_HPP_INCLUDED
+#define BOOST_SRC_LOCALE_MO_COMPILED_HPP_INCLUDED
+
+#include <boost/cstdint.hpp>
+#include <stdexcept>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <map>
+#include <string.h>
+
+namespace boost {
+    namespace locale {
+        namespace gnu_gettext {
+            ///
+            /// \brief Compiled message catalogs - the format shared by the \c compile_catalog tool and the loader
+            ///
+            /// The file consists of 32 bit words in the native byte order of the machine it was created for:
+            ///
+            /// - file_header
+            /// - displacements of the buckets of the perfect hash, \a buckets signed words
+            /// - the plural forms expression, NUL terminated US-ASCII string
+            /// - three sections for UTF-8, UTF-16 and UTF-32, each made of section_header, \a count entries
+            ///   and the strings, all keys and translations encoded and NUL terminated.
+            ///
+            /// The key of a message is its id, or its context, EOT (4) and id. A key is found by hashing its
+            /// code points, so the same slot is used for any encoding: the bucket of the key is selected by
+            /// the first hash, if the displacement of the bucket is negative it gives the slot directly, otherwise
+            /// the slot is calculated from the second hash and the displacement. Plural forms of a translation
+            /// are separated by NUL like in mo files.
+            ///
+            namespace compiled {
+
+                static const uint32_t file_magic = 0x5441434DU; // "MCAT" in little endian
+                static const uint32_t file_version = 1;
+                static const uint32_t flag_ascii_keys = 1;  ///< all keys are US-ASCII
+                static const uint32_t illegal = 0xFFFFFFFFU;
+
+                struct file_header {
+                    uint32_t magic;
+                    uint32_t version;
+                    uint32_t flags;
+                    uint32_t count;             ///< number of messages
+                    uint32_t buckets;           ///< number of buckets of the perfect hash
+                    uint32_t buckets_offset;
+                    uint32_t plural_offset;
+                    uint32_t sections[3];       ///< offsets of the UTF-8, UTF-16 and UTF-32 sections
+                    uint32_t size;              ///< total size of the file
+                };
+
+                struct section_header {
+                    uint32_t entries_offset;
+                    uint32_t strings_offset;
+                    uint32_t strings_size;      ///< in code units
+                };
+
+                struct entry {                  ///< offsets and sizes in code units within the strings
+                    uint32_t key;
+                    uint32_t key_size;
+                    uint32_t value;
+                    uint32_t value_size;
+                };
+
+                template<int Size>
+                struct section_index;
+                template<> struct section_index<1> { static const int value = 0; };
+                template<> struct section_index<2> { static const int value = 1; };
+                template<> struct section_index<4> { static const int value = 2; };
+
+                //
+                // Decoding of the code points of UTF-8, UTF-16 and UTF-32 strings, returns illegal for invalid
+                // sequences. Code points are not validated further than needed to find the same slot for any encoding.
+                //
+
+                template<int Size>
+                struct utf_decoder;
+
+                template<>
+                struct utf_decoder<1> {
+                    template<typename Iterator>
+                    static uint32_t next(Iterator &p,Iterator e)
+                    {
+                        uint32_t c = static_cast<unsigned char>(*p++);
+                        if(c < 0x80)
+                            return c;
+                        int trail;
+                        if(c < 0xC2)
+                            return illegal;
+                        else if(c < 0xE0) { trail = 1; c &= 0x1F; }
+                        else if(c < 0xF0) { trail = 2; c &= 0x0F; }
+                        else if(c < 0xF5) { trail = 3; c &= 0x07; }
+                        else
+                            return illegal;
+                        while(trail-- > 0) {
+                            if(p == e)
+                                return illegal;
+                            uint32_t t = static_cast<unsigned char>(*p++);
+                            if((t & 0xC0) != 0x80)
+                                return illegal;
+                            c = (c << 6) | (t & 0x3F);
+                        }
+                        return c;
+                    }
+                };
+
+                template<>
+                struct utf_decoder<2> {
+                    template<typename Iterator>
+                    static uint32_t next(Iterator &p,Iterator e)
+                    {
+                        uint32_t c = static_cast<uint16_t>(*p++);
+                        if(c < 0xD800 || c > 0xDFFF)
+                            return c;
+                        if(c > 0xDBFF || p == e)
+                            return illegal;
+                        uint32_t t = static_cast<uint16_t>(*p++);
+                        if(t < 0xDC00 || t > 0xDFFF)
+                            return illegal;
+                        return 0x10000 + ((c - 0xD800) << 10) + (t - 0xDC00);
+                    }
+                };
+
+                template<>
+                struct utf_decoder<4> {
+                    template<typename Iterator>
+                    static uint32_t next(Iterator &p,Iterator /*e*/)
+                    {
+                        uint32_t c = static_cast<uint32_t>(*p++);
+                        return c > 0x10FFFF ? illegal : c;
+                    }
+                };
+
+                inline void append_utf8(std::string &out,uint32_t c)
+                {
+                    if(c < 0x80) {
+                        out += char(c);
+                    }
+                    else if(c < 0x800) {
+                        out += char(0xC0 | (c >> 6));
+                        out += char(0x80 | (c & 0x3F));
+                    }
+                    else if(c < 0x10000) {
+                        out += char(0xE0 | (c >> 12));
+                        out += char(0x80 | ((c >> 6) & 0x3F));
+                        out += char(0x80 | (c & 0x3F));
+                    }
+                    else {
+                        out += char(0xF0 | (c >> 18));
+                        out += char(0x80 | ((c >> 12) & 0x3F));
+                        out += char(0x80 | ((c >> 6) & 0x3F));
+                        out += char(0x80 | (c & 0x3F));
+                    }
+                }
+
+                inline void append_utf16(std::vector<uint16_t> &out,uint32_t c)
+                {
+                    if(c < 0x10000) {
+                        out.push_back(static_cast<uint16_t>(c));
+                    }
+                    else {
+                        c -= 0x10000;
+                        out.push_back(static_cast<uint16_t>(0xD800 | (c >> 10)));
+                        out.push_back(static_cast<uint16_t>(0xDC00 | (c & 0x3FF)));
+                    }
+                }
+
+                ///
+                /// Two independent hashes of a key calculated in a single pass
+                ///
+                struct key_hasher {
+                    key_hasher() :
+                        first(0x811C9DC5U),
+                        second(0x2C9277B5U)
+                    {
+                    }
+                    void update(uint32_t c)
+                    {
+                        first = (first ^ c) * 0x01000193U;
+                        second = (second + c) * 0x9E3779B1U;
+                        second ^= second >> 15;
+                    }
+                    template<typename CharType>
+                    bool update(CharType const *p)
+                    {
+                        CharType const *e = p + std::char_traits<CharType>::length(p);
+                        while(p != e) {
+                            uint32_t c = utf_decoder<sizeof(CharType)>::next(p,e);
+                            if(c == illegal)
+                                return false;
+                            update(c);
+                        }
+                        return true;
+                    }
+                    uint32_t bucket(uint32_t buckets) const
+                    {
+                        return mix(first) % buckets;
+                    }
+                    uint32_t slot(uint32_t displacement,uint32_t count) const
+                    {
+                        return mix(second + displacement * 0x85EBCA6BU) % count;
+                    }
+                    static uint32_t mix(uint32_t h)
+                    {
+                        h ^= h >> 16;
+                        h *= 0x85EBCA6BU;
+                        h ^= h >> 13;
+                        h *= 0xC2B2AE35U;
+                        h ^= h >> 16;
+                        return h;
+                    }
+                    uint32_t first;
+                    uint32_t second;
+                };
+
+                ///
+                /// Hash a key given by the optional \a context and the \a id, returns false if the key
+                /// is not valid UTF-8/16/32 string
+                ///
+                template<typename CharType>
+                bool hash_key(CharType const *context,CharType const *id,key_hasher &h)
+                {
+                    if(context && *context) {
+                        if(!h.update(context))
+                            return false;
+                        h.update(4); // EOT
+                    }
+                    return h.update(id);
+                }
+
+                ///
+                /// Creates the compiled catalog from UTF-8 encoded messages
+                ///
+                class catalog_builder {
+                public:
+                    catalog_builder()
+                    {
+                    }
+
+                    ///
+                    /// Set the plural forms expression, for example "n != 1"
+                    ///
+                    void plural_forms(std::string const &expression)
+                    {
+                        plural_ = expression;
+                    }
+
+                    ///
+                    /// Add a message, \a value holds NUL separated plural forms. Throws std::runtime_error if
+                    /// the strings are not valid UTF-8.
+                    ///
+                    void add(std::string const &context,std::string const &id,std::string const &value)
+                    {
+                        std::string key = context.empty() ? id : context + '\4' + id;
+                        decode(key);
+                        decode(value);
+                        messages_[key] = value;
+                    }
+
+                    ///
+                    /// Create the file
+                    ///
+                    std::vector<char> build() const
+                    {
+                        uint32_t count = static_cast<uint32_t>(messages_.size());
+                        uint32_t buckets = count == 0 ? 1 : count;
+
+                        // hashes and perfect hash construction
+                        std::vector<key_hasher> hashes;
+                        std::vector<std::vector<uint32_t> > bucket_members(buckets);
+                        uint32_t flags = flag_ascii_keys;
+                        for(map_type::const_iterator p=messages_.begin();p!=messages_.end();++p) {
+                            std::vector<uint32_t> cps = decode(p->first);
+                            key_hasher h;
+                            for(size_t i=0;i<cps.size();i++) {
+                                h.update(cps[i]);
+                                if(cps[i] >= 0x80)
+                                    flags &= ~flag_ascii_keys;
+                            }
+                            bucket_members[h.bucket(buckets)].push_back(static_cast<uint32_t>(hashes.size()));
+                            hashes.push_back(h);
+                        }
+                        std::vector<int32_t> displacements(buckets,0);
+                        std::vector<uint32_t> slots(count,illegal); // message index in each slot
+                        place(hashes,bucket_members,displacements,slots);
+
+                        std::vector<map_type::const_iterator> messages(count);
+                        {
+                            uint32_t i = 0;
+                            for(map_type::const_iterator p=messages_.begin();p!=messages_.end();++p)
+                                messages[i++] = p;
+                        }
+
+                        // layout
+                        std::vector<char> out(sizeof(file_header),0);
+                        file_header hdr = file_header();
+                        hdr.magic = file_magic;
+                        hdr.version = file_version;
+                        hdr.flags = flags;
+                        hdr.count = count;
+                        hdr.buckets = buckets;
+                        hdr.buckets_offset = append(out,&displacements[0],displacements.size());
+                        hdr.plural_offset = append(out,plural_.c_str(),plural_.size() + 1);
+
+                        for(int s=0;s<3;s++) {
+                            std::vector<entry> entries(count);
+                            std::vector<uint32_t> units; // code units of the section
+                            for(uint32_t slot=0;slot<count;slot++) {
+                                map_type::const_iterator msg = messages[slots[slot]];
+                                entries[slot].key = static_cast<uint32_t>(units.size());
+                                entries[slot].key_size = encode(s,msg->first,units);
+                                entries[slot].value = static_cast<uint32_t>(units.size());
+                                entries[slot].value_size = encode(s,msg->second,units);
+                            }
+                            units.push_back(0);
+                            section_header sec;
+                            sec.entries_offset = append(out,entries.empty() ? 0 : &entries[0],entries.size());
+                            sec.strings_size = static_cast<uint32_t>(units.size());
+                            if(s == 0) {
+                                std::vector<char> tmp(units.begin(),units.end());
+                                sec.strings_offset = append(out,&tmp[0],tmp.size());
+                            }
+                            else if(s == 1) {
+                                std::vector<uint16_t> tmp(units.begin(),units.end());
+                                sec.strings_offset = append(out,&tmp[0],tmp.size());
+                            }
+                            else {
+                                sec.strings_offset = append(out,&units[0],units.size());
+                            }
+                            hdr.sections[s] = append(out,&sec,1);
+                        }
+                        hdr.size = static_cast<uint32_t>(out.size());
+                        memcpy(&out[0],&hdr,sizeof(hdr));
+                        return out;
+                    }
+
+                private:
+                    typedef std::map<std::string,std::string> map_type;
+
+                    static std::vector<uint32_t> decode(std::string const &s)
+                    {
+                        std::vector<uint32_t> result;
+                        std::string::const_iterator p = s.begin(),e = s.end();
+                        while(p != e) {
+                            std::string::const_iterator start = p;
+                            uint32_t c = utf_decoder<1>::next(p,e);
+                            std::string canonical;
+                            if(c != illegal && !(0xD800 <= c && c <= 0xDFFF) && c <= 0x10FFFF)
+                                append_utf8(canonical,c);
+                            // reject overlong forms and surrogates, so every encoding has the same code points
+                            if(canonical.empty() || canonical.size() != size_t(p - start))
+                                throw std::runtime_error("Invalid UTF-8 string in message catalog");
+                            result.push_back(c);
+                        }
+                        return result;
+                    }
+
+                    // append code units of UTF-8/16/32 string with NUL terminator, returns its size
+                    static uint32_t encode(int section,std::string const &s,std::vector<uint32_t> &units)
+                    {
+                        size_t start = units.size();
+                        std::vector<uint32_t> cps = decode(s);
+                        if(section == 0) {
+                            units.insert(units.end(),s.begin(),s.end());
+                            for(size_t i=start;i<units.size();i++)
+                                units[i] &= 0xFF;
+                        }
+                        else if(section == 1) {
+                            std::vector<uint16_t> tmp;
+                            for(size_t i=0;i<cps.size();i++)
+                                append_utf16(tmp,cps[i]);
+                            units.insert(units.end(),tmp.begin(),tmp.end());
+                        }
+                        else {
+                            units.insert(units.end(),cps.begin(),cps.end());
+                        }
+                        uint32_t size = static_cast<uint32_t>(units.size() - start);
+                        units.push_back(0);
+                        return size;
+                    }
+
+                    // append an array aligned to 4 bytes, returns its offset
+                    template<typename T>
+                    static uint32_t append(std::vector<char> &out,T const *data,size_t n)
+                    {
+                        while(out.size() % 4 != 0)
+                            out.push_back(0);
+                        if(out.size() + n * sizeof(T) >= 0xFFFFFFFFU)
+                            throw std::runtime_error("Message catalog is too big");
+                        uint32_t offset = static_cast<uint32_t>(out.size());
+                        char const *begin = reinterpret_cast<char const *>(data);
+                        out.insert(out.end(),begin,begin + n * sizeof(T));
+                        return offset;
+                    }
+
+                    struct bigger_bucket {
+                        bigger_bucket(std::vector<std::vector<uint32_t> > const &b) : buckets(b) {}
+                        bool operator()(uint32_t l,uint32_t r) const
+                        {
+                            return buckets[l].size() > buckets[r].size();
+                        }
+                        std::vector<std::vector<uint32_t> > const &buckets;
+                    };
+
+                    // hash and displace: buckets with several keys are placed first by searching a displacement
+                    // that moves all of them to free slots, then single keys are put to the remaining slots
+                    static void place( std::vector<key_hasher> const &hashes,
+                                       std::vector<std::vector<uint32_t> > const &members,
+                                       std::vector<int32_t> &displacements,
+                                       std::vector<uint32_t> &slots)
+                    {
+                        uint32_t count = static_cast<uint32_t>(slots.size());
+                        std::vector<uint32_t> order;
+                        for(uint32_t b=0;b<members.size();b++) {
+                            if(!members[b].empty())
+                                order.push_back(b);
+                        }
+                        std::stable_sort(order.begin(),order.end(),bigger_bucket(members));
+                        size_t i = 0;
+                        std::vector<uint32_t> tried;
+                        for(;i<order.size() && members[order[i]].size() > 1;i++) {
+                            std::vector<uint32_t> const &keys = members[order[i]];
+                            for(size_t k=1;k<keys.size();k++) {
+                                for(size_t j=0;j<k;j++) {
+                                    if(hashes[keys[k]].second == hashes[keys[j]].second)
+                                        throw std::runtime_error("Failed to create perfect hash for message catalog");
+                                }
+                            }
+                            uint32_t d;
+                            for(d=1;d < 0x7FFFFFFFU;d++) {
+                                tried.clear();
+                                size_t k;
+                                for(k=0;k<keys.size();k++) {
+                                    uint32_t slot = hashes[keys[k]].slot(d,count);
+                                    if(slots[slot] != illegal || std::find(tried.begin(),tried.end(),slot) != tried.end())
+                                        break;
+                                    tried.push_back(slot);
+                                }
+                                if(k == keys.size())
+                                    break;
+                            }
+                            if(d == 0x7FFFFFFFU)
+                                throw std::runtime_error("Failed to create perfect hash for message catalog");
+                            for(size_t k=0;k<keys.size();k++)
+                                slots[tried[k]] = keys[k];
+                            displacements[order[i]] = static_cast<int32_t>(d);
+                        }
+                        uint32_t free_slot = 0;
+                        for(;i<order.size();i++) {
+                            while(slots[free_slot] != illegal)
+                                free_slot++;
+                            slots[free_slot] = members[order[i]][0];
+                            displacements[order[i]] = -static_cast<int32_t>(free_slot) - 1;
+                        }
+                    }
+
+                    map_type messages_;
+                    std::string plural_;
+                };
+
+            } // compiled
+        } // gnu_gettext
+    } // locale
+} // boost
+
+#endif
+// vim: tabstop=4 expandtab shiftwidth=4 softtabstop=4
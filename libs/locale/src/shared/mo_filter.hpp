@@ -0,0 +1,112 @@
+//
+//  Copyright (c) 2009-2011 Artyom Beilis (Tonkikh)
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef BOOST_SRC_LOCALE_MO_FILTER_HPP_INCLUDED
+#define BOOST_SRC_LOCALE_MO_FILTER_HPP_INCLUDED
+
+#include <boost/cstdint.hpp>
+#include <vector>
+
+namespace boost {
+    namespace locale {
+        namespace gnu_gettext {
+
+            ///
+            /// Bloom filter over the hashes of the keys of a catalog, used to reject the keys that
+            /// are not in the catalog before walking the probe sequence of its hash table.
+            ///
+            /// All the bits of a key are kept in a single 64 bit word, so a query costs one memory access.
+            /// With 16 bits per key about 1% of missing keys pass the filter.
+            ///
+            class key_filter {
+            public:
+                static const unsigned bits_per_key = 16;
+                static const unsigned bits_per_hash = 4;
+
+                key_filter() :
+                    mask_(0)
+                {
+                }
+
+                ///
+                /// Prepare an empty filter for \a keys keys
+                ///
+                void reset(size_t keys)
+                {
+                    size_t words = 1;
+                    while(words * 64 < keys * bits_per_key)
+                        words <<= 1;
+                    std::vector<uint64_t>(words,0).swap(words_);
+                    mask_ = words - 1;
+                }
+
+                void add(uint32_t hash)
+                {
+                    if(words_.empty())
+                        return;
+                    uint32_t h = mix(hash);
+                    words_[h & mask_] |= pattern(mix(h));
+                }
+
+                ///
+                /// Returns false if the key with \a hash was certainly not added to the filter. Empty filter
+                /// passes all keys.
+                ///
+                bool may_contain(uint32_t hash) const
+                {
+                    if(words_.empty())
+                        return true;
+                    uint32_t h = mix(hash);
+                    uint64_t p = pattern(mix(h));
+                    return (words_[h & mask_] & p) == p;
+                }
+
+                bool empty() const
+                {
+                    return words_.empty();
+                }
+
+                ///
+                /// Memory used by the filter in bytes
+                ///
+                size_t memory() const
+                {
+                    return words_.size() * sizeof(uint64_t);
+                }
+
+            private:
+                // spread the bits of weak key hashes, finalizer of MurmurHash3
+                static uint32_t mix(uint32_t h)
+                {
+                    h ^= h >> 16;
+                    h *= 0x85ebca6bU;
+                    h ^= h >> 13;
+                    h *= 0xc2b2ae35U;
+                    h ^= h >> 16;
+                    return h;
+                }
+
+                static uint64_t pattern(uint32_t h)
+                {
+                    uint64_t p = 0;
+                    for(unsigned i=0;i<bits_per_hash;i++) {
+                        p |= uint64_t(1) << (h & 63);
+                        h >>= 6;
+                    }
+                    return p;
+                }
+
+                std::vector<uint64_t> words_;
+                size_t mask_;
+            };
+
+        } // gnu_gettext
+     } // locale
+} // boost
+
+#endif
+// vim: tabstop=4 expandtab shiftwidth=4 softtabstop=4
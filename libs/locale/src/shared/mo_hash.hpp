@@ -38,6 +38,38 @@ namespace boost {
                         value = update_state(value,*begin++);
                     return value;
                 }
+
+                ///
+                /// Hash wide strings by code units, for char it gives exactly the same results as
+                /// the byte oriented functions above
+                ///
+                template<typename CharType>
+                static state_type update_unit(state_type value,CharType c)
+                {
+                    value = (value << 4) + static_cast<uint32_t>(c);
+                    uint32_t high = (value & 0xF0000000U);
+                    if(high!=0)
+                        value = (value ^ (high >> 24)) ^ high;
+                    return value;
+                }
+                static state_type update_unit(state_type value,char c)
+                {
+                    return update_state(value,c);
+                }
+                template<typename CharType>
+                static state_type update_units(state_type value,CharType const *ptr)
+                {
+                    while(*ptr)
+                        value = update_unit(value,*ptr++);
+                    return value;
+                }
+                template<typename CharType>
+                static state_type update_units(state_type value,CharType const *begin,CharType const *end)
+                {
+                    while(begin!=end)
+                        value = update_unit(value,*begin++);
+                    return value;
+                }
             };
 
             inline pj_winberger_hash::state_type pj_winberger_hash_function(char const *ptr)
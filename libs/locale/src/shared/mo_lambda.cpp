@@ -8,6 +8,7 @@
 #include "mo_lambda.hpp"
 #include <string.h>
 #include <stdlib.h>
+#include <string>
 
 namespace boost {
 namespace locale {
@@ -15,216 +16,50 @@ namespace gnu_gettext {
 namespace lambda {
 
 namespace { // anon
-    struct identity : public plural {
-        virtual int operator()(int n) const 
-        {
-            return n;
-        };
-        virtual identity *clone() const
-        {
-            return new identity();
-        }
-    };
-
-    struct unary : public plural 
-    {
-        unary(plural_ptr ptr) : 
-            op1(ptr)
-        {
-        }
-    protected:
-        plural_ptr op1;
-    };
-
-
-    struct binary : public plural 
-    {
-        binary(plural_ptr p1,plural_ptr p2) :
-            op1(p1),
-            op2(p2)
-        {
-        }
-    protected:
-        plural_ptr op1,op2;
-    };
-
-    struct number : public plural
-    {
-        number(int v) : 
-            val(v)
-        {
-        }
-        virtual int operator()(int /*n*/) const 
-        {
-            return val;
-        }
-        virtual number *clone() const
-        {
-            return new number(val);
-        }
-
-    private:
-        int val;
-    };
-
-    #define UNOP(name,oper)                         \
-    struct name: public unary {                     \
-        name(plural_ptr op) : unary(op)             \
-        {                                           \
-        };                                          \
-        virtual int operator()(int n) const         \
-        {                                           \
-            return oper (*op1)(n);                  \
-        }                                           \
-        virtual name *clone() const                 \
-        {                                           \
-            plural_ptr op1_copy(op1->clone());      \
-            return new name(op1_copy);              \
-        }                                           \
-    };
-
-    #define BINOP(name,oper)                        \
-    struct name : public binary                     \
-    {                                               \
-        name(plural_ptr p1,plural_ptr p2) :         \
-            binary(p1,p2)                           \
-        {                                           \
-        }                                           \
-                                                    \
-        virtual int operator()(int n) const         \
-        {                                           \
-            return (*op1)(n) oper (*op2)(n);        \
-        }                                           \
-        virtual name *clone() const                 \
-        {                                           \
-            plural_ptr op1_copy(op1->clone());      \
-            plural_ptr op2_copy(op2->clone());      \
-            return new name(op1_copy,op2_copy);     \
-        }                                           \
-    };
-
-    #define BINOPD(name,oper)                       \
-    struct name : public binary {                   \
-        name(plural_ptr p1,plural_ptr p2) :         \
-            binary(p1,p2)                           \
-        {                                           \
-        }                                           \
-        virtual int operator()(int n) const         \
-        {                                           \
-            int v1=(*op1)(n);                       \
-            int v2=(*op2)(n);                       \
-            return v2==0 ? 0 : v1 oper v2;          \
-        }                                           \
-        virtual name *clone() const                 \
-        {                                           \
-            plural_ptr op1_copy(op1->clone());      \
-            plural_ptr op2_copy(op2->clone());      \
-            return new name(op1_copy,op2_copy);     \
-        }                                           \
-    };
 
     enum { END = 0 , SHL = 256,  SHR, GTE,LTE, EQ, NEQ, AND, OR, NUM, VARIABLE };
 
-    UNOP(l_not,!)
-    UNOP(minus,-)
-    UNOP(bin_not,~)
-
-    BINOP(mul,*)
-    BINOPD(div,/)
-    BINOPD(mod,%)
     static int level10[]={3,'*','/','%'};
-
-    BINOP(add,+)
-    BINOP(sub,-)
     static int level9[]={2,'+','-'};
-
-    BINOP(shl,<<)
-    BINOP(shr,>>)
     static int level8[]={2,SHL,SHR};
-
-    BINOP(gt,>)
-    BINOP(lt,<)
-    BINOP(gte,>=)
-    BINOP(lte,<=)
     static int level7[]={4,'<','>',GTE,LTE};
-
-    BINOP(eq,==)
-    BINOP(neq,!=)
     static int level6[]={2,EQ,NEQ};
-
-    BINOP(bin_and,&)
     static int level5[]={1,'&'};
-
-    BINOP(bin_xor,^)
     static int level4[]={1,'^'};
-
-    BINOP(bin_or,|)
     static int level3[]={1,'|'};
-
-    BINOP(l_and,&&)
     static int level2[]={1,AND};
-
-    BINOP(l_or,||)
     static int level1[]={1,OR};
 
-    struct conditional : public plural {
-        conditional(plural_ptr p1,plural_ptr p2,plural_ptr p3) :
-             op1(p1),
-             op2(p2),
-             op3(p3)
-        {
-        }
-        virtual int operator()(int n) const
-        {
-            return (*op1)(n) ? (*op2)(n) : (*op3)(n);
-        }
-        virtual conditional *clone() const                 
-        {                                           
-            plural_ptr op1_copy(op1->clone());      
-            plural_ptr op2_copy(op2->clone());      
-            plural_ptr op3_copy(op3->clone());      
-            return new conditional(op1_copy,op2_copy,op3_copy);     
-        }                                           
-    private:
-        plural_ptr op1,op2,op3;
-    };
-
-
-    plural_ptr bin_factory(int value,plural_ptr left,plural_ptr right)
+    plural::opcode bin_opcode(int value)
     {
-
         switch(value) {
-        case '/':  return plural_ptr(new div(left,right));
-        case '*':  return plural_ptr(new mul(left,right));
-        case '%':  return plural_ptr(new mod(left,right));
-        case '+':  return plural_ptr(new add(left,right));
-        case '-':  return plural_ptr(new sub(left,right));
-        case SHL:  return plural_ptr(new shl(left,right));
-        case SHR:  return plural_ptr(new shr(left,right));
-        case '>':  return plural_ptr(new  gt(left,right));
-        case '<':  return plural_ptr(new  lt(left,right));
-        case GTE:  return plural_ptr(new gte(left,right));
-        case LTE:  return plural_ptr(new lte(left,right));
-        case  EQ:  return plural_ptr(new  eq(left,right));
-        case NEQ:  return plural_ptr(new neq(left,right));
-        case '&':  return plural_ptr(new bin_and(left,right));
-        case '^':  return plural_ptr(new bin_xor(left,right));
-        case '|':  return plural_ptr(new bin_or (left,right));
-        case AND:  return plural_ptr(new l_and(left,right));
-        case  OR:  return plural_ptr(new l_or(left,right));
-        default:
-            return plural_ptr();
+        case '/':  return plural::op_div;
+        case '*':  return plural::op_mul;
+        case '%':  return plural::op_mod;
+        case '+':  return plural::op_add;
+        case '-':  return plural::op_sub;
+        case SHL:  return plural::op_shl;
+        case SHR:  return plural::op_shr;
+        case '>':  return plural::op_gt;
+        case '<':  return plural::op_lt;
+        case GTE:  return plural::op_gte;
+        case LTE:  return plural::op_lte;
+        case  EQ:  return plural::op_eq;
+        case NEQ:  return plural::op_neq;
+        case '&':  return plural::op_bin_and;
+        case '^':  return plural::op_bin_xor;
+        case '|':  return plural::op_bin_or;
+        case AND:  return plural::op_and;
+        default:   return plural::op_or;
         }
     }
 
-    plural_ptr un_factory(int value,plural_ptr op)
+    plural::opcode un_opcode(int value)
     {
         switch(value) {
-        case '!': return plural_ptr(new l_not(op));
-        case '~': return plural_ptr(new bin_not(op));
-        case '-': return plural_ptr(new minus(op));
-        default:
-            return plural_ptr();
+        case '!': return plural::op_not;
+        case '~': return plural::op_bin_not;
+        default:  return plural::op_minus;
         }
     }
 
@@ -291,77 +126,96 @@ namespace { // anon
 
 
     #define BINARY_EXPR(expr,hexpr,list)                            \
-        plural_ptr expr()                                           \
+        bool expr()                                                 \
         {                                                           \
-            plural_ptr op1,op2;                                     \
-            if((op1=hexpr()).get()==0)                              \
-                return plural_ptr();                                \
+            if(!hexpr())                                            \
+                return false;                                       \
             while(is_in(t.next(),list)) {                           \
                 int o=t.get();                                      \
-                if((op2=hexpr()).get()==0)                          \
-                    return plural_ptr();                            \
-                op1=bin_factory(o,op1,op2);                         \
+                if(!hexpr())                                        \
+                    return false;                                   \
+                emit(bin_opcode(o));                                \
             }                                                       \
-            return op1;                                             \
+            return true;                                            \
         }
 
+    ///
+    /// Recursive descent parser that writes the program directly while parsing,
+    /// tracking the depth of the evaluation stack
+    ///
     class parser {
     public:
 
-        parser(tokenizer &tin) : t(tin) {};
+        parser(tokenizer &tin,plural &code) : 
+            t(tin),
+            code_(code),
+            depth_(0)
+        {
+        }
 
-        plural_ptr compile()
+        bool compile()
         {
-            plural_ptr res=cond_expr();
-            if(res.get() && t.next()!=END) {
-                return plural_ptr();
-            };
-            return res;
+            code_.clear();
+            if(!cond_expr() || t.next()!=END) {
+                code_.clear();
+                return false;
+            }
+            return true;
         }
 
     private:
 
-        plural_ptr value_expr()
+        int emit(plural::opcode op,int value = 0)
+        {
+            switch(op) {
+            case plural::push_n:
+            case plural::push_value:
+                code_.stack_depth(++depth_);
+                break;
+            case plural::jump:
+            case plural::op_not:
+            case plural::op_minus:
+            case plural::op_bin_not:
+                break;
+            default: // binary operators and conditional jump consume a value
+                depth_--;
+            }
+            return code_.emit(op,value);
+        }
+
+        bool value_expr()
         {
-            plural_ptr op;
             if(t.next()=='(') {
                 t.get();
-                if((op=cond_expr()).get()==0)
-                    return plural_ptr();
+                if(!cond_expr())
+                    return false;
                 if(t.get()!=')')
-                    return plural_ptr();
-                return op;
+                    return false;
+                return true;
             }
             else if(t.next()==NUM) {
                 int value;
                 t.get(&value);
-                return plural_ptr(new number(value));
+                emit(plural::push_value,value);
+                return true;
             }
             else if(t.next()==VARIABLE) {
                 t.get();
-                return plural_ptr(new identity());
+                emit(plural::push_n);
+                return true;
             }
-            return plural_ptr();
+            return false;
         };
 
-        plural_ptr un_expr()
+        bool un_expr()
         {
-            plural_ptr op1;
             static int level_unary[]={3,'-','!','~'};
             if(is_in(t.next(),level_unary)) {
                 int op=t.get();
-                if((op1=un_expr()).get()==0) 
-                    return plural_ptr();
-                switch(op) {
-                case '-': 
-                    return plural_ptr(new minus(op1));
-                case '!': 
-                    return plural_ptr(new l_not(op1));
-                case '~': 
-                    return plural_ptr(new bin_not(op1));
-                default:
-                    return plural_ptr();
-                }
+                if(!un_expr())
+                    return false;
+                emit(un_opcode(op));
+                return true;
             }
             else {
                 return value_expr();
@@ -379,37 +233,219 @@ namespace { // anon
         BINARY_EXPR(l2,l3,level2);
         BINARY_EXPR(l1,l2,level1);
 
-        plural_ptr cond_expr()
+        bool cond_expr()
         {
-            plural_ptr cond,case1,case2;
-            if((cond=l1()).get()==0)
-                return plural_ptr();
-            if(t.next()=='?') {
-                t.get();
-                if((case1=cond_expr()).get()==0)
-                    return plural_ptr();
-                if(t.get()!=':')
-                    return plural_ptr();
-                if((case2=cond_expr()).get()==0)
-                    return plural_ptr();
-            }
-            else {
-                return cond;
-            }
-            return plural_ptr(new conditional(cond,case1,case2));
+            if(!l1())
+                return false;
+            if(t.next()!='?')
+                return true;
+            t.get();
+            int to_else = emit(plural::jump_if_zero);
+            int depth = depth_;
+            if(!cond_expr())
+                return false;
+            if(t.get()!=':')
+                return false;
+            int to_end = emit(plural::jump);
+            code_.patch(to_else);
+            depth_ = depth;
+            if(!cond_expr())
+                return false;
+            code_.patch(to_end);
+            return true;
         }
 
         tokenizer &t;
+        plural &code_;
+        int depth_;
+    };
 
+    //
+    // Well known formulas from the gettext manual, written exactly as the
+    // expressions so the results are identical to the evaluated program
+    //
+
+    int plural_none(int /*n*/)
+    {
+        return 0;
+    }
+    int plural_germanic(int n)
+    {
+        return n!=1;
+    }
+    int plural_french(int n)
+    {
+        return n>1;
+    }
+    int plural_latvian(int n)
+    {
+        return n%10==1 && n%100!=11 ? 0 : n!=0 ? 1 : 2;
+    }
+    int plural_irish(int n)
+    {
+        return n==1 ? 0 : n==2 ? 1 : 2;
+    }
+    int plural_romanian(int n)
+    {
+        return n==1 ? 0 : (n==0 || (n%100>0 && n%100<20)) ? 1 : 2;
+    }
+    int plural_lithuanian(int n)
+    {
+        return n%10==1 && n%100!=11 ? 0 : n%10>=2 && (n%100<10 || n%100>=20) ? 1 : 2;
+    }
+    int plural_russian(int n)
+    {
+        return n%10==1 && n%100!=11 ? 0 : n%10>=2 && n%10<=4 && (n%100<10 || n%100>=20) ? 1 : 2;
+    }
+    int plural_czech(int n)
+    {
+        return n==1 ? 0 : (n>=2 && n<=4) ? 1 : 2;
+    }
+    int plural_polish(int n)
+    {
+        return n==1 ? 0 : n%10>=2 && n%10<=4 && (n%100<10 || n%100>=20) ? 1 : 2;
+    }
+    int plural_slovenian(int n)
+    {
+        return n%100==1 ? 0 : n%100==2 ? 1 : n%100==3 || n%100==4 ? 2 : 3;
+    }
+    int plural_arabic(int n)
+    {
+        return n==0 ? 0 : n==1 ? 1 : n==2 ? 2 : n%100>=3 && n%100<=10 ? 3 : n%100>=11 ? 4 : 5;
+    }
+    int plural_icelandic(int n)
+    {
+        return n%10!=1 || n%100==11;
+    }
+
+    struct known_formula {
+        char const *expression;
+        plural::function_type function;
+    };
+
+    // expressions are stored without blanks and without enclosing parentheses
+    known_formula const known_formulas[] = {
+        { "0", plural_none },
+        { "n!=1", plural_germanic },
+        { "n>1", plural_french },
+        { "n%10==1&&n%100!=11?0:n!=0?1:2", plural_latvian },
+        { "n==1?0:n==2?1:2", plural_irish },
+        { "n==1?0:(n==0||(n%100>0&&n%100<20))?1:2", plural_romanian },
+        { "n%10==1&&n%100!=11?0:n%10>=2&&(n%100<10||n%100>=20)?1:2", plural_lithuanian },
+        { "n%10==1&&n%100!=11?0:n%10>=2&&n%10<=4&&(n%100<10||n%100>=20)?1:2", plural_russian },
+        { "(n==1)?0:(n>=2&&n<=4)?1:2", plural_czech },
+        { "n==1?0:(n>=2&&n<=4)?1:2", plural_czech },
+        { "n==1?0:n>=2&&n<=4?1:2", plural_czech },
+        { "n==1?0:n%10>=2&&n%10<=4&&(n%100<10||n%100>=20)?1:2", plural_polish },
+        { "n%100==1?0:n%100==2?1:n%100==3||n%100==4?2:3", plural_slovenian },
+        { "n==0?0:n==1?1:n==2?2:n%100>=3&&n%100<=10?3:n%100>=11?4:5", plural_arabic },
+        { "n%10!=1||n%100==11", plural_icelandic }
     };
 
+    std::string normalize(char const *str)
+    {
+        std::string expr;
+        for(;*str;str++) {
+            if(*str!=' ' && *str!='\t' && *str!='\r' && *str!='\n')
+                expr+=*str;
+        }
+        // strip parentheses that enclose the whole expression
+        while(expr.size() >= 2 && expr[0]=='(' && expr[expr.size()-1]==')') {
+            int level = 0;
+            size_t i;
+            for(i=0;i<expr.size()-1;i++) {
+                if(expr[i]=='(') 
+                    level++;
+                else if(expr[i]==')' && --level==0)
+                    break;
+            }
+            if(i!=expr.size()-1)
+                break;
+            expr=expr.substr(1,expr.size()-2);
+        }
+        return expr;
+    }
+
+    plural::function_type recognize(char const *str)
+    {
+        std::string expr = normalize(str);
+        for(unsigned i=0;i<sizeof(known_formulas)/sizeof(known_formulas[0]);i++) {
+            if(expr == known_formulas[i].expression)
+                return known_formulas[i].function;
+        }
+        return 0;
+    }
+
 } // namespace anon
 
-plural_ptr compile(char const *str)
+int plural::emit(opcode op,int value)
+{
+    instruction ins;
+    ins.op = op;
+    ins.value = value;
+    code_.push_back(ins);
+    return size() - 1;
+}
+
+int plural::evaluate(int n) const
+{
+    int small_stack[small_stack_size];
+    std::vector<int> large_stack;
+    int *stack = small_stack;
+    if(stack_size_ > small_stack_size) {
+        large_stack.resize(stack_size_);
+        stack = &large_stack[0];
+    }
+    int sp = -1; // top of the stack
+    int pc = 0;
+    int size = this->size();
+    while(pc < size) {
+        instruction const &ins = code_[pc++];
+        switch(ins.op) {
+        case push_n:        stack[++sp] = n; continue;
+        case push_value:    stack[++sp] = ins.value; continue;
+        case jump:          pc = ins.value; continue;
+        case jump_if_zero:  if(stack[sp--]==0) pc = ins.value; continue;
+        case op_not:        stack[sp] = !stack[sp]; continue;
+        case op_minus:      stack[sp] = -stack[sp]; continue;
+        case op_bin_not:    stack[sp] = ~stack[sp]; continue;
+        default:
+            ;
+        }
+        int v2 = stack[sp--];
+        int &v1 = stack[sp];
+        switch(ins.op) {
+        case op_mul:        v1 = v1 * v2; break;
+        case op_div:        v1 = v2 == 0 ? 0 : v1 / v2; break;
+        case op_mod:        v1 = v2 == 0 ? 0 : v1 % v2; break;
+        case op_add:        v1 = v1 + v2; break;
+        case op_sub:        v1 = v1 - v2; break;
+        case op_shl:        v1 = v1 << v2; break;
+        case op_shr:        v1 = v1 >> v2; break;
+        case op_gt:         v1 = v1 > v2; break;
+        case op_lt:         v1 = v1 < v2; break;
+        case op_gte:        v1 = v1 >= v2; break;
+        case op_lte:        v1 = v1 <= v2; break;
+        case op_eq:         v1 = v1 == v2; break;
+        case op_neq:        v1 = v1 != v2; break;
+        case op_bin_and:    v1 = v1 & v2; break;
+        case op_bin_xor:    v1 = v1 ^ v2; break;
+        case op_bin_or:     v1 = v1 | v2; break;
+        case op_and:        v1 = v1 && v2; break;
+        case op_or:         v1 = v1 || v2; break;
+        }
+    }
+    return sp >= 0 ? stack[sp] : 0;
+}
+
+plural compile(char const *str)
 {
+    plural result;
     tokenizer t(str);
-    parser p(t);
-    return p.compile();
+    parser p(t,result);
+    if(p.compile())
+        result.function(recognize(str));
+    return result;
 }
 
 
@@ -8,31 +8,148 @@
 #ifndef BOOST_SRC_LOCALE_MO_LAMBDA_HPP_INCLUDED
 #define BOOST_SRC_LOCALE_MO_LAMBDA_HPP_INCLUDED
 
-#include <memory>
+#include <vector>
 
 namespace boost {
     namespace locale {
         namespace gnu_gettext {
             namespace lambda {
-                
-                struct plural {
 
-                    virtual int operator()(int n) const = 0;
-                    virtual plural *clone() const = 0;
-                    virtual ~plural()
+                ///
+                /// Compiled plural forms expression.
+                ///
+                /// The expression is kept as a flat stack machine program evaluated in a single loop,
+                /// and the well known formulas are mapped to hand written functions. The program grows
+                /// with the expression, the evaluation does not allocate memory unless the expression
+                /// needs more than small_stack_size values on the stack.
+                ///
+                class plural {
+                public:
+                    typedef int (*function_type)(int n);
+
+                    enum opcode {
+                        push_n,
+                        push_value,
+                        jump,
+                        jump_if_zero,
+                        op_not,
+                        op_minus,
+                        op_bin_not,
+                        op_mul,
+                        op_div,
+                        op_mod,
+                        op_add,
+                        op_sub,
+                        op_shl,
+                        op_shr,
+                        op_gt,
+                        op_lt,
+                        op_gte,
+                        op_lte,
+                        op_eq,
+                        op_neq,
+                        op_bin_and,
+                        op_bin_xor,
+                        op_bin_or,
+                        op_and,
+                        op_or
+                    };
+
+                    static const int small_stack_size = 32;
+
+                    plural() :
+                        stack_size_(0),
+                        function_(0)
                     {
                     }
-                };
 
-                typedef std::auto_ptr<plural> plural_ptr;
+                    ///
+                    /// Check if the expression is not valid or not set
+                    ///
+                    bool empty() const
+                    {
+                        return code_.empty();
+                    }
 
-                plural_ptr compile(char const *c_expression);
+                    ///
+                    /// Check if the expression was recognized as one of the well known formulas
+                    ///
+                    bool recognized() const
+                    {
+                        return function_ != 0;
+                    }
 
-            } // lambda 
+                    int operator()(int n) const
+                    {
+                        if(function_)
+                            return function_(n);
+                        return evaluate(n);
+                    }
+
+                    ///
+                    /// Run the compiled program even if the expression was recognized
+                    ///
+                    int evaluate(int n) const;
+
+                    ///
+                    /// Add instruction, returns its position
+                    ///
+                    int emit(opcode op,int value = 0);
+
+                    ///
+                    /// Set target of the jump at \a position to the end of the program
+                    ///
+                    void patch(int position)
+                    {
+                        code_[position].value = size();
+                    }
+
+                    int size() const
+                    {
+                        return static_cast<int>(code_.size());
+                    }
+
+                    ///
+                    /// Make sure the evaluation stack can hold \a depth values
+                    ///
+                    void stack_depth(int depth)
+                    {
+                        if(depth > stack_size_)
+                            stack_size_ = depth;
+                    }
+
+                    void clear()
+                    {
+                        code_.clear();
+                        stack_size_ = 0;
+                        function_ = 0;
+                    }
+
+                    void function(function_type f)
+                    {
+                        function_ = f;
+                    }
+
+                private:
+                    struct instruction {
+                        int op;
+                        int value;
+                    };
+
+                    std::vector<instruction> code_;
+                    int stack_size_;
+                    function_type function_;
+                };
+
+                ///
+                /// Compile the expression, returns empty plural if it is not valid
+                ///
+                plural compile(char const *c_expression);
+
+            } // lambda
         } // gnu_gettext
-     } // locale 
+     } // locale
 } // boost
 
 #endif
-// vim: tabstop=4 expandtab shiftwidth=4 softtabstop=4 
-
+// vim: tabstop=4 expandtab shiftwidth=4 softtabstop=4
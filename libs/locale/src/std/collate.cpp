@@ -26,19 +26,19 @@ public:
     }
     virtual int do_compare(char const *lb,char const *le,char const *rb,char const *re) const
     {
-        std::wstring l=conv::to_utf<wchar_t>(lb,le,"UTF-8");
-        std::wstring r=conv::to_utf<wchar_t>(rb,re,"UTF-8");
+        std::wstring l=conv::utf_to_utf<wchar_t>(lb,le);
+        std::wstring r=conv::utf_to_utf<wchar_t>(rb,re);
         return std::use_facet<wfacet>(base_).compare(   l.c_str(),l.c_str()+l.size(),
                                                         r.c_str(),r.c_str()+r.size());
     }
     virtual long do_hash(char const *b,char const *e) const
     {
-        std::wstring tmp=conv::to_utf<wchar_t>(b,e,"UTF-8");
+        std::wstring tmp=conv::utf_to_utf<wchar_t>(b,e);
         return std::use_facet<wfacet>(base_).hash(tmp.c_str(),tmp.c_str()+tmp.size());
     }
     virtual std::string do_transform(char const *b,char const *e) const
     {
-        std::wstring tmp=conv::to_utf<wchar_t>(b,e,"UTF-8");
+        std::wstring tmp=conv::utf_to_utf<wchar_t>(b,e);
         std::wstring wkey = 
             std::use_facet<wfacet>(base_).transform(tmp.c_str(),tmp.c_str()+tmp.size());
         std::string key;
@@ -82,7 +82,7 @@ public:
         case lower_case:
         case case_folding:
             {
-                std::wstring tmp = conv::to_utf<wchar_t>(begin,end,"UTF-8");
+                std::wstring tmp = conv::utf_to_utf<wchar_t>(begin,end);
                 wctype_type const &ct=std::use_facet<wctype_type>(base_);
                 size_t len = tmp.size();
                 std::vector<wchar_t> res(len+1,0);
@@ -92,7 +92,7 @@ public:
                     ct.toupper(lbegin,lbegin+len);
                 else
                     ct.tolower(lbegin,lbegin+len);
-                return conv::from_utf<wchar_t>(lbegin,lbegin+len,"UTF-8");
+                return conv::utf_to_utf<char>(lbegin,lbegin+len);
             }
         default:
             return std::string(begin,end-begin);
@@ -55,7 +55,7 @@ public:
         wtmps.imbue(base_);
         std::use_facet<std::time_put<wchar_t> >(base_).put(wtmps,wtmps,wchar_t(fill),tm,wchar_t(format),wchar_t(modifier));
         std::wstring wtmp=wtmps.str();
-        std::string const tmp = conv::from_utf<wchar_t>(wtmp,"UTF-8");
+        std::string const tmp = conv::utf_to_utf<char>(wtmp);
         for(unsigned i=0;i<tmp.size();i++) {
             *out++ = tmp[i];
         }
@@ -72,8 +72,8 @@ public:
         typedef std::numpunct<wchar_t> wfacet_type;
         wfacet_type const &wfacet = std::use_facet<wfacet_type>(base);
         
-        truename_ = conv::from_utf<wchar_t>(wfacet.truename(),"UTF-8");
-        falsename_ = conv::from_utf<wchar_t>(wfacet.falsename(),"UTF-8");
+        truename_ = conv::utf_to_utf<char>(wfacet.truename());
+        falsename_ = conv::utf_to_utf<char>(wfacet.falsename());
         
         wchar_t tmp_decimal_point = wfacet.decimal_point();
         wchar_t tmp_thousands_sep = wfacet.thousands_sep();
@@ -142,9 +142,9 @@ public:
         typedef std::moneypunct<wchar_t,Intl> wfacet_type;
         wfacet_type const &wfacet = std::use_facet<wfacet_type>(base);
 
-        curr_symbol_ = conv::from_utf<wchar_t>(wfacet.curr_symbol(),"UTF-8");
-        positive_sign_ = conv::from_utf<wchar_t>(wfacet.positive_sign(),"UTF-8");
-        negative_sign_ = conv::from_utf<wchar_t>(wfacet.negative_sign(),"UTF-8");
+        curr_symbol_ = conv::utf_to_utf<char>(wfacet.curr_symbol());
+        positive_sign_ = conv::utf_to_utf<char>(wfacet.positive_sign());
+        negative_sign_ = conv::utf_to_utf<char>(wfacet.negative_sign());
         frac_digits_ = wfacet.frac_digits();
         pos_format_ = wfacet.pos_format();
         neg_format_ = wfacet.neg_format();
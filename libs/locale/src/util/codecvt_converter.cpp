@@ -8,8 +8,10 @@
 #define BOOST_LOCALE_SOURCE
 #include <boost/locale/generator.hpp>
 #include <boost/locale/encoding.hpp>
+#include <boost/locale/utf.hpp>
 
 #include "../encoding/conv.hpp"
+#include "../encoding/simple_codepage.hpp"
 
 #include <boost/locale/util.hpp>
 
@@ -51,143 +53,24 @@ namespace util {
 
         virtual uint32_t to_unicode(char const *&begin,char const *end)
         {
-            unsigned char const *p=reinterpret_cast<unsigned char const *>(begin);
-            unsigned char const *e=reinterpret_cast<unsigned char const *>(end);
-            if(p==e)
+            if(begin==end)
                 return incomplete;
-            unsigned char c=*p++;
-            unsigned char seq0,seq1=0,seq2=0,seq3=0;
-            seq0=c;
-            int len=1;
-            if((c & 0xC0) == 0xC0) {
-                if(p==e)
-                    return incomplete;
-                seq1=*p++;
-                len=2;
-            }
-            if((c & 0xE0) == 0xE0) {
-                if(p==e)
-                    return incomplete;
-                seq2=*p++;
-                len=3;
-            }
-            if((c & 0xF0) == 0xF0) {
-                if(p==e)
-                    return incomplete;
-                seq3=*p++;
-                len=4;
-            }
-            switch(len) {
-            case 1:
-                if(seq0 <= 0x7F)
-                    break;
-                return illegal;
-            case 2: // non-overloading 2 bytes
-                if( 0xC2 <= seq0 && seq0 <= 0xDF
-                    && 0x80 <= seq1 && seq1<= 0xBF)
-                {
-                        break;
-                }
-                return illegal;
-            case 3: 
-                if(seq0==0xE0) { // exclude overloading
-                    if(0xA0 <=seq1 && seq1<= 0xBF && 0x80 <=seq2 && seq2<=0xBF)
-                        break;
-                }
-                else if( (0xE1 <= seq0 && seq0 <=0xEC) || seq0==0xEE || seq0==0xEF) { // stright 3 bytes
-                    if(0x80 <=seq1 && seq1<=0xBF &&
-                       0x80 <=seq2 && seq2<=0xBF)
-                        break;
-                }
-                else if(seq0 == 0xED) { // exclude surrogates
-                    if( 0x80 <=seq1 && seq1<=0x9F &&
-                        0x80 <=seq2 && seq2<=0xBF)
-                        break;
-                }
-                return illegal;
-            case 4:
-                switch(seq0) {
-                case 0xF0: // planes 1-3
-                    if( 0x90 <=seq1 && seq1<=0xBF &&
-                        0x80 <=seq2 && seq2<=0xBF &&
-                        0x80 <=seq3 && seq3<=0xBF)
-                        break;
-                    return illegal;
-                case 0xF1: // planes 4-15
-                case 0xF2:
-                case 0xF3:
-                    if( 0x80 <=seq1 && seq1<=0xBF &&
-                        0x80 <=seq2 && seq2<=0xBF &&
-                        0x80 <=seq3 && seq3<=0xBF)
-                        break;
-                    return illegal;
-                case 0xF4: // pane 16
-                    if( 0x80 <=seq1 && seq1<=0x8F &&
-                        0x80 <=seq2 && seq2<=0xBF &&
-                        0x80 <=seq3 && seq3<=0xBF)
-                        break;
-                    return illegal;
-                default:
-                    return illegal;
-                }
-            }
-            begin=reinterpret_cast<char const *>(p);
-            switch(len) {
-            case 1:
-                return seq0;
-            case 2:
-                return ((seq0 & 0x1F) << 6) | (seq1 & 0x3F);
-            case 3:
-                return ((seq0 & 0x0F) << 12) | ((seq1 & 0x3F) << 6) | (seq2 & 0x3F)  ;
-            default: // can be only 4
-                return ((seq0 & 0x07) << 18) | ((seq1 & 0x3F) << 12) | ((seq2 & 0x3F) << 6) | (seq3 & 0x3F) ;
-            }
+            char const *p=begin;
+            utf::code_point c=utf::utf_traits<char>::decode(p,end);
+            if(c==utf::illegal || c==utf::incomplete)
+                return c;
+            begin=p;
+            return c;
         }
         virtual uint32_t from_unicode(uint32_t u,char *begin,char const *end) 
         {
-            if(u>0x10ffff)
-                return illegal;
-            if(0xd800 <=u && u<= 0xdfff) // surrogates
+            if(!utf::is_valid_codepoint(u))
                 return illegal;
-            ptrdiff_t d=end-begin;
-            if(u <=0x7F) { 
-                if(d>=1) {
-                    *begin++=u;
-                    return 1;
-                }
-                else
-                    return incomplete;
-            }
-            else if(u <= 0x7FF) {
-                if(d>=2) {
-                    *begin++=(u >> 6) | 0xC0;
-                    *begin++=(u & 0x3F) | 0x80;
-                    return 2;
-                }
-                else
-                    return incomplete;
-            }
-            else if(u <= 0xFFFF) {
-                if(d>=3) {
-                    *begin++=(u >> 12) | 0xE0;
-                    *begin++=((u >> 6) & 0x3F) | 0x80;
-                    *begin++=(u & 0x3F) | 0x80;
-                    return 3;
-                }
-                else
-                    return incomplete;
-            }
-            else {
-                if(d>=4) {
-                    *begin++=(u >> 18) | 0xF0;
-                    *begin++=((u >> 12) & 0x3F) | 0x80;
-                    *begin++=((u >> 6) & 0x3F) | 0x80;
-                    *begin++=(u & 0x3F) | 0x80;
-                    return 4;
-                }
-                else
-                    return incomplete;
-            }
+            int width=utf::utf_traits<char>::width(u);
+            if(end-begin < width)
+                return incomplete;
+            utf::utf_traits<char>::encode(u,begin);
+            return width;
         }
     }; // utf8_converter
 
@@ -198,29 +81,9 @@ namespace util {
         {
         }
 
-        simple_converter(std::string const &encoding)
+        simple_converter(conv::impl::simple_codepage const *codepage) :
+            codepage_(codepage)
         {
-            for(unsigned i=0;i<128;i++)
-                to_unicode_tbl_[i]=i;
-            for(unsigned i=128;i<256;i++) {
-                char buf[2] = { char(i) , 0 };
-                try {
-                    std::wstring const tmp = conv::to_utf<wchar_t>(buf,buf+1,encoding,conv::stop);
-                    if(tmp.size() == 1) {
-                        to_unicode_tbl_[i] = tmp[0];
-                    }
-                    else {
-                        to_unicode_tbl_[i] = illegal;
-                    }
-                }
-                catch(conv::conversion_error const &/*e*/) {
-                    to_unicode_tbl_[i] = illegal;
-                }
-            }
-            from_unicode_tbl_.resize(256);
-            for(unsigned i=0;i<256;i++) {
-                from_unicode_tbl_[to_unicode_tbl_[i] & 0xFF].push_back(i);
-            }
         }
 
         virtual int max_len() const 
@@ -241,78 +104,29 @@ namespace util {
             if(begin==end)
                 return incomplete;
             unsigned char c = *begin++;
-            return to_unicode_tbl_[c];
+            return codepage_->to_unicode(c);
         }
         virtual uint32_t from_unicode(uint32_t u,char *begin,char const *end)
         {
             if(begin==end)
                 return incomplete;
-            std::vector<unsigned char> const &tbl = from_unicode_tbl_[u & 0xFF];
-            for(std::vector<unsigned char>::const_iterator p=tbl.begin();p!=tbl.end();++p) {
-                if(to_unicode_tbl_[*p]==u) {
-                    *begin++ = *p;
-                    return 1;
-                }
-            }
-            return illegal;
+            int c = codepage_->from_unicode(u);
+            if(c < 0)
+                return illegal;
+            *begin = static_cast<char>(c);
+            return 1;
         }
     private:
-        uint32_t to_unicode_tbl_[256];
-        std::vector<std::vector<unsigned char> > from_unicode_tbl_;
+        conv::impl::simple_codepage const *codepage_;
     };
 
-    namespace {
-        char const *simple_encoding_table[] = {
-            "cp1250",
-            "cp1251",
-            "cp1252",
-            "cp1253",
-            "cp1254",
-            "cp1255",
-            "cp1256",
-            "cp1257",
-            "iso88591",
-            "iso885913",
-            "iso885915",
-            "iso88592",
-            "iso88593",
-            "iso88594",
-            "iso88595",
-            "iso88596",
-            "iso88597",
-            "iso88598",
-            "iso88599",
-            "koi8r",
-            "koi8u",
-            "usascii",
-            "windows1250",
-            "windows1251",
-            "windows1252",
-            "windows1253",
-            "windows1254",
-            "windows1255",
-            "windows1256",
-            "windows1257"
-        };
-
-        bool compare_strings(char const *l,char const *r)
-        {
-            return strcmp(l,r) < 0;
-        }
-    }
-
-    
     std::auto_ptr<base_converter> create_simple_converter(std::string const &encoding)
     {
         std::auto_ptr<base_converter> res;
         std::string norm = conv::impl::normalize_encoding(encoding.c_str());
-        if(std::binary_search<char const **>( simple_encoding_table,
-                        simple_encoding_table + sizeof(simple_encoding_table)/sizeof(char const *),
-                        norm.c_str(),
-                        compare_strings))
-        {
-            res.reset(new simple_converter(encoding));
-        }
+        conv::impl::simple_codepage const *codepage = conv::impl::get_simple_codepage(norm);
+        if(codepage)
+            res.reset(new simple_converter(codepage));
         return res;
     }
 
@@ -27,8 +27,8 @@ public:
     }
     virtual int do_compare(collator_base::level_type level,char const *lb,char const *le,char const *rb,char const *re) const
     {
-        std::wstring l=conv::to_utf<wchar_t>(lb,le,"UTF-8");
-        std::wstring r=conv::to_utf<wchar_t>(rb,re,"UTF-8");
+        std::wstring l=conv::utf_to_utf<wchar_t>(lb,le);
+        std::wstring r=conv::utf_to_utf<wchar_t>(rb,re);
         return wcscoll_l(level,l.c_str(),l.c_str()+l.size(),r.c_str(),r.c_str()+r.size(),lc_);
     }
     virtual long do_hash(collator_base::level_type level,char const *b,char const *e) const
@@ -38,7 +38,7 @@ public:
     }
     virtual std::string do_transform(collator_base::level_type level,char const *b,char const *e) const
     {
-        std::wstring tmp=conv::to_utf<wchar_t>(b,e,"UTF-8");
+        std::wstring tmp=conv::utf_to_utf<wchar_t>(b,e);
         std::wstring wkey = wcsxfrm_l(level,tmp.c_str(),tmp.c_str()+tmp.size(),lc_);
         std::string key;
         if(sizeof(wchar_t)==2)
@@ -57,7 +57,7 @@ public:
     }
     virtual std::string convert(converter_base::conversion_type how,char const *begin,char const *end,int flags = 0) const 
     {
-        std::wstring tmp = conv::to_utf<wchar_t>(begin,end,"UTF-8");
+        std::wstring tmp = conv::utf_to_utf<wchar_t>(begin,end);
         wchar_t const *wb=tmp.c_str();
         wchar_t const *we=wb+tmp.size();
 
@@ -79,7 +79,7 @@ public:
         default:
             res = tmp; // make gcc happy
         }
-        return conv::from_utf(res,"UTF-8");
+        return conv::utf_to_utf<char>(res);
     }
 private:
     winlocale lc_;
@@ -38,7 +38,7 @@ namespace impl_win {
         
         std::ostreambuf_iterator<char> write_it(std::ostreambuf_iterator<char> out,std::wstring const &s)
         {
-            std::string tmp = conv::from_utf(s,"UTF-8");
+            std::string tmp = conv::utf_to_utf<char>(s);
             for(size_t i=0;i<tmp.size();i++)
                 *out++ = tmp[i];
             return out;
@@ -145,7 +145,7 @@ public:
 
     void to_str(std::wstring &s1,std::string &s2)
     {
-        s2=conv::from_utf(s1,"UTF-8");
+        s2=conv::utf_to_utf<char>(s1);
     }
     virtual CharType do_decimal_point() const
     {
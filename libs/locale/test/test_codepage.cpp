@@ -285,6 +285,96 @@ void test_combinations()
     TEST( (utf_to_utf<CharOut,CharIn>(in::bad())==out::ok()) );
 }
 
+void test_utf8_validation()
+{
+    using namespace boost::locale::conv;
+    std::cout << "Testing UTF-8 validation" << std::endl;
+    char const *bad[] = {
+        "\xC0\xAF",           // overlong
+        "\xE0\x80\xAF",       // overlong
+        "\xF0\x80\x80\xAF",   // overlong
+        "\xED\xA0\x80",       // surrogate
+        "\xF4\x90\x80\x80",   // above 10FFFF
+        "\xF8\x88\x80\x80\x80",
+        "\x80",
+        "\xE2\x82",           // incomplete
+        "\xF0\x9F\x98",
+        0
+    };
+    for(int i=0;bad[i];i++) {
+        std::string s = std::string("abc") + bad[i] + "d";
+        TESTF(utf_to_utf<char>(s,stop));
+        TESTF(utf_to_utf<wchar_t>(s,stop));
+        TEST(utf_to_utf<char>(s)=="abcd");
+        TEST(utf_to_utf<wchar_t>(s)==L"abcd");
+    }
+    std::string ok = "\x7F\xC2\x80\xDF\xBF\xE0\xA0\x80\xEF\xBF\xBF\xF0\x90\x80\x80\xF4\x8F\xBF\xBF";
+    TEST(utf_to_utf<char>(ok,stop)==ok);
+    TEST(utf_to_utf<char>(utf_to_utf<wchar_t>(ok,stop),stop)==ok);
+
+    // non-ASCII text at every position of a long ASCII run
+    for(size_t pos=0;pos<70;pos++) {
+        std::string s(70,'x');
+        s.insert(pos,"\xD7\xA9");
+        std::wstring ws(70,L'x');
+        ws.insert(pos,1,wchar_t(0x5E9));
+        TEST(utf_to_utf<wchar_t>(s,stop)==ws);
+        TEST(utf_to_utf<char>(ws,stop)==s);
+        s[pos+1]='x';
+        TESTF(utf_to_utf<char>(s,stop));
+    }
+
+    std::cout << "Testing validate_utf8 and is_ascii" << std::endl;
+    char const *good[] = { "a", "\xD7\xA9", "\xE2\x82\xAC", "\xF0\x9F\x98\x80", "\xF4\x8F\xBF\xBF", 0 };
+    for(size_t pos=0;pos<100;pos++) {
+        for(int i=0;good[i];i++) {
+            std::string s(100,'x');
+            s.insert(pos,good[i]);
+            TEST(validate_utf8(s));
+            TEST(validate_utf8(std::string(pos,'x') + good[i]));
+        }
+        for(int i=0;bad[i];i++) {
+            std::string s(100,'x');
+            s.insert(pos,bad[i]);
+            TEST(!validate_utf8(s));
+            TEST(!validate_utf8(std::string(pos,'x') + bad[i]));
+        }
+        std::string s(100,'x');
+        TEST(is_ascii(s));
+        s.insert(pos,1,'\x80');
+        TEST(!is_ascii(s));
+        s[pos]='\xFF';
+        TEST(!is_ascii(s));
+        TEST(!is_ascii(std::string(pos,'x') + "\xC2"));
+    }
+    TEST(validate_utf8(std::string()));
+    TEST(is_ascii(std::string()));
+
+    // random text compared with decoding by code points
+    unsigned char const units[] = { 'a', 0x7F, 0x80, 0x8F, 0x90, 0x9F, 0xA0, 0xBF, 0xC0, 0xC2, 0xDF, 0xE0, 0xE1, 0xED, 0xEF, 0xF0, 0xF4, 0xF5, 0xFF };
+    unsigned seed = 1;
+    int mismatches = 0;
+    for(int n=0;n<2000;n++) {
+        seed = seed * 1103515245 + 12345;
+        std::string s((seed >> 16) % 160,'x');
+        for(size_t i=0;i<s.size();i++) {
+            seed = seed * 1103515245 + 12345;
+            unsigned r = (seed >> 16) % (sizeof(units) * 4);
+            if(r < sizeof(units))
+                s[i]=units[r];
+        }
+        bool expected = true;
+        char const *b = s.c_str(),*e = b + s.size();
+        while(b!=e && expected) {
+            boost::locale::utf::code_point c = boost::locale::utf::utf_traits<char>::decode(b,e);
+            expected = c!=boost::locale::utf::illegal && c!=boost::locale::utf::incomplete;
+        }
+        if(validate_utf8(s)!=expected)
+            mismatches++;
+    }
+    TEST(mismatches==0);
+}
+
 void test_all_combinations()
 {
     std::cout << "Testing utf_to_utf" << std::endl;
@@ -298,6 +388,52 @@ void test_all_combinations()
     test_combinations<wchar_t,wchar_t>();
 }
 
+void test_between()
+{
+    using namespace boost::locale::conv;
+    std::cout << "Testing between and converter" << std::endl;
+    std::string latin = "gr\xfc\xdf" "en";
+    std::string utf8 = "grüßen";
+    TEST(between(latin,"UTF-8","ISO8859-1")==utf8);
+    TEST(between(utf8,"ISO-8859-1","utf8")==latin);
+    TEST(between("g\xFFr","ISO8859-1","UTF-8")=="gr");
+    TESTF(between("g\xFFr","ISO8859-1","UTF-8",stop));
+    TEST(between(utf8,"ISO8859-1","UTF-8",stop)==latin);
+    TEST_THROWS(between(utf8,"ISO8859-1","no-such-charset"),invalid_charset_error);
+
+    converter to_utf8("UTF-8","ISO8859-1");
+    TEST(to_utf8.convert(latin)==utf8);
+    TEST(to_utf8.convert(latin)==utf8);
+    TEST(to_utf8.convert(std::string())=="");
+
+    converter to_latin("ISO8859-1","UTF-8",stop);
+    TESTF(to_latin.convert("g\xFFr"));
+    TEST(to_latin.convert(utf8)==latin);
+    TESTF(to_latin.convert("\xd7\xa9"));
+    TEST(to_latin.convert(utf8)==latin);
+
+    TEST_THROWS(converter("UTF-8","no-such-charset"),invalid_charset_error);
+
+    // single byte encodings
+    TEST(between("\xf0\xd2\xc9\xd7\xc5\xd4","windows-1251","KOI8-R")=="\xcf\xf0\xe8\xe2\xe5\xf2");
+    TEST(between("\xcf\xf0\xe8\xe2\xe5\xf2","UTF-8","cp1251")=="Привет");
+    TEST(between("a\x80" "b","UTF-8","windows-1252")=="a\xe2\x82\xac" "b");
+    TEST(between("a\x81" "b","UTF-8","windows-1252")=="ab");
+    TESTF(between("a\x81" "b","UTF-8","windows-1252",stop));
+    TEST(between("a\xa4" "b","ISO-8859-1","ISO-8859-15")=="ab");
+    TESTF(between("a\xa4" "b","ISO-8859-1","ISO-8859-15",stop));
+    TEST(between("\xe2\x82\xac","ISO-8859-15","UTF-8")=="\xa4");
+    TESTF(between("a\x80","US-ASCII","ISO-8859-1",stop));
+    std::string all;
+    for(int i=0;i<256;i++)
+        all+=char(i);
+    TEST(from_utf(to_utf<wchar_t>(all,"ISO-8859-5",stop),"ISO-8859-5",stop)==all);
+    TEST(between(between(all,"UTF-8","ISO-8859-1",stop),"ISO-8859-1","UTF-8",stop)==all);
+    converter to_koi8("KOI8-U","UTF-8",stop);
+    TEST(to_koi8.convert("\xd1\x97")=="\xa7");
+    TESTF(to_koi8.convert("\xd7\xa9"));
+}
+
 template<typename Char>
 void test_to()
 {
@@ -428,6 +564,8 @@ int main()
             #endif
 
             test_all_combinations();
+            test_utf8_validation();
+            test_between();
         }
     }
     catch(std::exception const &e) {
@@ -384,6 +384,39 @@ void test_format(std::string charset="UTF-8")
     FORMAT("{1}",1200.1,"1200.1");
     FORMAT("Test {1,num}",1200.1,"Test 1,200.1");
     FORMAT("{{}} {1,number}",1200.1,"{} 1,200.1");
+    FORMAT("{1}{{{1}}}}",1,"1{1}}");
+    FORMAT("{1} {2,num",1 % 2,"1 ");
+    {
+        // placeholder flags are not left on the stream
+        std::basic_ostringstream<CharType> ss;
+        ss.imbue(loc);
+        ss << boost::locale::basic_format<CharType>(to_correct_string<CharType>("{1,num=fix,p=1,<,w=3}",loc)) % 1.5;
+        ss << 7.25;
+        TESTEQ(ss.str(),to_correct_string<CharType>("1.57.25",loc));
+    }
+    {
+        std::basic_string<CharType> text = to_correct_string<CharType>("text",loc);
+        std::basic_string<CharType> result;
+        boost::locale::basic_format<CharType> fmt(to_correct_string<CharType>("{1} [{1,w=6}] {2,num}",loc));
+        (fmt % text % 1200).write(std::back_inserter(result),loc);
+        TESTEQ(result,to_correct_string<CharType>("text [  text] 1,200",loc));
+    }
+    {
+        std::basic_string<CharType> text = to_correct_string<CharType>("text",loc);
+        std::basic_string<CharType> result;
+        boost::locale::format_to(std::back_inserter(result),loc,to_correct_string<CharType>("{3} [{1,w=6}] {2,num} {4}",loc),text,1200,1);
+        TESTEQ(result,to_correct_string<CharType>("1 [  text] 1,200 ",loc));
+    }
+    {
+        // the format string is used in place, it may be longer than the text of the placeholder
+        std::basic_string<CharType> fmt = to_correct_string<CharType>("{1,num} {2}",loc);
+        std::basic_string<CharType> result;
+        boost::locale::format_to(std::back_inserter(result),loc,fmt.c_str(),1200,fmt);
+        TESTEQ(result,to_correct_string<CharType>("1,200 {1,num} {2}",loc));
+        result.clear();
+        boost::locale::format_to(std::back_inserter(result),loc,boost::locale::basic_message<CharType>(fmt.c_str()),1200,1);
+        TESTEQ(result,to_correct_string<CharType>("1,200 1",loc));
+    }
     FORMAT("{1,num=sci,p=3}",13.1,"1.310E1");
     FORMAT("{1,num=scientific,p=3}",13.1,"1.310E1");
     FORMAT("{1,num=fix,p=3}",13.1,"13.100");
@@ -13,7 +13,14 @@
 #include <boost/locale/encoding.hpp>
 #include "test_locale.hpp"
 #include "test_locale_tools.hpp"
+#include "../src/shared/mo_lambda.hpp"
+#include "../src/shared/mo_compiled.hpp"
+#include "../src/shared/mo_filter.hpp"
+#include <boost/thread/thread.hpp>
 #include <fstream>
+#include <algorithm>
+#include <iterator>
+#include <time.h>
 
 namespace bl = boost::locale;
 
@@ -40,6 +47,77 @@ struct file_loader {
     }
 };
 
+struct no_hash_file_loader {
+    std::vector<char> operator()(std::string const &name,std::string const &encoding) const
+    {
+        std::vector<char> buffer = file_loader()(name,encoding);
+        if(buffer.size() >= 24)
+            std::fill(buffer.begin() + 20,buffer.begin() + 24,0); // remove the hash table
+        return buffer;
+    }
+};
+
+bool mapped_loader_is_actually_called = false;
+
+struct mapped_loader {
+    bl::gnu_gettext::catalog_region operator()(std::string const &name,std::string const &encoding) const
+    {
+        bl::gnu_gettext::catalog_region region;
+        boost::shared_ptr<std::vector<char> > buffer(new std::vector<char>(file_loader()(name,encoding)));
+        if(buffer->empty())
+            return region;
+        region.begin = &(*buffer)[0];
+        region.end = region.begin + buffer->size();
+        region.holder = buffer;
+        mapped_loader_is_actually_called = true;
+        return region;
+    }
+};
+
+//
+// Serves he/LC_MESSAGES/<reload_source>.mo as he/default catalog, so its content can be changed
+//
+std::string reload_source = "default";
+
+struct reload_loader {
+    std::vector<char> operator()(std::string const &name,std::string const &encoding) const
+    {
+        std::string file = "/he/LC_MESSAGES/default.mo";
+        if(name.size() < file.size() || name.compare(name.size() - file.size(),file.size(),file) != 0)
+            return std::vector<char>();
+        return file_loader()(name.substr(0,name.size() - 10) + reload_source + ".mo",encoding);
+    }
+};
+
+//
+// Serves compiled catalog from memory as he/default catalog
+//
+struct memory_catalog_loader {
+    boost::shared_ptr<std::vector<char> > data;
+    bl::gnu_gettext::catalog_region operator()(std::string const &name,std::string const &/*encoding*/) const
+    {
+        bl::gnu_gettext::catalog_region region;
+        std::string file = "/he/LC_MESSAGES/default.mcat";
+        if(name.size() < file.size() || name.compare(name.size() - file.size(),file.size(),file) != 0)
+            return region;
+        region.begin = &(*data)[0];
+        region.end = region.begin + data->size();
+        region.holder = data;
+        return region;
+    }
+};
+
+memory_catalog_loader memory_catalog(bl::gnu_gettext::compiled::catalog_builder const &builder)
+{
+    memory_catalog_loader loader;
+    loader.data.reset(new std::vector<char>(builder.build()));
+    return loader;
+}
+
+std::string forms(char const *f1,char const *f2,char const *f3,char const *f4)
+{
+    return std::string(f1) + '\0' + f2 + '\0' + f3 + '\0' + f4;
+}
 
 std::string same_s(std::string s)
 {
@@ -93,6 +171,17 @@ void strings_equal(std::string n_c,std::string n_s,std::string n_p,int n,std::st
         TEST(ss.str()==expected);
     }
     TEST( bl::translate(c,s,p,n).str(l,domain)==expected );
+    {
+        string_type buffer;
+        int id = std::use_facet<bl::message_format<Char> >(l).domain(domain);
+        bl::basic_message<Char> msg = bl::translate(c,s,p,n);
+        std::pair<Char const *,Char const *> range = msg.view(l,id,buffer);
+        TEST(string_type(range.first,range.second)==expected);
+        TEST(*range.second==0);
+        string_type out = to<Char>("prefix:");
+        bl::translate(c,s,p,n).write_to(std::back_inserter(out),l,domain);
+        TEST(out==to<Char>("prefix:") + expected);
+    }
     std::locale tmp_locale=std::locale();
     std::locale::global(l);
     TEST(bl::translate(c,s,p,n).str(domain)==expected);
@@ -308,9 +397,64 @@ void test_translate(std::string original,std::string expected,std::locale const
 
 
 
+void test_plural_expressions()
+{
+    namespace lambda = boost::locale::gnu_gettext::lambda;
+
+    lambda::plural p = lambda::compile("(n==1 ? 0 : (n==2 ? 1 : (n>10 ? 3 : 2)))");
+    TEST(!p.empty() && !p.recognized());
+    TEST(p(1)==0 && p(2)==1 && p(5)==2 && p(11)==3);
+    TEST(lambda::compile("n/0 + n%0 + (-n) + (~n+n) + (5>>1) + (1<<2) + (7^2&3|8)")(3)==-3-1+2+4+13);
+    TEST(lambda::compile("n ? 1 :").empty());
+    TEST(lambda::compile("(n").empty());
+    TEST(lambda::compile("n=1").empty());
+    {
+        // longer than the program and deeper than the evaluation stack of common expressions
+        std::string deep = "n";
+        for(int i=0;i<100;i++)
+            deep = "(1 + " + deep + ")";
+        TEST(lambda::compile(deep.c_str())(5)==105);
+        std::string chain = "0";
+        for(int i=100;i>0;i--) {
+            std::ostringstream ss;
+            ss << "n==" << i << " ? " << i << " : " << chain;
+            chain = ss.str();
+        }
+        TEST(lambda::compile(chain.c_str())(77)==77);
+    }
+
+    char const *known[] = {
+        "0",
+        "n != 1",
+        "n>1",
+        "n%10==1 && n%100!=11 ? 0 : n != 0 ? 1 : 2",
+        "n==1 ? 0 : n==2 ? 1 : 2",
+        "n==1 ? 0 : (n==0 || (n%100 > 0 && n%100 < 20)) ? 1 : 2",
+        "n%10==1 && n%100!=11 ? 0 : n%10>=2 && (n%100<10 || n%100>=20) ? 1 : 2",
+        "(n%10==1 && n%100!=11 ? 0 : n%10>=2 && n%10<=4 && (n%100<10 || n%100>=20) ? 1 : 2)",
+        "(n==1) ? 0 : (n>=2 && n<=4) ? 1 : 2",
+        "n==1 ? 0 : n%10>=2 && n%10<=4 && (n%100<10 || n%100>=20) ? 1 : 2",
+        "n%100==1 ? 0 : n%100==2 ? 1 : n%100==3 || n%100==4 ? 2 : 3",
+        "n==0 ? 0 : n==1 ? 1 : n==2 ? 2 : n%100>=3 && n%100<=10 ? 3 : n%100>=11 ? 4 : 5",
+        "n%10!=1 || n%100==11"
+    };
+    for(unsigned i=0;i<sizeof(known)/sizeof(known[0]);i++) {
+        lambda::plural f = lambda::compile(known[i]);
+        TEST(f.recognized());
+        bool same = true;
+        for(int n=-10;n<=1000;n++)
+            same = same && f(n) == f.evaluate(n);
+        TEST(same);
+    }
+}
+
+
 int main(int argc,char **argv)
 {
     try {
+        std::cout << "Testing plural forms expressions" << std::endl;
+        test_plural_expressions();
+
         std::string def[] = {
         #ifdef BOOST_LOCALE_WITH_ICU
             "icu" , 
@@ -393,10 +537,166 @@ int main(int argc,char **argv)
                     test_cntranslate(inp,"x day","x days",2,"x days",l,"undefined");
                     test_cntranslate(inp,"x day","x days",20,"x days",l,"undefined");
                 }
+                std::cout << "    cached messages" << std::endl;
+                {
+                    bl::cached_message hello(bl::translate("hello"));
+                    char const *first = hello.c_str(l);
+                    TEST(first == to_correct_string<char>("שלום",l));
+                    TEST(hello.c_str(l) == first);
+                    TEST(hello.str(l) == to_correct_string<char>("שלום",l));
+                    
+                    bl::cached_message simple(bl::translate("hello"),"simple");
+                    TEST(simple.str(l) == to_correct_string<char>("היי",l));
+                    TEST(simple.str(std::locale::classic()) == "hello");
+                    TEST(simple.str(l) == to_correct_string<char>("היי",l));
+
+                    bl::wcached_message days(bl::translate(L"x day",L"x days",2));
+                    TEST(days.str(l) == to_correct_string<wchar_t>("יומיים",l));
+                    TEST(days.str(l) == to_correct_string<wchar_t>("יומיים",l));
+
+                    bl::cached_message missing(bl::translate("untranslated"));
+                    TEST(missing.str(l) == "untranslated");
+                    TEST(missing.str(l) == "untranslated");
+
+                    std::ostringstream ss;
+                    ss.imbue(l);
+                    ss << hello << "|" << bl::as::domain("simple") << hello << "|" << hello;
+                    TEST(ss.str() == to_correct_string<char>("שלום|היי|היי",l));
+                }
+                std::cout << "    domain ids" << std::endl;
+                {
+                    int simple = g.messages_domain_id("simple");
+                    TEST(g.messages_domain_id("default") == 0);
+                    TEST(simple == std::use_facet<bl::message_format<char> >(l).domain("simple"));
+                    TEST(simple == std::use_facet<bl::message_format<wchar_t> >(l).domain("simple"));
+                    TEST(g.messages_domain_id("simple/UTF-8") == simple);
+                    TEST(g.messages_domain_id("undefined") == -1);
+                    TEST(bl::translate("hello").str(l,simple) == to_correct_string<char>("היי",l));
+
+                    std::ostringstream ss;
+                    ss.imbue(l);
+                    ss << bl::translate("hello") << "|" << bl::as::domain(simple) << bl::translate("hello") << "|";
+                    ss << bl::as::domain(0) << bl::translate("hello");
+                    TEST(ss.str() == to_correct_string<char>("שלום|היי|שלום",l));
+
+                    bl::message_request req[1] = { { 0, "hello", 0, 0, false, 0 } };
+                    char const *trans[1];
+                    TEST(bl::translate_batch(l,simple,req,1,trans) == 1);
+                    TEST(trans[0] == to_correct_string<char>("היי",l));
+                    TEST(bl::translate_batch(l,-1,req,1,trans) == 0);
+                    TEST(trans[0] == std::string("hello"));
+                }
+                std::cout << "    precomputed hashes" << std::endl;
+                {
+                    TEST(BOOST_LOCALE_TRANSLATE("hello").str(l)==to_correct_string<char>("שלום",l));
+                    TEST(BOOST_LOCALE_TRANSLATE(L"hello").str(l)==to_correct_string<wchar_t>("שלום",l));
+                    TEST(BOOST_LOCALE_PTRANSLATE("context","hello").str(l)==to_correct_string<char>("שלום בהקשר אחר",l));
+                    TEST(BOOST_LOCALE_PTRANSLATE(L"context",L"hello").str(l)==to_correct_string<wchar_t>("שלום בהקשר אחר",l));
+                    TEST(BOOST_LOCALE_PTRANSLATE("","hello").str(l)==to_correct_string<char>("שלום",l));
+                    TEST(BOOST_LOCALE_NTRANSLATE("x day","x days",2).str(l)==to_correct_string<char>("יומיים",l));
+                    TEST(BOOST_LOCALE_NTRANSLATE(L"x day",L"x days",3).str(l)==to_correct_string<wchar_t>("x ימים",l));
+                    TEST(BOOST_LOCALE_NPTRANSLATE("context","x day","x days",2).str(l)==to_correct_string<char>("בהקשר יומיים",l));
+                    TEST(BOOST_LOCALE_NPTRANSLATE(L"context",L"x day",L"x days",1).str(l)==to_correct_string<wchar_t>("בהקשר יום x",l));
+                    TEST(BOOST_LOCALE_TRANSLATE("untranslated").str(l)=="untranslated");
+                    TEST(BOOST_LOCALE_NTRANSLATE("x day","x days",1).str(l,"undefined")=="x day");
+                    {
+                        #define LINE_50 "0123456789012345678901234567890123456789012345678\n"
+                        #define LINE_250 LINE_50 LINE_50 LINE_50 LINE_50 LINE_50
+                        #define LINE_1250 LINE_250 LINE_250 LINE_250 LINE_250 LINE_250
+                        std::string long_id = LINE_1250 "x";
+                        TEST(BOOST_LOCALE_MESSAGE_HASH(LINE_1250 "x").value == bl::details::message_key_hash_value(long_id.c_str()));
+                        TEST(BOOST_LOCALE_TRANSLATE(LINE_1250 "x").str(l) == long_id);
+                        #undef LINE_1250
+                        #undef LINE_250
+                        #undef LINE_50
+                    }
+                    std::ostringstream ss;
+                    ss.imbue(l);
+                    ss << bl::as::domain("simple") << BOOST_LOCALE_TRANSLATE("hello");
+                    TEST(ss.str()==to_correct_string<char>("היי",l));
+                }
+                std::cout << "    translation views" << std::endl;
+                {
+                    std::string buffer;
+                    std::pair<char const *,char const *> range = bl::translate("hello").view(l,buffer);
+                    TEST(std::string(range.first,range.second) == to_correct_string<char>("שלום",l));
+                    TEST(buffer.empty()); // points to the catalog
+                    range = bl::translate("x day").view(l,buffer); // first form of a plural entry
+                    TEST(std::string(range.first,range.second) == bl::translate("x day").str(l));
+                    TEST(*range.second == 0);
+                    std::wstring out = L"<";
+                    std::back_insert_iterator<std::wstring> it = std::back_inserter(out);
+                    it = bl::translate(L"hello").write_to(it,l);
+                    *it++ = L'>';
+                    TEST(out == L"<" + to_correct_string<wchar_t>("שלום",l) + L">");
+                }
+                std::cout << "    batch translation" << std::endl;
+                {
+                    bl::message_request const base[] = {
+                        { 0, "hello", 0, 0, false, 0 },
+                        { "context", "hello", 0, 0, false, 0 },
+                        { 0, "x day", "x days", 2, false, 0 },
+                        { "context", "x day", "x days", 1, false, 0 },
+                        { 0, "untranslated", 0, 0, false, 0 },
+                        { 0, "no day", "no days", 3, false, 0 },
+                        { "", "hello", 0, 0, true, BOOST_LOCALE_MESSAGE_HASH("hello").value }
+                    };
+                    char const *expected[] = {
+                        "שלום", "שלום בהקשר אחר", "יומיים", "בהקשר יום x", "untranslated", "no days", "שלום"
+                    };
+                    size_t const base_size = sizeof(base)/sizeof(base[0]);
+                    // more than a single group of lookups
+                    std::vector<bl::message_request> requests;
+                    for(size_t i=0;i<40;i++)
+                        requests.push_back(base[i % base_size]);
+                    std::vector<char const *> translations(requests.size());
+                    size_t found = bl::translate_batch(l,&requests[0],requests.size(),&translations[0]);
+                    TEST(found == 29); // 11 requests for "untranslated" and "no day"
+                    bool same = true;
+                    for(size_t i=0;i<requests.size();i++) {
+                        std::string exp = expected[i % base_size];
+                        if(exp.c_str()[0] & 0x80)
+                            exp = to_correct_string<char>(exp,l);
+                        same = same && translations[i] == exp;
+                    }
+                    TEST(same);
+
+                    bl::wmessage_request wreq[] = {
+                        { 0, L"hello", 0, 0, false, 0 },
+                        { 0, L"untranslated", 0, 0, false, 0 }
+                    };
+                    wchar_t const *wtrans[2];
+                    TEST(bl::translate_batch(l,"simple",wreq,2,wtrans) == 1);
+                    TEST(wtrans[0] == to_correct_string<wchar_t>("היי",l));
+                    TEST(wtrans[1] == std::wstring(L"untranslated"));
+                    TEST(bl::translate_batch(l,"undefined",wreq,2,wtrans) == 0);
+                    TEST(wtrans[0] == std::wstring(L"hello"));
+                }
             }
             std::cout << "  Testing fallbacks" <<std::endl;
             test_translate("test","he_IL",g("he_IL.UTF-8"),"full");
             test_translate("test","he",g("he_IL.UTF-8"),"fall");
+
+            std::cout << "  Testing shared catalogs" << std::endl;
+            {
+                boost::locale::generator g2;
+                g2.add_messages_domain("default");
+                if(argc==2)
+                    g2.add_messages_path(argv[1]);
+                else
+                    g2.add_messages_path("./");
+                std::locale l1 = g("he_IL.UTF-8");
+                std::locale l2 = g2("he_IL.UTF-8");
+                char const *c1 = std::use_facet<bl::message_format<char> >(l1).get(0,0,"hello");
+                char const *c2 = std::use_facet<bl::message_format<char> >(l2).get(0,0,"hello");
+                TEST(c1 && c1 == c2);
+                wchar_t const *w1 = std::use_facet<bl::message_format<wchar_t> >(l1).get(0,0,L"hello");
+                wchar_t const *w2 = std::use_facet<bl::message_format<wchar_t> >(l2).get(0,0,L"hello");
+                TEST(w1 && w1 == w2);
+                std::locale l3 = g2("he_IL.ISO8859-8");
+                char const *c3 = std::use_facet<bl::message_format<char> >(l3).get(0,0,"hello");
+                TEST(c3 && c3 != c1);
+            }
             
             std::cout << "  Testing automatic conversions " << std::endl;
             std::locale::global(g("he_IL.UTF-8"));
@@ -434,6 +734,344 @@ int main(int argc,char **argv)
             std::locale l(std::locale::classic(),boost::locale::gnu_gettext::create_messages_facet<char>(info));
             TEST(file_loader_is_actually_called);
             TEST(bl::translate("hello").str(l)=="שלום");
+
+            info.callback = bl::gnu_gettext::messages_info::callback_type();
+            info.mapped_callback = mapped_loader();
+            std::locale lm(std::locale::classic(),boost::locale::gnu_gettext::create_messages_facet<char>(info));
+            TEST(mapped_loader_is_actually_called);
+            TEST(bl::translate("hello").str(lm)=="שלום");
+
+            info.mapped_callback = bl::gnu_gettext::messages_info::mapped_callback_type();
+            info.use_mmap = false;
+            std::locale lr(std::locale::classic(),boost::locale::gnu_gettext::create_messages_facet<char>(info));
+            TEST(bl::translate("hello").str(lr)=="שלום");
+            TEST(bl::translate("x day","x days",2).str(lr)=="יומיים");
+
+            info.use_mmap = true;
+            info.domains.push_back(bl::gnu_gettext::messages_info::domain("simple"));
+            info.callback = no_hash_file_loader();
+            std::locale lh(std::locale::classic(),boost::locale::gnu_gettext::create_messages_facet<char>(info));
+            TEST(bl::translate("hello").str(lh)=="שלום");
+            TEST(bl::translate("context","hello").str(lh)=="שלום בהקשר אחר");
+            TEST(bl::translate("x day","x days",2).str(lh)=="יומיים");
+            TEST(bl::translate("בדיקה").str(lh)=="test");
+            TEST(bl::translate("untranslated").str(lh)=="untranslated");
+            TEST(bl::translate("hello").str(lh,"simple")=="היי");
+            TEST(bl::translate("context","hello").str(lh,"simple")=="היי בהקשר אחר");
+            std::locale lhw(std::locale::classic(),boost::locale::gnu_gettext::create_messages_facet<wchar_t>(info));
+            TEST(bl::translate(L"hello").str(lhw)==to<wchar_t>("שלום"));
+            TEST(bl::translate(L"hello").str(lhw,"simple")==to<wchar_t>("היי"));
+            info.domains.pop_back();
+            info.callback = bl::gnu_gettext::messages_info::callback_type();
+
+            for(int lazy = 0;lazy < 2;lazy++) {
+                info.lazy_conversion = lazy == 1;
+                info.encoding = "UTF-8";
+                std::locale lw(std::locale::classic(),boost::locale::gnu_gettext::create_messages_facet<wchar_t>(info));
+                TEST(bl::translate(L"hello").str(lw)==to<wchar_t>("שלום"));
+                TEST(bl::translate(L"context",L"x day",L"x days",2).str(lw)==to<wchar_t>("בהקשר יומיים"));
+                TEST(bl::translate(to<wchar_t>("בדיקה")).str(lw)==L"test");
+                TEST(bl::translate(L"untranslated").str(lw)==L"untranslated");
+                TEST(BOOST_LOCALE_TRANSLATE(L"hello").str(lw)==to<wchar_t>("שלום"));
+                info.encoding = "ISO-8859-8";
+                std::locale ln(std::locale::classic(),boost::locale::gnu_gettext::create_messages_facet<char>(info));
+                TEST(bl::translate("hello").str(ln)==bl::conv::from_utf("שלום","ISO-8859-8"));
+                TEST(bl::translate("x day","x days",20).str(ln)==bl::conv::from_utf("x יום","ISO-8859-8"));
+                TEST(bl::translate("untranslated").str(ln)=="untranslated");
+                TEST(BOOST_LOCALE_NPTRANSLATE("context","x day","x days",2).str(ln)==bl::conv::from_utf("בהקשר יומיים","ISO-8859-8"));
+            }
+            info.lazy_conversion = true;
+
+            std::cout << "  compiled catalogs" << std::endl;
+            {
+                // same as he/default.po
+                bl::gnu_gettext::compiled::catalog_builder builder;
+                builder.plural_forms(" (n==1 ? 0 : (n==2 ? 1 : (n>10 ? 3 : 2)))");
+                builder.add("","בדיקה","test");
+                builder.add("","hello","שלום");
+                builder.add("context","hello","שלום בהקשר אחר");
+                builder.add("","x day",forms("יום x","יומיים","x ימים","x יום"));
+                builder.add("context","x day",forms("בהקשר יום x","בהקשר יומיים","בהקשר x ימים","בהקשר x יום"));
+                info.mapped_callback = memory_catalog(builder);
+            }
+            info.encoding = "UTF-8";
+            {
+                std::locale lc(std::locale::classic(),boost::locale::gnu_gettext::create_messages_facet<char>(info));
+                TEST(bl::translate("hello").str(lc)=="שלום");
+                TEST(bl::translate("context","hello").str(lc)=="שלום בהקשר אחר");
+                TEST(bl::translate("","hello").str(lc)=="שלום");
+                TEST(bl::translate("בדיקה").str(lc)=="test");
+                TEST(bl::translate("x day","x days",1).str(lc)=="יום x");
+                TEST(bl::translate("x day","x days",2).str(lc)=="יומיים");
+                TEST(bl::translate("x day","x days",20).str(lc)=="x יום");
+                TEST(bl::translate("context","x day","x days",5).str(lc)=="בהקשר x ימים");
+                TEST(BOOST_LOCALE_TRANSLATE("hello").str(lc)=="שלום");
+                TEST(bl::translate("untranslated").str(lc)=="untranslated");
+                TEST(bl::translate("context","untranslated").str(lc)=="untranslated");
+
+                std::locale lw(std::locale::classic(),boost::locale::gnu_gettext::create_messages_facet<wchar_t>(info));
+                TEST(bl::translate(L"hello").str(lw)==to<wchar_t>("שלום"));
+                TEST(bl::translate(to<wchar_t>("בדיקה")).str(lw)==L"test");
+                TEST(bl::translate(L"context",L"x day",L"x days",2).str(lw)==to<wchar_t>("בהקשר יומיים"));
+                TEST(bl::translate(L"untranslated").str(lw)==L"untranslated");
+
+                // narrow catalogs are not used for other encodings, there is no mo file to fall back to
+                info.encoding = "ISO-8859-8";
+                std::locale ln(std::locale::classic(),boost::locale::gnu_gettext::create_messages_facet<char>(info));
+                TEST(bl::translate("hello").str(ln)=="hello");
+                info.encoding = "UTF-8";
+
+                info.compiled_catalogs = false;
+                std::locale ld(std::locale::classic(),boost::locale::gnu_gettext::create_messages_facet<char>(info));
+                TEST(bl::translate("hello").str(ld)=="hello");
+                info.compiled_catalogs = true;
+            }
+            {
+                // a catalog with many messages
+                bl::gnu_gettext::compiled::catalog_builder builder;
+                for(int i=0;i<2000;i++) {
+                    std::ostringstream key,value;
+                    key << "key " << i;
+                    value << "value " << i;
+                    builder.add(i % 3 == 0 ? "ctx" : "",key.str(),value.str());
+                }
+                memory_catalog_loader loader = memory_catalog(builder);
+                bl::gnu_gettext::compiled::file_header hdr;
+                memcpy(&hdr,&(*loader.data)[0],sizeof(hdr));
+                TEST(hdr.count == 2000);
+                info.mapped_callback = loader;
+                std::locale lc(std::locale::classic(),boost::locale::gnu_gettext::create_messages_facet<char>(info));
+                std::locale lw(std::locale::classic(),boost::locale::gnu_gettext::create_messages_facet<wchar_t>(info));
+                bool all_found = true;
+                for(int i=0;i<2000;i++) {
+                    std::ostringstream key,value;
+                    key << "key " << i;
+                    value << "value " << i;
+                    std::string context = i % 3 == 0 ? "ctx" : "";
+                    all_found = all_found 
+                        && bl::translate(context,key.str()).str(lc) == value.str()
+                        && bl::translate(to<wchar_t>(context),to<wchar_t>(key.str())).str(lw) == to<wchar_t>(value.str());
+                }
+                TEST(all_found);
+                TEST(bl::translate("key 2000").str(lc) == "key 2000");
+                TEST(bl::translate("ctx","key 1").str(lc) == "key 1");
+
+                // broken files are rejected
+                memory_catalog_loader broken;
+                broken.data.reset(new std::vector<char>(loader.data->begin(),loader.data->end() - 1));
+                info.mapped_callback = broken;
+                bool failed = false;
+                try {
+                    std::locale lb(std::locale::classic(),boost::locale::gnu_gettext::create_messages_facet<char>(info));
+                }
+                catch(std::runtime_error const &) {
+                    failed = true;
+                }
+                TEST(failed);
+
+                memory_catalog_loader misaligned;
+                misaligned.data.reset(new std::vector<char>(*loader.data));
+                bl::gnu_gettext::compiled::file_header bad_hdr = hdr;
+                bad_hdr.buckets_offset += 1;
+                bad_hdr.buckets -= 1;
+                memcpy(&(*misaligned.data)[0],&bad_hdr,sizeof(bad_hdr));
+                info.mapped_callback = misaligned;
+                failed = false;
+                try {
+                    std::locale lb(std::locale::classic(),boost::locale::gnu_gettext::create_messages_facet<char>(info));
+                }
+                catch(std::runtime_error const &) {
+                    failed = true;
+                }
+                TEST(failed);
+            }
+            info.mapped_callback = bl::gnu_gettext::messages_info::mapped_callback_type();
+
+            std::cout << "  lookup statistics" << std::endl;
+            {
+                bl::gnu_gettext::key_filter filter;
+                filter.reset(1000);
+                for(boost::uint32_t i=0;i<1000;i++)
+                    filter.add(i * 7919);
+                bool all_found = true;
+                for(boost::uint32_t i=0;i<1000;i++)
+                    all_found = all_found && filter.may_contain(i * 7919);
+                TEST(all_found);
+                int passed = 0;
+                for(boost::uint32_t i=0;i<10000;i++)
+                    passed += filter.may_contain(i * 7919 + 1);
+                TEST(passed < 300);
+            }
+            {
+                std::locale l(std::locale::classic(),boost::locale::gnu_gettext::create_messages_facet<char>(info));
+                bl::message_lookup_statistics stats = bl::message_lookup_statistics();
+                TEST(!std::use_facet<bl::message_format<char> >(l).statistics(0,stats));
+            }
+            #ifndef BOOST_LOCALE_NO_CATALOG_STATISTICS
+            info.collect_statistics = true;
+            for(int lazy = 0;lazy < 2;lazy++) {
+                info.lazy_conversion = lazy == 1;
+                std::locale lc(std::locale::classic(),boost::locale::gnu_gettext::create_messages_facet<char>(info));
+                std::locale lw(std::locale::classic(),boost::locale::gnu_gettext::create_messages_facet<wchar_t>(info));
+                TEST(bl::translate("hello").str(lc)=="שלום");
+                TEST(bl::translate("context","x day","x days",2).str(lc)=="בהקשר יומיים");
+                TEST(bl::translate("untranslated").str(lc)=="untranslated");
+                TEST(bl::translate("context","untranslated").str(lc)=="untranslated");
+                TEST(bl::translate(L"untranslated").str(lw)==L"untranslated");
+                TEST(bl::translate(L"hello").str(lw)==to<wchar_t>("שלום"));
+                bl::message_lookup_statistics stats = bl::message_lookup_statistics();
+                TEST(std::use_facet<bl::message_format<char> >(lc).statistics(0,stats));
+                TEST(stats.hits == 2 && stats.misses == 2);
+                TEST(std::use_facet<bl::message_format<wchar_t> >(lw).statistics(0,stats));
+                TEST(stats.hits == 1 && stats.misses == 1);
+                TEST(!std::use_facet<bl::message_format<char> >(lc).statistics(1,stats));
+
+                bl::message_catalog_statistics cstats = bl::message_catalog_statistics();
+                TEST(std::use_facet<bl::message_format<char> >(lc).statistics(0,cstats));
+                TEST(cstats.storage == bl::message_catalog_statistics::mo_file);
+                TEST(cstats.entries > 5 && cstats.file_bytes > 0 && cstats.index_bytes > 0);
+                TEST(cstats.converted_bytes == 0 && cstats.conversions == 0);
+                TEST(cstats.lookups.hits == 2 && cstats.lookups.misses == 2);
+                TEST(std::use_facet<bl::message_format<wchar_t> >(lw).statistics(0,cstats));
+                TEST(cstats.entries > 5 && cstats.converted_bytes > 0);
+                TEST(cstats.lookups.hits == 1 && cstats.lookups.misses == 1);
+                if(lazy) {
+                    TEST(cstats.storage == bl::message_catalog_statistics::converted_on_demand);
+                    TEST(cstats.file_bytes > 0 && cstats.conversions >= 1);
+                    TEST(cstats.failed_key_conversions == 0);
+                    std::wstring invalid(1,wchar_t(0xD800));
+                    TEST(bl::translate(invalid).str(lw) == invalid);
+                    TEST(std::use_facet<bl::message_format<wchar_t> >(lw).statistics(0,cstats));
+                    TEST(cstats.failed_key_conversions == 1 && cstats.lookups.misses == 2);
+                }
+                else {
+                    TEST(cstats.storage == bl::message_catalog_statistics::converted);
+                    TEST(cstats.file_bytes == 0 && cstats.conversions == 0);
+                }
+            }
+            info.collect_statistics = false;
+            info.lazy_conversion = true;
+            {
+                info.domains.push_back(bl::gnu_gettext::messages_info::domain("undefined"));
+                std::locale l(std::locale::classic(),boost::locale::gnu_gettext::create_messages_facet<char>(info));
+                bl::message_catalog_statistics cstats = bl::message_catalog_statistics();
+                TEST(std::use_facet<bl::message_format<char> >(l).statistics(1,cstats));
+                TEST(cstats.storage == bl::message_catalog_statistics::no_catalog && cstats.entries == 0);
+                TEST(std::use_facet<bl::message_format<char> >(l).statistics(0,cstats));
+                TEST(cstats.lookups.hits == 0 && cstats.lookups.misses == 0);
+                TEST(!std::use_facet<bl::message_format<char> >(l).statistics(2,cstats));
+                info.domains.pop_back();
+            }
+            #endif
+
+            std::cout << "  reloading catalogs" << std::endl;
+            {
+                std::locale l(std::locale::classic(),boost::locale::gnu_gettext::create_messages_facet<char>(info));
+                bl::message_format<char> const &facet = std::use_facet<bl::message_format<char> >(l);
+                TEST(!facet.reload());
+                TEST(facet.generation() == 0);
+                TEST(bl::translate("hello").str(l)=="שלום");
+            }
+            info.callback = reload_loader();
+            {
+                std::locale l(std::locale::classic(),boost::locale::gnu_gettext::create_messages_facet<char>(info));
+                bl::message_format<char> const &facet = std::use_facet<bl::message_format<char> >(l);
+                reload_source = "simple";
+                TEST(!facet.reload()); // custom file systems are unchanged unless requested
+                TEST(facet.generation() == 0);
+                TEST(bl::translate("hello").str(l)=="שלום");
+                reload_source = "default";
+            }
+            info.reload_callback_catalogs = true;
+            {
+                std::locale l(std::locale::classic(),boost::locale::gnu_gettext::create_messages_facet<char>(info));
+                bl::message_format<char> const &facet = std::use_facet<bl::message_format<char> >(l);
+                bl::cached_message hello(bl::translate("hello"));
+                TEST(hello.str(l)=="שלום");
+                std::string buffer;
+                std::pair<char const *,char const *> first = bl::translate("hello").view(l,buffer);
+                reload_source = "simple";
+                TEST(facet.reload());
+                TEST(facet.generation() == 1);
+                TEST(hello.str(l)=="היי");
+                TEST(bl::translate("context","hello").str(l)=="היי בהקשר אחר");
+                TEST(bl::translate("x day","x days",2).str(l)=="x days");
+                reload_source = "default";
+                TEST(facet.reload());
+                reload_source = "simple";
+                TEST(facet.reload());
+                TEST(facet.generation() == 3);
+                // the catalogs replaced by reloads are kept for the grace period
+                TEST(std::string(first.first,first.second)=="שלום");
+                // callback catalogs with the same bytes are not replaced
+                TEST(!facet.reload());
+                TEST(facet.generation() == 3);
+
+                reload_source = "default";
+                {
+                    bl::gnu_gettext::catalog_watcher watcher(l,10);
+                    time_t start = time(0);
+                    while(facet.generation() == 3 && time(0) - start < 10)
+                        boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+                    TEST(facet.generation() == 4);
+                    // the watcher keeps reloading the catalogs that did not change
+                    boost::this_thread::sleep(boost::posix_time::milliseconds(100));
+                    TEST(facet.generation() == 4);
+                }
+                TEST(hello.str(l)=="שלום");
+            }
+            {
+                // the number of replaced catalogs in their grace period is limited, further changes wait
+                std::locale l(std::locale::classic(),boost::locale::gnu_gettext::create_messages_facet<char>(info));
+                bl::message_format<char> const &facet = std::use_facet<bl::message_format<char> >(l);
+                bool reloaded = true;
+                for(int i=0;i<100 && reloaded;i++) {
+                    reload_source = i % 2 == 0 ? "simple" : "default";
+                    reloaded = facet.reload();
+                }
+                TEST(!reloaded);
+                TEST(facet.generation() > 0 && facet.generation() < 100);
+                reload_source = "default";
+            }
+            info.reload_grace_period = 0;
+            {
+                // without the grace period the replaced catalogs are released by the next reload
+                std::locale l(std::locale::classic(),boost::locale::gnu_gettext::create_messages_facet<char>(info));
+                bl::message_format<char> const &facet = std::use_facet<bl::message_format<char> >(l);
+                bool reloaded = true;
+                for(int i=0;i<100 && reloaded;i++) {
+                    reload_source = i % 2 == 0 ? "simple" : "default";
+                    reloaded = facet.reload();
+                }
+                TEST(reloaded);
+                TEST(facet.generation() == 100);
+                TEST(bl::translate("hello").str(l)=="שלום");
+                reload_source = "default";
+            }
+            info.reload_grace_period = 60;
+            info.reload_callback_catalogs = false;
+            info.callback = bl::gnu_gettext::messages_info::callback_type();
+
+            std::cout << "  parallel loading" << std::endl;
+            {
+                char const *domains[] = { "simple", "full", "undefined", "fall" };
+                for(unsigned i=0;i<sizeof(domains)/sizeof(domains[0]);i++)
+                    info.domains.push_back(bl::gnu_gettext::messages_info::domain(domains[i]));
+                std::locale ls(std::locale::classic(),boost::locale::gnu_gettext::create_messages_facet<wchar_t>(info));
+                info.load_threads = 3;
+                std::locale lp(std::locale::classic(),boost::locale::gnu_gettext::create_messages_facet<wchar_t>(info));
+                info.load_threads = 0;
+                TEST(bl::translate(L"hello").str(lp)==to<wchar_t>("שלום"));
+                TEST(bl::translate(L"hello").str(lp,"simple")==to<wchar_t>("היי"));
+                TEST(bl::translate(L"hello").str(lp,"undefined")==L"hello");
+                bool same = true;
+                for(unsigned i=0;i<sizeof(domains)/sizeof(domains[0]);i++) {
+                    same = same && bl::translate(L"hello").str(lp,domains[i]) == bl::translate(L"hello").str(ls,domains[i]);
+                    same = same && bl::translate(L"x day",L"x days",2).str(lp,domains[i]) == bl::translate(L"x day",L"x days",2).str(ls,domains[i]);
+                }
+                TEST(same);
+                info.domains.resize(1);
+            }
         }
         std::cout << "Testing non-US-ASCII keys" << std::endl; 
         {
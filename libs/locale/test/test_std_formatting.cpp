@@ -17,6 +17,8 @@ int main()
 
 
 #include <boost/locale/formatting.hpp>
+#include <boost/locale/format.hpp>
+#include <boost/locale/message.hpp>
 #include <boost/locale/localization_backend.hpp>
 #include <boost/locale/generator.hpp>
 #include <boost/locale/encoding.hpp>
@@ -24,6 +26,7 @@ int main()
 #include "test_locale.hpp"
 #include "test_locale_tools.hpp"
 #include <iostream>
+#include <iterator>
 
 //#define DEBUG_FMT
 
@@ -210,6 +213,116 @@ void test_by_char(std::locale const &l,std::locale const &lreal)
 
 }
 
+//
+// The formatting engine of basic_format and format_to does not depend on the backend, the numbers
+// are compared with the output of the stream, so any locale can be used
+//
+template<typename CharType>
+void test_format_engine(std::locale const &l)
+{
+    typedef std::basic_string<CharType> string_type;
+    typedef std::basic_ostringstream<CharType> ss_type;
+
+    using namespace boost::locale;
+
+    std::cout << "- Testing basic_format" << std::endl;
+    string_type text = conv_to_char<CharType>("text");
+    string_type number;
+    {
+        ss_type ss;
+        ss.imbue(l);
+        ss << as::number << 1200;
+        number = ss.str();
+    }
+    {
+        ss_type ss;
+        ss.imbue(l);
+        ss << basic_format<CharType>(conv_to_char<CharType>("{1}{{{1}}}} {{}}")) % 1;
+        TEST(ss.str() == conv_to_char<CharType>("1{1}} {}"));
+    }
+    {
+        // a placeholder that is not closed produces no output
+        ss_type ss;
+        ss.imbue(l);
+        ss << basic_format<CharType>(conv_to_char<CharType>("{1} {2,num")) % 1 % 2;
+        TEST(ss.str() == conv_to_char<CharType>("1 "));
+    }
+    {
+        // placeholder flags are not left on the stream
+        ss_type ss;
+        ss.imbue(l);
+        ss << basic_format<CharType>(conv_to_char<CharType>("{1,num=fix,p=1,<,w=5}")) % 1.5;
+        TEST(ss.str() == conv_to_char<CharType>("1.5  "));
+        TEST(ss.width() == 0);
+        TEST(ss.precision() == 6);
+        TEST((ss.flags() & (std::ios_base::floatfield | std::ios_base::adjustfield)) == 0);
+        TEST(ios_info::get(ss).display_flags() == flags::posix);
+        ss << 7.25;
+        TEST(ss.str() == conv_to_char<CharType>("1.5  7.25"));
+    }
+    {
+        // the width applies to strings written to an output iterator as well
+        string_type result;
+        basic_format<CharType> fmt(conv_to_char<CharType>("{1} [{1,w=6}] [{1,w=6,<}] {2,num}"));
+        (fmt % text % 1200).write(std::back_inserter(result),l);
+        TEST(result == conv_to_char<CharType>("text [  text] [text  ] ") + number);
+    }
+    {
+        // a translated message is used as the format string
+        string_type message = conv_to_char<CharType>("{2}-{1}");
+        string_type result;
+        basic_format<CharType> fmt(basic_message<CharType>(message.c_str()));
+        (fmt % 1 % text).write(std::back_inserter(result),l);
+        TEST(result == conv_to_char<CharType>("text-1"));
+        TEST((basic_format<CharType>(basic_message<CharType>(message.c_str())) % 1 % text).str(l) == result);
+    }
+
+    std::cout << "- Testing format_to" << std::endl;
+    {
+        // missing parameters produce no output
+        string_type fmt = conv_to_char<CharType>("{3} [{1,w=6}] {2,num} {4}");
+        string_type result;
+        format_to(std::back_inserter(result),l,fmt,text,1200,1);
+        TEST(result == conv_to_char<CharType>("1 [  text] ") + number + conv_to_char<CharType>(" "));
+    }
+    {
+        string_type fmt = conv_to_char<CharType>("{1}{2}{3}{4}");
+        CharType const *cfmt = fmt.c_str();
+        basic_message<CharType> mfmt(cfmt);
+        string_type result;
+
+        format_to(std::back_inserter(result),l,fmt,1);
+        format_to(std::back_inserter(result),l,fmt,1,2);
+        format_to(std::back_inserter(result),l,fmt,1,2,3);
+        format_to(std::back_inserter(result),l,fmt,1,2,3,4);
+        TEST(result == conv_to_char<CharType>("1121231234"));
+        result.clear();
+
+        format_to(std::back_inserter(result),l,cfmt,1);
+        format_to(std::back_inserter(result),l,cfmt,1,2);
+        format_to(std::back_inserter(result),l,cfmt,1,2,3);
+        format_to(std::back_inserter(result),l,cfmt,1,2,3,4);
+        TEST(result == conv_to_char<CharType>("1121231234"));
+        result.clear();
+
+        format_to(std::back_inserter(result),l,mfmt,1);
+        format_to(std::back_inserter(result),l,mfmt,1,2);
+        format_to(std::back_inserter(result),l,mfmt,1,2,3);
+        format_to(std::back_inserter(result),l,mfmt,1,2,3,4);
+        TEST(result == conv_to_char<CharType>("1121231234"));
+    }
+    {
+        // the format string is used in place, it may be a parameter as well
+        string_type fmt = conv_to_char<CharType>("{1,num} {2} {2,w=20}");
+        string_type result;
+        format_to(std::back_inserter(result),l,fmt.c_str(),1200,fmt);
+        TEST(result == number + conv_to_char<CharType>(" {1,num} {2} {2,w=20} {1,num} {2} {2,w=20}"));
+        result.clear();
+        format_to(std::back_inserter(result),l,basic_message<CharType>(fmt.c_str()),1200,text);
+        TEST(result == number + conv_to_char<CharType>(" text ") + string_type(16,' ') + text);
+    }
+}
+
 int main()
 {
     try {
@@ -218,6 +331,13 @@ int main()
         boost::locale::localization_backend_manager::global(mgr);
         boost::locale::generator gen;
 
+        {
+            std::cout << "Formatting engine" << std::endl;
+            std::locale l = gen("en_US.UTF-8");
+            test_format_engine<char>(l);
+            test_format_engine<wchar_t>(l);
+        }
+
         {
             std::cout << "en_US.UTF locale" << std::endl;
             std::string real_name;
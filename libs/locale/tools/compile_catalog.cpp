@@ -0,0 +1,163 @@
+//
+//  Copyright (c) 2009-2011 Artyom Beilis (Tonkikh)
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+
+//
+// Converts GNU gettext mo file to the compiled catalog format loaded by Boost.Locale,
+// see libs/locale/src/shared/mo_compiled.hpp
+//
+// Usage: compile_catalog input.mo output.mcat
+//
+// The output should be placed next to the mo file as domain.mcat. It uses the byte order of the
+// machine the tool runs on, so it should be created for each target platform.
+//
+
+#include <boost/locale/encoding.hpp>
+#include "../src/shared/mo_compiled.hpp"
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string.h>
+
+namespace {
+    class mo_reader {
+    public:
+        mo_reader(std::vector<char> const &data) :
+            data_(data)
+        {
+            if(data_.size() < 28)
+                throw std::runtime_error("Invalid mo file - the file is too short");
+            uint32_t magic;
+            memcpy(&magic,&data_[0],4);
+            if(magic == 0x950412de)
+                native_ = true;
+            else if(magic == 0xde120495)
+                native_ = false;
+            else
+                throw std::runtime_error("Invalid mo file - wrong magic number");
+            size_ = get(8);
+            keys_offset_ = get(12);
+            values_offset_ = get(16);
+        }
+        size_t size() const
+        {
+            return size_;
+        }
+        std::string key(unsigned i) const
+        {
+            return string(keys_offset_ + 8*i);
+        }
+        std::string value(unsigned i) const
+        {
+            return string(values_offset_ + 8*i);
+        }
+    private:
+        typedef boost::uint32_t uint32_t;
+
+        uint32_t get(size_t offset) const
+        {
+            if(offset + 4 > data_.size())
+                throw std::runtime_error("Invalid mo file - bad offset");
+            uint32_t v;
+            memcpy(&v,&data_[offset],4);
+            if(!native_)
+                v = ((v & 0xFF) << 24) | ((v & 0xFF00) << 8) | ((v & 0xFF0000) >> 8) | ((v & 0xFF000000) >> 24);
+            return v;
+        }
+        std::string string(size_t descriptor) const
+        {
+            uint32_t len = get(descriptor);
+            uint32_t off = get(descriptor + 4);
+            if(off > data_.size() || data_.size() - off < len)
+                throw std::runtime_error("Invalid mo file - bad string");
+            return std::string(data_.begin() + off,data_.begin() + off + len);
+        }
+
+        std::vector<char> const &data_;
+        bool native_;
+        uint32_t size_;
+        uint32_t keys_offset_;
+        uint32_t values_offset_;
+    };
+
+    std::string extract(std::string const &meta,std::string const &key,char const *separator)
+    {
+        size_t pos = meta.find(key);
+        if(pos == std::string::npos)
+            return std::string();
+        pos += key.size();
+        size_t end_pos = meta.find_first_of(separator,pos);
+        return meta.substr(pos,end_pos - pos);
+    }
+
+    std::vector<char> read_file(char const *name)
+    {
+        std::ifstream in(name,std::ios::binary);
+        if(!in)
+            throw std::runtime_error(std::string("Failed to open ") + name);
+        return std::vector<char>(std::istreambuf_iterator<char>(in),std::istreambuf_iterator<char>());
+    }
+}
+
+int main(int argc,char **argv)
+{
+    namespace conv = boost::locale::conv;
+    namespace compiled = boost::locale::gnu_gettext::compiled;
+
+    if(argc != 3) {
+        std::cerr << "Usage: compile_catalog input.mo output.mcat" << std::endl;
+        return 1;
+    }
+    try {
+        std::vector<char> data = read_file(argv[1]);
+        mo_reader mo(data);
+
+        std::string header;
+        for(unsigned i=0;i<mo.size();i++) {
+            if(mo.key(i).empty()) {
+                header = mo.value(i);
+                break;
+            }
+        }
+        std::string charset = extract(header,"charset="," \r\n;");
+        if(charset.empty())
+            throw std::runtime_error("Invalid mo file - encoding is not specified");
+
+        compiled::catalog_builder builder;
+        builder.plural_forms(extract(header,"plural=","\r\n;"));
+        for(unsigned i=0;i<mo.size();i++) {
+            std::string key = mo.key(i);
+            // the keys of plural messages also hold the plural form after NUL
+            key = key.substr(0,key.find('\0'));
+            if(key.empty())
+                continue;
+            std::string value = mo.value(i);
+            key = conv::between(key,"UTF-8",charset,conv::stop);
+            value = conv::between(value,"UTF-8",charset,conv::stop);
+            size_t eot = key.find('\4');
+            if(eot == std::string::npos)
+                builder.add(std::string(),key,value);
+            else
+                builder.add(key.substr(0,eot),key.substr(eot + 1),value);
+        }
+
+        std::vector<char> output = builder.build();
+        std::ofstream out(argv[2],std::ios::binary);
+        out.write(&output[0],output.size());
+        out.close();
+        if(!out)
+            throw std::runtime_error(std::string("Failed to write ") + argv[2]);
+    }
+    catch(std::exception const &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+// vim: tabstop=4 expandtab shiftwidth=4 softtabstop=4